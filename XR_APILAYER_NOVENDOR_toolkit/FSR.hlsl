@@ -25,6 +25,7 @@ cbuffer cb : register(b0)
   uint4 Const2;
   uint4 Const3;
   uint4 Const4;
+  uint4 Const5; // xy: origin of the output viewport, zw: size of the output viewport.
 };
 
 #define A_GPU 1
@@ -32,6 +33,8 @@ cbuffer cb : register(b0)
 
 SamplerState		samLinearClamp : register(s0);
 
+#include "visibilitymask.h"
+
 #if SAMPLE_SLOW_FALLBACK
   #include "ffx_a.h"
   Texture2D InputTexture : register(t0);
@@ -69,6 +72,10 @@ SamplerState		samLinearClamp : register(s0);
 
 void CurrFilter(int2 pos)
 {
+  if (any(pos >= int2(Const5.zw))) {
+    return;
+  }
+
 #if SAMPLE_BILINEAR
   AF2 pp = (AF2(pos) * AF2_AU2(Const0.xy) + AF2_AU2(Const0.zw)) * AF2_AU2(Const1.xy) + AF2(0.5, -0.5) * AF2_AU2(Const1.zw);
   OutputTexture[pos] = InputTexture.SampleLevel(samLinearClamp, pp, 0.0);
@@ -97,14 +104,14 @@ void CurrFilter(int2 pos)
     #if SAMPLE_HDR_OUTPUT
       c *= c;
     #endif
-    OutputTexture[pos] = float4(c, 1);
+    OutputTexture[pos + Const5.xy] = float4(c, 1);
   #else
     AH3 c;
     FsrRcasH(c.r, c.g, c.b, pos, Const4);
     #if SAMPLE_HDR_OUTPUT
       c *= c;
     #endif
-    OutputTexture[pos] = AH4(c, 1);
+    OutputTexture[pos + Const5.xy] = AH4(c, 1);
   #endif
 #endif
 }
@@ -112,6 +119,13 @@ void CurrFilter(int2 pos)
 [numthreads(FSR_THREAD_GROUP_SIZE, 1, 1)]
 void mainCS(uint3 LocalThreadId : SV_GroupThreadID, uint3 WorkGroupId : SV_GroupID, uint3 Dtid : SV_DispatchThreadID)
 {
+  // Skip the regions that are entirely hidden by the lenses.
+  const float2 viewportSize = Const5.zw;
+  if (!IsRegionVisible(float2(WorkGroupId.xy << 4u) / viewportSize,
+                       float2((WorkGroupId.xy + 1) << 4u) / viewportSize)) {
+    return;
+  }
+
   // Do remapping of local xy in workgroup for a more PS-like swizzle pattern.
   AU2 gxy = ARmp8x8(LocalThreadId.x) + AU2(WorkGroupId.x << 4u, WorkGroupId.y << 4u);
   CurrFilter(gxy);
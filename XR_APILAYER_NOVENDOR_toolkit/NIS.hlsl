@@ -78,6 +78,8 @@ NIS_BINDING(0) cbuffer cb : register(b0) {
 
 NIS_BINDING(1) SamplerState samplerLinearClamp : register(s0);
 
+#include "visibilitymask.h"
+
 #ifndef VPRT
 NIS_BINDING(2) Texture2D in_texture : register(t0);
 NIS_BINDING(3) RWTexture2D<unorm float4> out_texture : register(u0);
@@ -108,6 +110,13 @@ NIS_BINDING(5) Texture2D coef_usm : register(t2);
 [numthreads(NIS_THREAD_GROUP_SIZE, 1, 1)] void main(uint3 blockIdx
                                                     : SV_GroupID, uint3 threadIdx
                                                     : SV_GroupThreadID) {
+    // Skip the blocks that are entirely hidden by the lenses. The whole group exits before any barrier.
+    const float2 blockSize =
+        float2(NIS_BLOCK_WIDTH, NIS_BLOCK_HEIGHT) / float2(kOutputViewportWidth, kOutputViewportHeight);
+    if (!IsRegionVisible(blockIdx.xy * blockSize, (blockIdx.xy + 1) * blockSize)) {
+        return;
+    }
+
 #if NIS_SCALER
     NVScaler(blockIdx.xy, threadIdx.x);
 #else
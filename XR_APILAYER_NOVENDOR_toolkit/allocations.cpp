@@ -0,0 +1,119 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "factories.h"
+
+#include <cstdlib>
+#include <new>
+
+// The layer replaces the global operator new of its module, so that it can count the heap allocations made on the
+// frame path. The array and nothrow variants of operator new of the standard library forward to the plain and aligned
+// variants below. The array and sized variants of operator delete forward to the matching plain or aligned one.
+
+namespace {
+
+    // The counter is per thread, so that the background threads do not show up in the count of the frame thread.
+    thread_local uint64_t g_allocationCount = 0;
+
+    template <typename Allocate>
+    void* AllocateOrThrow(Allocate&& allocate) {
+        while (true) {
+            if (void* ptr = allocate()) {
+                return ptr;
+            }
+            const auto handler = std::get_new_handler();
+            if (!handler) {
+                throw std::bad_alloc();
+            }
+            handler();
+        }
+    }
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    g_allocationCount++;
+
+    if (size == 0) {
+        size = 1;
+    }
+    return AllocateOrThrow([&]() { return std::malloc(size); });
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    operator delete(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    operator delete(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    operator delete(ptr);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    g_allocationCount++;
+
+    // aligned_alloc() wants a size that is a multiple of the alignment.
+    const auto align = static_cast<std::size_t>(alignment);
+    size = std::max<std::size_t>((size + align - 1) & ~(align - 1), align);
+#ifdef _WIN32
+    return AllocateOrThrow([&]() { return _aligned_malloc(size, align); });
+#else
+    return AllocateOrThrow([&]() { return std::aligned_alloc(align, size); });
+#endif
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept {
+    operator delete(ptr, alignment);
+}
+
+void operator delete[](void* ptr, std::align_val_t alignment) noexcept {
+    operator delete(ptr, alignment);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t alignment) noexcept {
+    operator delete(ptr, alignment);
+}
+
+namespace toolkit::utilities {
+
+    uint64_t GetAllocationCount() {
+        return g_allocationCount;
+    }
+
+} // namespace toolkit::utilities
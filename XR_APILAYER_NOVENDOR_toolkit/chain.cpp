@@ -0,0 +1,449 @@
+// MIT License
+//
+// Copyright(c) 2021-2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "factories.h"
+#include "interfaces.h"
+#include "log.h"
+#include "visibilitymask.h"
+
+namespace {
+
+    using namespace toolkit;
+    using namespace toolkit::graphics;
+    using namespace toolkit::log;
+
+    // Estimate the video memory used by a texture (ignoring the mip levels).
+    uint64_t EstimateTextureSize(const XrSwapchainCreateInfo& info) {
+        uint32_t bytesPerPixel;
+        switch ((DXGI_FORMAT)info.format) {
+        case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            bytesPerPixel = 16;
+            break;
+
+        case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+        case DXGI_FORMAT_R16G16B16A16_UNORM:
+            bytesPerPixel = 8;
+            break;
+
+        default:
+            bytesPerPixel = 4;
+            break;
+        }
+
+        return (uint64_t)info.width * info.height * std::max(info.arraySize, 1u) * std::max(info.sampleCount, 1u) *
+               bytesPerPixel;
+    }
+
+    // Scale a texture dimension by the ratio between the output and input resolution of a view, rounding up.
+    uint32_t ScaleDimension(uint32_t dimension, uint32_t outputResolution, int32_t inputResolution) {
+        if (inputResolution <= 0) {
+            return outputResolution;
+        }
+        return (uint32_t)(((uint64_t)dimension * outputResolution + inputResolution - 1) / inputResolution);
+    }
+
+    // A stage is either an upscaler or an image processor.
+    struct Stage {
+        std::shared_ptr<IUpscaler> upscaler;
+        std::shared_ptr<IImageProcessor> processor;
+        bool bypass{false};
+
+        bool isValid() const {
+            return upscaler || processor;
+        }
+
+        StageRequirements getRequirements() const {
+            return upscaler ? upscaler->getRequirements() : processor->getRequirements();
+        }
+
+        bool isIdentity() const {
+            return upscaler ? upscaler->isIdentity() : processor->isIdentity();
+        }
+
+        void update(const config::SettingsSnapshot& settings) const {
+            if (upscaler) {
+                upscaler->update(settings);
+            } else {
+                processor->update(settings);
+            }
+        }
+
+        void run(const std::shared_ptr<ITexture>& input,
+                 const std::shared_ptr<ITexture>& output,
+                 const ViewRegion& region,
+                 const std::shared_ptr<IShaderBuffer>& visibilityMask,
+                 int32_t slice) const {
+            if (upscaler) {
+                upscaler->upscale(input, output, region, visibilityMask, slice);
+            } else {
+                processor->process(input, output, region, visibilityMask, slice);
+            }
+        }
+    };
+
+    class ProcessingChain : public IProcessingChain {
+      public:
+        ProcessingChain(std::shared_ptr<IDevice> graphicsDevice) : m_device(graphicsDevice) {
+            // The shaders always read a visibility mask, so we need one that lets everything through.
+            VisibilityMaskConfig disabledMask{};
+            m_disabledVisibilityMask = m_device->createBuffer(
+                sizeof(VisibilityMaskConfig), "Disabled Visibility Mask CB", &disabledMask, true);
+
+            for (size_t i = 0; i < (size_t)StageType::MaxValue; i++) {
+                m_stageScopes[i] = m_device->registerProfilingScope(StageNames[i]);
+            }
+        }
+
+        void addStage(StageType type, std::shared_ptr<IUpscaler> upscaler) override {
+            Stage stage;
+            stage.upscaler = upscaler;
+            insertStage(type, stage);
+        }
+
+        void addStage(StageType type, std::shared_ptr<IImageProcessor> processor) override {
+            Stage stage;
+            stage.processor = processor;
+            insertStage(type, stage);
+        }
+
+        bool hasStage(StageType type) const override {
+            return m_stages[(size_t)type].isValid();
+        }
+
+        void setBypass(StageType type, bool bypass) override {
+            m_stages[(size_t)type].bypass = bypass;
+        }
+
+        void update(const config::SettingsSnapshot& settings) override {
+            for (const auto type : m_order) {
+                m_stages[(size_t)type].update(settings);
+            }
+        }
+
+        // Determine the stages to run for a swapchain. The stages that preserve the resolution and leave the image
+        // untouched are removed, so that the previous stage (or the application) writes directly into the next
+        // texture. An upscaler preserves the resolution when its output has the resolution of the views.
+        ChainLayout getLayout(const XrSwapchainCreateInfo& appInfo, const XrExtent2Di& viewResolution) const override {
+            ChainLayout layout;
+            std::optional<StageType> lastRemoved;
+            for (const auto type : m_order) {
+                const Stage& stage = m_stages[(size_t)type];
+                const auto requirements = stage.getRequirements();
+                const bool preservesResolution =
+                    (!requirements.outputWidth && !requirements.outputHeight) ||
+                    (requirements.outputWidth == (uint32_t)viewResolution.width &&
+                     requirements.outputHeight == (uint32_t)viewResolution.height);
+                if (stage.isIdentity() && preservesResolution) {
+                    lastRemoved = type;
+                    continue;
+                }
+
+                layout.stages[layout.count++] = type;
+                lastRemoved.reset();
+            }
+
+            // The runtime texture has the format requested by the application, and sRGB formats cannot be written as
+            // unordered access views. Keep the last identity stage to do the conversion.
+            if (lastRemoved && layout.count &&
+                (m_stages[(size_t)layout.stages[layout.count - 1]].getRequirements().outputUsage &
+                 XR_SWAPCHAIN_USAGE_UNORDERED_ACCESS_BIT) &&
+                m_device->isTextureFormatSRGB(appInfo.format)) {
+                layout.stages[layout.count++] = lastRemoved.value();
+            }
+
+            return layout;
+        }
+
+        XrSwapchainCreateInfo getRuntimeSwapchainInfo(const XrSwapchainCreateInfo& appInfo,
+                                                      const XrExtent2Di& viewResolution,
+                                                      const ChainLayout& layout) const override {
+            return describeChain(appInfo, viewResolution, layout).back();
+        }
+
+        std::vector<std::vector<std::shared_ptr<ITexture>>>
+        createSwapchainImages(const XrSwapchainCreateInfo& appInfo,
+                              const XrExtent2Di& viewResolution,
+                              const ChainLayout& layout,
+                              const std::vector<std::shared_ptr<ITexture>>& runtimeTextures) override {
+            const auto infos = describeChain(appInfo, viewResolution, layout);
+
+            for (const auto type : m_order) {
+                if (std::find(layout.stages, layout.stages + layout.count, type) == layout.stages + layout.count) {
+                    Log("%s stage is an identity, removing it from the chain\n", StageNames[(size_t)type]);
+                }
+            }
+
+            // The intermediate textures are only used while processing a frame in xrEndFrame(), and frames are
+            // processed one after the other on the same context. They can therefore be shared by all the images of
+            // the swapchain. Within one chain, each texture must remain distinct since bypassing a stage makes its
+            // neighbours read and write textures that are not adjacent.
+            std::vector<std::shared_ptr<ITexture>> intermediates(layout.count);
+            uint64_t requestedSize = 0;
+            uint64_t allocatedSize = 0;
+            for (size_t i = 1; i < layout.count; i++) {
+                intermediates[i] = m_device->createTexture(
+                    infos[i], fmt::format("{} input TEX2D", StageNames[(size_t)layout.stages[i]]));
+                allocatedSize += EstimateTextureSize(infos[i]);
+                requestedSize += runtimeTextures.size() * EstimateTextureSize(infos[i]);
+            }
+
+            std::unique_lock lock(m_swapchainsLock);
+
+            if (layout.count > 1) {
+                Log("Using %u intermediate textures (%.1f MiB) instead of %u (%.1f MiB)\n",
+                    (uint32_t)(layout.count - 1),
+                    allocatedSize / (1024.0f * 1024.0f),
+                    (uint32_t)(runtimeTextures.size() * (layout.count - 1)),
+                    requestedSize / (1024.0f * 1024.0f));
+
+                // Keep track of the savings for as long as the textures are alive.
+                m_sharedIntermediates.erase(std::remove_if(m_sharedIntermediates.begin(),
+                                                           m_sharedIntermediates.end(),
+                                                           [](const auto& entry) { return entry.first.expired(); }),
+                                            m_sharedIntermediates.end());
+                m_sharedIntermediates.push_back(std::make_pair(intermediates[1], requestedSize - allocatedSize));
+            }
+
+            std::vector<std::vector<std::shared_ptr<ITexture>>> images;
+            for (uint32_t i = 0; i < runtimeTextures.size(); i++) {
+                // The application texture is written while other images are in use, so it cannot be shared.
+                // Without any stage, the application renders directly into the runtime texture.
+                std::vector<std::shared_ptr<ITexture>> chain;
+                if (layout.count) {
+                    chain.push_back(m_device->createTexture(infos[0], fmt::format("App swapchain {} TEX2D", i)));
+                }
+                for (size_t j = 1; j < layout.count; j++) {
+                    chain.push_back(intermediates[j]);
+                }
+                chain.push_back(runtimeTextures[i]);
+
+                images.push_back(std::move(chain));
+            }
+
+            if (layout.count) {
+                m_isLastStage[(size_t)layout.stages[layout.count - 1]].store(true, std::memory_order_relaxed);
+            }
+
+            return images;
+        }
+
+        bool isLastStage(StageType type) const override {
+            return m_isLastStage[(size_t)type].load(std::memory_order_relaxed);
+        }
+
+        uint64_t getMemorySaved() const override {
+            std::unique_lock lock(m_swapchainsLock);
+
+            uint64_t saved = 0;
+            for (const auto& entry : m_sharedIntermediates) {
+                if (!entry.first.expired()) {
+                    saved += entry.second;
+                }
+            }
+            return saved;
+        }
+
+        void process(const std::vector<std::shared_ptr<ITexture>>& chain,
+                     const ChainLayout& layout,
+                     int32_t slice,
+                     const ViewRegion& region,
+                     const std::shared_ptr<IShaderBuffer>& visibilityMask) const override {
+            if (chain.size() != layout.count + 1) {
+                throw new std::runtime_error("Processing chain incomplete!");
+            }
+
+            size_t lastImage = 0;
+            XrRect2Di lastRect = region.input;
+            for (size_t i = 0; i < layout.count; i++) {
+                const auto type = layout.stages[i];
+                const Stage& stage = m_stages[(size_t)type];
+
+                // The stages that preserve the resolution also preserve the rectangle of the view. The upscaler may
+                // scale the rectangle within textures of the same size, and the last stage writes the rectangle
+                // submitted to the runtime.
+                const auto& inputInfo = chain[lastImage]->getInfo();
+                const auto& outputInfo = chain[i + 1]->getInfo();
+                ViewRegion stageRegion;
+                stageRegion.view = region.view;
+                stageRegion.input = lastRect;
+                stageRegion.output = inputInfo.width == outputInfo.width && inputInfo.height == outputInfo.height &&
+                                             !stage.upscaler && i != layout.count - 1
+                                         ? lastRect
+                                         : region.output;
+
+                // The last stage must always run, since it produces the runtime texture.
+                const bool isIdentity = stage.isIdentity() &&
+                                        stageRegion.input.extent.width == stageRegion.output.extent.width &&
+                                        stageRegion.input.extent.height == stageRegion.output.extent.height;
+                if ((stage.bypass || isIdentity) && i != layout.count - 1) {
+                    continue;
+                }
+
+                {
+                    ScopedProfiling scope(*m_device, m_stageScopes[(size_t)type]);
+                    stage.run(chain[lastImage],
+                              chain[i + 1],
+                              stageRegion,
+                              visibilityMask ? visibilityMask : m_disabledVisibilityMask,
+                              slice);
+                }
+
+                lastImage = i + 1;
+                lastRect = stageRegion.output;
+            }
+        }
+
+      private:
+        void insertStage(StageType type, const Stage& stage) {
+            if (hasStage(type)) {
+                throw new std::runtime_error("Stage already exists in the processing chain");
+            }
+            m_stages[(size_t)type] = stage;
+
+            m_order.clear();
+            for (size_t i = 0; i < (size_t)StageType::MaxValue; i++) {
+                if (m_stages[i].isValid()) {
+                    m_order.push_back((StageType)i);
+                }
+            }
+        }
+
+        // Determine the description of all the textures in the chain, from the application texture to the runtime
+        // texture.
+        std::vector<XrSwapchainCreateInfo> describeChain(const XrSwapchainCreateInfo& appInfo,
+                                                         const XrExtent2Di& viewResolution,
+                                                         const ChainLayout& layout) const {
+            std::vector<XrSwapchainCreateInfo> infos;
+            infos.push_back(appInfo);
+
+            for (size_t i = 0; i < layout.count; i++) {
+                const auto requirements = m_stages[(size_t)layout.stages[i]].getRequirements();
+
+                // The previous texture is read by this stage.
+                infos.back().usageFlags |= requirements.inputUsage;
+
+                XrSwapchainCreateInfo output = infos.back();
+                output.format = appInfo.format;
+                output.usageFlags = XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT | requirements.outputUsage;
+                if (requirements.outputWidth && requirements.outputHeight) {
+                    // Textures holding several views (or padding) are scaled by the same factor as one view.
+                    output.width = ScaleDimension(output.width, requirements.outputWidth, viewResolution.width);
+                    output.height = ScaleDimension(output.height, requirements.outputHeight, viewResolution.height);
+                }
+                infos.push_back(output);
+            }
+
+            if (infos.size() > 1) {
+                // The runtime texture must still satisfy the application's needs, with the exception of unordered
+                // access since only our last stage writes to it.
+                infos.back().usageFlags |= appInfo.usageFlags & ~XR_SWAPCHAIN_USAGE_UNORDERED_ACCESS_BIT;
+
+                // Intermediate textures written as unordered access views need a non-sRGB type.
+                for (size_t i = 1; i < infos.size() - 1; i++) {
+                    if ((infos[i].usageFlags & XR_SWAPCHAIN_USAGE_UNORDERED_ACCESS_BIT) &&
+                        m_device->isTextureFormatSRGB(infos[i].format)) {
+                        // good balance between visuals and perf
+                        infos[i].format = m_device->getTextureFormat(TextureFormat::R10G10B10A2_UNORM);
+                    }
+                }
+            }
+
+            return infos;
+        }
+
+        const std::shared_ptr<IDevice> m_device;
+        std::shared_ptr<IShaderBuffer> m_disabledVisibilityMask;
+
+        Stage m_stages[(size_t)StageType::MaxValue];
+        ProfilingScopeId m_stageScopes[(size_t)StageType::MaxValue];
+        std::vector<StageType> m_order;
+
+        // The swapchains are created on a different thread than the statistics are collected.
+        mutable std::mutex m_swapchainsLock;
+
+        // The memory saved for each set of shared intermediate textures.
+        std::vector<std::pair<std::weak_ptr<ITexture>, uint64_t>> m_sharedIntermediates;
+
+        // The stages that write the runtime texture of a swapchain created with this chain.
+        std::atomic<bool> m_isLastStage[(size_t)StageType::MaxValue]{};
+    };
+
+} // namespace
+
+namespace toolkit::graphics {
+
+    std::shared_ptr<IProcessingChain> CreateProcessingChain(std::shared_ptr<IDevice> graphicsDevice) {
+        return std::make_shared<ProcessingChain>(graphicsDevice);
+    }
+
+    ViewRegion GetViewRegion(uint32_t view,
+                             const XrRect2Di& imageRect,
+                             const XrSwapchainCreateInfo& appInfo,
+                             const XrSwapchainCreateInfo& runtimeInfo,
+                             const XrExtent2Di& viewResolution,
+                             const XrExtent2Di& renderResolution) {
+        ViewRegion region;
+        region.view = view;
+        region.input = imageRect;
+        region.output = imageRect;
+
+        // A rectangle rendered at a higher upscaling factor than the swapchain was created for covers the view that a
+        // rectangle at the resolution of the swapchain would cover.
+        const auto expand = [](int64_t extent, int32_t allocated, int32_t rendered) {
+            if (rendered <= 0 || rendered >= allocated) {
+                return extent;
+            }
+            return std::min<int64_t>(extent * allocated / rendered, std::max<int64_t>(extent, allocated));
+        };
+        const int64_t width = expand(imageRect.extent.width, viewResolution.width, renderResolution.width);
+        const int64_t height = expand(imageRect.extent.height, viewResolution.height, renderResolution.height);
+        if (runtimeInfo.width == appInfo.width && runtimeInfo.height == appInfo.height &&
+            width == imageRect.extent.width && height == imageRect.extent.height) {
+            return region;
+        }
+
+        // Both edges are scaled the same way, so that adjacent rectangles stay adjacent.
+        const auto scale = [](int64_t value, uint32_t to, uint32_t from, uint32_t max) {
+            return std::clamp<int64_t>(value * to / std::max(from, 1u), 0, max);
+        };
+        const int64_t left = scale(imageRect.offset.x, runtimeInfo.width, appInfo.width, runtimeInfo.width);
+        const int64_t top = scale(imageRect.offset.y, runtimeInfo.height, appInfo.height, runtimeInfo.height);
+        const int64_t right = scale((int64_t)imageRect.offset.x + width,
+                                    runtimeInfo.width,
+                                    appInfo.width,
+                                    runtimeInfo.width);
+        const int64_t bottom = scale((int64_t)imageRect.offset.y + height,
+                                     runtimeInfo.height,
+                                     appInfo.height,
+                                     runtimeInfo.height);
+        region.output.offset.x = (int32_t)left;
+        region.output.offset.y = (int32_t)top;
+        region.output.extent.width = (int32_t)std::max<int64_t>(right - left, 0);
+        region.output.extent.height = (int32_t)std::max<int64_t>(bottom - top, 0);
+        return region;
+    }
+
+} // namespace toolkit::graphics
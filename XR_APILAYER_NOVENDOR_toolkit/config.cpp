@@ -35,157 +35,286 @@ namespace {
 
     constexpr unsigned int WriteDelay = 90; // 1-2s in good VR :)
 
-    // https://docs.microsoft.com/en-us/archive/msdn-magazine/2017/may/c-use-modern-c-to-access-the-windows-registry
-    std::optional<int> RegGetDword(HKEY hKey, const std::wstring& subKey, const std::wstring& value) {
-        DWORD data{};
-        DWORD dataSize = sizeof(data);
-        LONG retCode = ::RegGetValue(hKey, subKey.c_str(), value.c_str(), RRF_RT_REG_DWORD, nullptr, &data, &dataSize);
-        if (retCode != ERROR_SUCCESS) {
-            return {};
+    // All the DWORD values under a key, by name.
+    using RegistryValues = std::map<std::wstring, int>;
+
+    // Read all the DWORD values under a key at once, rather than querying each value separately.
+    RegistryValues RegEnumDwords(HKEY hKey, const std::wstring& subKey) {
+        RegistryValues values;
+
+        HKEY key;
+        if (::RegOpenKeyEx(hKey, subKey.c_str(), 0, KEY_QUERY_VALUE, &key) != ERROR_SUCCESS) {
+            return values;
+        }
+
+        for (DWORD index = 0;; index++) {
+            // Our value names are short. Longer names (or larger data) fail with ERROR_MORE_DATA and are skipped.
+            wchar_t name[256];
+            DWORD nameLength = ARRAYSIZE(name);
+            DWORD type;
+            DWORD data{};
+            DWORD dataSize = sizeof(data);
+            const LONG retCode = ::RegEnumValue(
+                key, index, name, &nameLength, nullptr, &type, reinterpret_cast<BYTE*>(&data), &dataSize);
+            if (retCode == ERROR_NO_MORE_ITEMS) {
+                break;
+            }
+            if (retCode == ERROR_SUCCESS && type == REG_DWORD) {
+                values.insert_or_assign(std::wstring(name, nameLength), (int)data);
+            }
         }
-        return data;
+
+        ::RegCloseKey(key);
+
+        return values;
     }
 
-    void RegSetDword(HKEY hKey, const std::wstring& subKey, const std::wstring& value, DWORD dwordValue) {
-        DWORD dataSize = sizeof(dwordValue);
-        LONG retCode = ::RegSetKeyValue(hKey, subKey.c_str(), value.c_str(), REG_DWORD, &dwordValue, dataSize);
-        if (retCode != ERROR_SUCCESS) {
-            Log("Failed to write value: %d\n", retCode);
+    std::optional<int> FindValue(const RegistryValues& values, const std::string& name) {
+        const auto it = values.find(std::wstring(name.begin(), name.end()));
+        if (it == values.cend()) {
+            return {};
         }
+        return it->second;
     }
 
     void RegDeleteKey(HKEY hKey, const std::wstring& subKey) {
         ::RegDeleteKey(hKey, subKey.c_str());
     }
 
+    // The values to persist. A newer value for a setting replaces the older one.
+    using ChangeSet = std::map<SettingId, int>;
+
+    // Persists the configuration from a background thread, so that the frame thread never waits on the registry.
+    // The change sets received while a batch is being written are coalesced into the next batch.
+    class RegistryWriter {
+      public:
+        RegistryWriter(const std::wstring& baseKey) : m_baseKey(baseKey) {
+            m_writer = std::thread([this]() { run(); });
+        }
+
+        ~RegistryWriter() {
+            {
+                std::unique_lock lock(m_mutex);
+                m_stop = true;
+            }
+            m_wakeUp.notify_one();
+
+            // The pending changes are written before the thread exits.
+            if (m_writer.joinable()) {
+                m_writer.join();
+            }
+        }
+
+        void enqueue(const ChangeSet& changes) {
+            {
+                std::unique_lock lock(m_mutex);
+                for (const auto& [id, value] : changes) {
+                    m_pending.insert_or_assign(id, value);
+                }
+            }
+            m_wakeUp.notify_one();
+        }
+
+        void enqueueDeleteKey() {
+            {
+                std::unique_lock lock(m_mutex);
+                // The pending changes would be deleted anyway.
+                m_pending.clear();
+                m_deleteKey = true;
+            }
+            m_wakeUp.notify_one();
+        }
+
+      private:
+        void run() {
+            std::unique_lock lock(m_mutex);
+            while (true) {
+                m_wakeUp.wait(lock, [&]() { return m_stop || m_deleteKey || !m_pending.empty(); });
+                if (!m_deleteKey && m_pending.empty()) {
+                    break;
+                }
+
+                const bool deleteKey = std::exchange(m_deleteKey, false);
+                ChangeSet batch;
+                std::swap(batch, m_pending);
+                lock.unlock();
+
+                if (deleteKey) {
+                    RegDeleteKey(HKEY_CURRENT_USER, m_baseKey);
+                }
+                if (!batch.empty()) {
+                    commit(batch);
+                }
+
+                lock.lock();
+            }
+        }
+
+        // Write a batch through a single handle to the key, rather than opening the key for each value.
+        void commit(const ChangeSet& batch) const {
+            RecordEvent("Configuration write");
+
+            HKEY key;
+            LONG retCode = ::RegCreateKeyEx(HKEY_CURRENT_USER,
+                                            m_baseKey.c_str(),
+                                            0,
+                                            nullptr,
+                                            REG_OPTION_NON_VOLATILE,
+                                            KEY_SET_VALUE,
+                                            nullptr,
+                                            &key,
+                                            nullptr);
+            if (retCode != ERROR_SUCCESS) {
+                Log("Failed to open the configuration key: %d\n", retCode);
+                return;
+            }
+
+            for (const auto& [id, value] : batch) {
+                const std::string name(SettingsTable[(size_t)id].name);
+                const DWORD dwordValue = value;
+                retCode = ::RegSetValueEx(key,
+                                          std::wstring(name.begin(), name.end()).c_str(),
+                                          0,
+                                          REG_DWORD,
+                                          reinterpret_cast<const BYTE*>(&dwordValue),
+                                          sizeof(dwordValue));
+                if (retCode != ERROR_SUCCESS) {
+                    Log("Failed to write value: %d\n", retCode);
+                }
+            }
+
+            ::RegCloseKey(key);
+        }
+
+        const std::wstring m_baseKey;
+
+        std::mutex m_mutex;
+        std::condition_variable m_wakeUp;
+        ChangeSet m_pending;
+        bool m_deleteKey{false};
+        bool m_stop{false};
+
+        std::thread m_writer;
+    };
+
     struct ConfigValue {
-        int value;
+        int value{0};
         int defaultValue{0};
 
+        // Whether the value was read from the registry or set by the user, rather than being a default.
+        bool isSet{false};
         bool changedSinceLastQuery{false};
         unsigned int writeCountdown{0};
     };
 
     // A very simple registry/DWORD backed configuration manager.
     // Handles deferred writes (to only commit values after a few game loops completed).
+    // The settings are indexed by their SettingId, and they are all read upfront.
     class ConfigManager : public IConfigManager {
       public:
         ConfigManager(const std::string& appName) : m_appName(appName) {
-            // Check for safe mode and experimental mode.
-            m_safeMode = RegGetDword(HKEY_LOCAL_MACHINE, std::wstring(RegPrefix.begin(), RegPrefix.end()), L"safe_mode")
-                             .value_or(0);
-            m_experimentalMode = RegGetDword(HKEY_LOCAL_MACHINE,
-                                             std::wstring(RegPrefix.begin(), RegPrefix.end()),
-                                             L"enable_experimental")
-                                     .value_or(0);
+            ScopedStartupTimer startupTimer("Configuration load");
 
             std::string baseKey = RegPrefix + "\\" + appName;
             m_baseKey = std::wstring(baseKey.begin(), baseKey.end());
+            m_writer = std::make_unique<RegistryWriter>(m_baseKey);
+
+            // Load both keys once. The settings are then only read from memory.
+            const RegistryValues globalValues =
+                RegEnumDwords(HKEY_LOCAL_MACHINE, std::wstring(RegPrefix.begin(), RegPrefix.end()));
+
+            // Check for safe mode and experimental mode.
+            m_safeMode = FindValue(globalValues, "safe_mode").value_or(0);
+            m_experimentalMode = FindValue(globalValues, "enable_experimental").value_or(0);
+
+            RegistryValues appValues;
+            if (!m_safeMode) {
+                appValues = RegEnumDwords(HKEY_CURRENT_USER, m_baseKey);
+            }
+
+            for (const auto& setting : SettingsTable) {
+                ConfigValue& entry = m_values[(size_t)setting.id];
+                entry.defaultValue = setting.defaultValue;
+                readValue(setting.id, entry, appValues, globalValues);
+            }
+
+            takeSnapshot();
         }
 
         ~ConfigManager() override {
             // Log all unwritten values.
-            for (auto& value : m_values) {
-                ConfigValue& entry = value.second;
-
-                if (entry.writeCountdown > 0) {
+            for (const auto& setting : SettingsTable) {
+                if (m_values[(size_t)setting.id].writeCountdown > 0) {
                     Log("Config value '%s' was discarded due to quickly exiting after changing its value\n",
-                        value.first.c_str());
+                        setting.name);
                 }
             }
         }
 
         void tick() override {
-            for (auto& value : m_values) {
-                ConfigValue& entry = value.second;
+            ChangeSet changes;
+            for (const auto& setting : SettingsTable) {
+                ConfigValue& entry = m_values[(size_t)setting.id];
 
                 if (entry.writeCountdown > 0) {
                     entry.writeCountdown--;
 
                     if (entry.writeCountdown == 0) {
-                        writeValue(value.first, entry);
+                        changes.insert_or_assign(setting.id, entry.value);
                     }
                 }
             }
-        }
-
-        void setDefault(const std::string& name, int value) override {
-            auto it = m_values.find(name);
 
-            if (it != m_values.end()) {
-                Log("Config value '%s' is assigned a default after being used\n", name.c_str());
+            // The actual writes happen on the writer thread.
+            if (!changes.empty()) {
+                m_writer->enqueue(changes);
             }
+        }
 
-            ConfigValue newEntry;
-            ConfigValue& entry = it != m_values.end() ? it->second : newEntry;
+        void setDefault(SettingId id, int value) override {
+            ConfigValue& entry = m_values[(size_t)id];
             entry.defaultValue = value;
-            if (it == m_values.end()) {
-                readValue(name, entry);
-                m_values.insert_or_assign(name, entry);
+            if (!entry.isSet) {
+                entry.value = value;
+                entry.changedSinceLastQuery = true;
             }
         }
 
-        int getValue(const std::string& name) const override {
-            auto it = m_values.find(name);
-
-            ConfigValue newEntry;
-            ConfigValue& entry = it != m_values.end() ? it->second : newEntry;
-            if (it != m_values.end()) {
-                entry.changedSinceLastQuery = false;
-            } else {
-                readValue(name, entry);
-                m_values.insert_or_assign(name, entry);
-            }
+        int getValue(SettingId id) const override {
+            ConfigValue& entry = m_values[(size_t)id];
+            entry.changedSinceLastQuery = false;
 
             return entry.value;
         }
 
-        int peekValue(const std::string& name) const override {
-            auto it = m_values.find(name);
-
-            ConfigValue newEntry;
-            ConfigValue& entry = it != m_values.end() ? it->second : newEntry;
-            if (it == m_values.end()) {
-                readValue(name, entry);
-                m_values.insert_or_assign(name, entry);
-            }
-
-            return entry.value;
+        int peekValue(SettingId id) const override {
+            return m_values[(size_t)id].value;
         }
 
-        void setValue(const std::string& name, int value, bool noCommitDelay) override {
-            auto it = m_values.find(name);
-
-            ConfigValue newEntry;
-            ConfigValue& entry = it != m_values.end() ? it->second : newEntry;
+        void setValue(SettingId id, int value, bool noCommitDelay) override {
+            ConfigValue& entry = m_values[(size_t)id];
             entry.value = value;
+            entry.isSet = true;
             entry.changedSinceLastQuery = true;
             entry.writeCountdown = noCommitDelay ? 1 : WriteDelay;
-            if (it == m_values.end()) {
-                m_values.insert_or_assign(name, entry);
-            }
         }
 
-        bool hasChanged(const std::string& name) const override {
-            auto it = m_values.find(name);
-
-            if (it != m_values.end()) {
-                ConfigValue& entry = it->second;
-
-                return entry.changedSinceLastQuery;
-            }
-
-            return false;
+        bool hasChanged(SettingId id) const override {
+            return m_values[(size_t)id].changedSinceLastQuery;
         }
 
         void resetToDefaults() override {
-            for (auto& value : m_values) {
+            for (const auto& setting : SettingsTable) {
                 // Make an exception for this special entry.
-                if (value.first == "first_run") {
+                if (setting.id == SettingId::FirstRun) {
                     continue;
                 }
 
-                ConfigValue& entry = value.second;
+                // Values that were never set already hold their default.
+                ConfigValue& entry = m_values[(size_t)setting.id];
+                if (!entry.isSet) {
+                    continue;
+                }
 
                 entry.value = entry.defaultValue;
                 entry.changedSinceLastQuery = true;
@@ -202,37 +331,49 @@ namespace {
         }
 
         void hardReset() override {
-            RegDeleteKey(HKEY_CURRENT_USER, m_baseKey);
-            for (auto& value : m_values) {
-                ConfigValue& entry = value.second;
-
+            m_writer->enqueueDeleteKey();
+            for (auto& entry : m_values) {
                 entry.value = entry.defaultValue;
+                entry.isSet = false;
                 entry.changedSinceLastQuery = true;
                 entry.writeCountdown = 0;
             }
         }
 
+        void takeSnapshot() override {
+            for (size_t i = 0; i < (size_t)SettingId::MaxValue; i++) {
+                m_snapshot.values[i].store(m_values[i].value, std::memory_order_relaxed);
+            }
+        }
+
+        const SettingsSnapshot& getSnapshot() const override {
+            return m_snapshot;
+        }
+
       private:
-        void readValue(const std::string& name, ConfigValue& entry) const {
+        void readValue(SettingId id,
+                       ConfigValue& entry,
+                       const RegistryValues& appValues,
+                       const RegistryValues& globalValues) const {
+            entry.value = entry.defaultValue;
+            entry.changedSinceLastQuery = true;
             if (m_safeMode) {
-                entry.value = entry.defaultValue;
-                entry.changedSinceLastQuery = true;
                 return;
             }
 
-            auto value = RegGetDword(HKEY_CURRENT_USER, m_baseKey, std::wstring(name.begin(), name.end()));
+            const SettingDefinition& setting = SettingsTable[(size_t)id];
+            auto value = FindValue(appValues, setting.name);
             if (!value) {
                 // Fallback to HKLM for global options.
-                value = RegGetDword(HKEY_LOCAL_MACHINE,
-                                    std::wstring(RegPrefix.begin(), RegPrefix.end()),
-                                    std::wstring(name.begin(), name.end()));
+                value = FindValue(globalValues, setting.name);
+            }
+            if (value) {
+                entry.value = std::clamp(value.value(), setting.minValue, setting.maxValue);
+                if (entry.value != value.value()) {
+                    Log("Config value '%s' is out of range (%d), using %d\n", setting.name, value.value(), entry.value);
+                }
+                entry.isSet = true;
             }
-            entry.value = value.value_or(entry.defaultValue);
-            entry.changedSinceLastQuery = true;
-        }
-
-        void writeValue(const std::string& name, ConfigValue& entry) const {
-            RegSetDword(HKEY_CURRENT_USER, m_baseKey, std::wstring(name.begin(), name.end()), entry.value);
         }
 
         const std::string m_appName;
@@ -240,7 +381,11 @@ namespace {
         bool m_safeMode;
         bool m_experimentalMode;
 
-        mutable std::map<std::string, ConfigValue> m_values;
+        mutable ConfigValue m_values[(size_t)SettingId::MaxValue];
+
+        SettingsSnapshot m_snapshot;
+
+        std::unique_ptr<RegistryWriter> m_writer;
     };
 
 } // namespace
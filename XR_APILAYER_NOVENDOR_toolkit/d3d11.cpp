@@ -462,18 +462,208 @@ namespace {
         mutable struct D3D11::MeshData m_meshData;
     };
 
-    class D3D11GpuTimer : public IGpuTimer {
+    // The location of a timestamp written by a D3D11GpuTimer.
+    struct D3D11Timestamp {
+        uint64_t batch{0};
+        uint32_t index{0};
+    };
+
+    // A pool of timestamp queries shared by all the timers of a device. All the timestamps of a frame are bracketed by
+    // a single disjoint query, and their results are harvested together once the frame has completed on the GPU.
+    class D3D11TimestampQueryPool {
+      private:
+        // Keep the results of a frame long enough for the layer to read the timers a few frames later.
+        static constexpr uint64_t RetainedBatches = 8;
+
+        // Stop growing the ring if the GPU does not make progress, the oldest results are dropped instead.
+        static constexpr size_t MaxBatches = 32;
+
+        struct Batch {
+            uint64_t id{0};
+            ComPtr<ID3D11Query> disjoint;
+            std::vector<ComPtr<ID3D11Query>> timestamps;
+            std::vector<uint64_t> results;
+            uint32_t numUsed{0};
+            bool isEnded{false};
+            bool isHarvested{false};
+            bool isDisjoint{false};
+            uint64_t frequency{0};
+        };
+
       public:
-        D3D11GpuTimer(std::shared_ptr<IDevice> device) : m_device(device) {
-            auto d3dDevice = m_device->getNative<D3D11>();
+        D3D11TimestampQueryPool(ID3D11Device* device, ID3D11DeviceContext* context)
+            : m_device(device), m_context(context) {
+            m_batches.push_back(newBatch());
+            m_context->Begin(m_batches.back().disjoint.Get());
+        }
+
+        ~D3D11TimestampQueryPool() {
+            if (m_numLateResults || m_numDroppedBatches) {
+                Log("%u GPU timer results were read before completion, %u frames of results were dropped\n",
+                    m_numLateResults,
+                    m_numDroppedBatches);
+            }
+        }
+
+        // Write a timestamp at the current point of the context, which may be a deferred context.
+        void writeTimestamp(ID3D11DeviceContext* context, D3D11Timestamp& timestamp) {
+            auto& batch = m_batches.back();
+            if (batch.numUsed == batch.timestamps.size()) {
+                D3D11_QUERY_DESC queryDesc;
+                ZeroMemory(&queryDesc, sizeof(D3D11_QUERY_DESC));
+                queryDesc.Query = D3D11_QUERY_TIMESTAMP;
+                ComPtr<ID3D11Query> query;
+                CHECK_HRCMD(m_device->CreateQuery(&queryDesc, &query));
+                batch.timestamps.push_back(query);
+            }
+
+            context->End(batch.timestamps[batch.numUsed].Get());
+            timestamp.batch = batch.id;
+            timestamp.index = batch.numUsed++;
+        }
+
+        // Close the disjoint query of the frame and start the next one.
+        void endBatch() {
+            {
+                auto& batch = m_batches.back();
+                if (!batch.numUsed) {
+                    return;
+                }
+
+                m_context->End(batch.disjoint.Get());
+                batch.isEnded = true;
+            }
+
+            harvest();
+
+            // Recycle the oldest batch once its results are harvested and no longer needed, otherwise grow the ring
+            // until it covers the readback latency of the GPU.
+            const uint64_t id = m_batches.back().id + 1;
+            Batch next;
+            auto& oldest = m_batches.front();
+            if (oldest.isHarvested && id - oldest.id > RetainedBatches) {
+                next = std::move(oldest);
+                m_batches.pop_front();
+            } else if (m_batches.size() >= MaxBatches) {
+                if (!oldest.isHarvested) {
+                    m_numDroppedBatches++;
+                }
+                next = std::move(oldest);
+                m_batches.pop_front();
+            } else {
+                next = newBatch();
+            }
+
+            next.id = id;
+            next.numUsed = 0;
+            next.isEnded = next.isHarvested = next.isDisjoint = false;
+            m_batches.push_back(std::move(next));
+            m_context->Begin(m_batches.back().disjoint.Get());
+        }
+
+        // Read a pair of timestamps, along with the frequency of their ticks.
+        bool readTimestamps(const D3D11Timestamp& start,
+                            const D3D11Timestamp& end,
+                            uint64_t& startTicks,
+                            uint64_t& endTicks,
+                            uint64_t& frequency) {
+            const Batch* startBatch = findBatch(start.batch);
+            const Batch* endBatch = findBatch(end.batch);
+            if (!startBatch || !endBatch) {
+                return false;
+            }
 
+            if (!endBatch->isHarvested) {
+                harvest();
+
+                // The batches complete in order, so the start batch is harvested if the end batch is.
+                if (!endBatch->isHarvested) {
+                    m_numLateResults++;
+                    return false;
+                }
+            }
+
+            if (startBatch->isDisjoint || endBatch->isDisjoint) {
+                return false;
+            }
+
+            startTicks = startBatch->results[start.index];
+            endTicks = endBatch->results[end.index];
+            frequency = endBatch->frequency;
+            return true;
+        }
+
+      private:
+        Batch newBatch() const {
+            Batch batch;
             D3D11_QUERY_DESC queryDesc;
             ZeroMemory(&queryDesc, sizeof(D3D11_QUERY_DESC));
             queryDesc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
-            CHECK_HRCMD(d3dDevice->CreateQuery(&queryDesc, &m_timeStampDis));
-            queryDesc.Query = D3D11_QUERY_TIMESTAMP;
-            CHECK_HRCMD(d3dDevice->CreateQuery(&queryDesc, &m_timeStampStart));
-            CHECK_HRCMD(d3dDevice->CreateQuery(&queryDesc, &m_timeStampEnd));
+            CHECK_HRCMD(m_device->CreateQuery(&queryDesc, &batch.disjoint));
+            return batch;
+        }
+
+        const Batch* findBatch(uint64_t id) const {
+            if (id < m_batches.front().id || id > m_batches.back().id) {
+                return nullptr;
+            }
+            return &m_batches[id - m_batches.front().id];
+        }
+
+        // Collect the results of all the batches that have completed, in one pass.
+        void harvest() {
+            for (auto& batch : m_batches) {
+                if (!batch.isEnded) {
+                    break;
+                }
+                if (batch.isHarvested) {
+                    continue;
+                }
+
+                D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disData;
+                if (m_context->GetData(batch.disjoint.Get(),
+                                       &disData,
+                                       sizeof(D3D11_QUERY_DATA_TIMESTAMP_DISJOINT),
+                                       D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) {
+                    break;
+                }
+
+                batch.results.resize(batch.numUsed);
+                uint32_t i = 0;
+                for (; i < batch.numUsed; i++) {
+                    if (m_context->GetData(batch.timestamps[i].Get(),
+                                           &batch.results[i],
+                                           sizeof(UINT64),
+                                           D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) {
+                        break;
+                    }
+                }
+                if (i != batch.numUsed) {
+                    break;
+                }
+
+                batch.isHarvested = true;
+                batch.isDisjoint = disData.Disjoint;
+                batch.frequency = disData.Frequency;
+            }
+        }
+
+        const ComPtr<ID3D11Device> m_device;
+        const ComPtr<ID3D11DeviceContext> m_context;
+
+        // From the oldest to the batch being recorded.
+        std::deque<Batch> m_batches;
+
+        uint32_t m_numLateResults{0};
+        uint32_t m_numDroppedBatches{0};
+    };
+
+    class D3D11GpuTimer : public IGpuTimer {
+      public:
+        D3D11GpuTimer(std::shared_ptr<IDevice> device,
+                      std::shared_ptr<D3D11TimestampQueryPool> queryPool,
+                      const ClockCalibration& clockCalibration)
+            : m_device(device), m_queryPool(queryPool), m_clockCalibration(clockCalibration) {
         }
 
         Api getApi() const override {
@@ -487,37 +677,28 @@ namespace {
         void start() override {
             assert(!m_valid);
 
-            auto context = m_device->getContext<D3D11>();
-
-            context->Begin(m_timeStampDis.Get());
-            context->End(m_timeStampStart.Get());
+            m_queryPool->writeTimestamp(m_device->getContext<D3D11>(), m_start);
         }
 
         void stop() override {
             assert(!m_valid);
 
-            auto context = m_device->getContext<D3D11>();
-
-            context->End(m_timeStampEnd.Get());
-            context->End(m_timeStampDis.Get());
+            m_queryPool->writeTimestamp(m_device->getContext<D3D11>(), m_end);
             m_valid = true;
         }
 
-        uint64_t query(bool reset) const override {
-            auto context = m_device->getContext<D3D11>();
-
-            D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disData;
-            UINT64 startime;
-            UINT64 endtime;
+        std::optional<uint64_t> query(bool reset) const override {
+            std::optional<uint64_t> duration;
 
-            uint64_t duration = 0;
+            uint64_t startTime;
+            uint64_t endTime;
+            uint64_t frequency;
+            if (m_valid && m_queryPool->readTimestamps(m_start, m_end, startTime, endTime, frequency)) {
+                duration = (uint64_t)((endTime - startTime) / double(frequency) * 1e6);
 
-            if (m_valid &&
-                context->GetData(m_timeStampDis.Get(), &disData, sizeof(D3D11_QUERY_DATA_TIMESTAMP_DISJOINT), 0) ==
-                    S_OK &&
-                context->GetData(m_timeStampStart.Get(), &startime, sizeof(UINT64), 0) == S_OK &&
-                context->GetData(m_timeStampEnd.Get(), &endtime, sizeof(UINT64), 0) == S_OK && !disData.Disjoint) {
-                duration = (uint64_t)((endtime - startime) / double(disData.Frequency) * 1e6);
+                m_lastStartTimestamp = startTime;
+                m_lastEndTimestamp = endTime;
+                m_hasTimestamps = true;
             }
 
             m_valid = !reset;
@@ -525,14 +706,30 @@ namespace {
             return duration;
         }
 
+        bool consumeTimestamps(uint64_t& startUs, uint64_t& endUs) override {
+            if (!std::exchange(m_hasTimestamps, false) || !m_clockCalibration.isValid()) {
+                return false;
+            }
+
+            startUs = m_clockCalibration.toCpuTimeUs(m_lastStartTimestamp);
+            endUs = m_clockCalibration.toCpuTimeUs(m_lastEndTimestamp);
+            return true;
+        }
+
       private:
         const std::shared_ptr<IDevice> m_device;
-        ComPtr<ID3D11Query> m_timeStampDis;
-        ComPtr<ID3D11Query> m_timeStampStart;
-        ComPtr<ID3D11Query> m_timeStampEnd;
+        const std::shared_ptr<D3D11TimestampQueryPool> m_queryPool;
+        const ClockCalibration& m_clockCalibration;
+        D3D11Timestamp m_start;
+        D3D11Timestamp m_end;
 
-        // Can the timer be queried (it might still only read 0).
+        // Can the timer be queried (it might still have no result).
         mutable bool m_valid{false};
+
+        // The timestamps of the last measurement.
+        mutable uint64_t m_lastStartTimestamp{0};
+        mutable uint64_t m_lastEndTimestamp{0};
+        mutable bool m_hasTimestamps{false};
     };
 
     class D3D11Device : public IDevice, public std::enable_shared_from_this<D3D11Device> {
@@ -567,6 +764,8 @@ namespace {
             if (!textOnly) {
                 initializeShadingResources();
                 initializeMeshResources();
+                m_timestampQueryPool = std::make_shared<D3D11TimestampQueryPool>(m_device.Get(), m_context.Get());
+                m_profiler = CreateProfiler(*this);
             }
             initializeTextResources();
         }
@@ -585,6 +784,8 @@ namespace {
 
             m_meshModelBuffer.reset();
             m_meshViewProjectionBuffer.reset();
+
+            m_profiler.reset();
         }
 
         Api getApi() const override {
@@ -650,6 +851,11 @@ namespace {
             // Ensure we are not dropping an unfinished context.
             assert(m_currentContext == m_context);
 
+            // This is the end of the frame.
+            if (m_timestampQueryPool) {
+                m_timestampQueryPool->endBatch();
+            }
+
             if (blocking) {
                 m_currentContext->Flush();
             }
@@ -812,7 +1018,57 @@ namespace {
         }
 
         std::shared_ptr<IGpuTimer> createTimer() override {
-            return std::make_shared<D3D11GpuTimer>(shared_from_this());
+            return std::make_shared<D3D11GpuTimer>(shared_from_this(), m_timestampQueryPool, m_clockCalibration);
+        }
+
+        void calibrateTimers() override {
+            // Direct3D 11 cannot sample both clocks at once. Wait for a timestamp to be written, and sample the CPU
+            // clock right after. This is accurate to a few microseconds.
+            D3D11_QUERY_DESC queryDesc;
+            ZeroMemory(&queryDesc, sizeof(D3D11_QUERY_DESC));
+            queryDesc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+            ComPtr<ID3D11Query> timeStampDis;
+            CHECK_HRCMD(m_device->CreateQuery(&queryDesc, &timeStampDis));
+            queryDesc.Query = D3D11_QUERY_TIMESTAMP;
+            ComPtr<ID3D11Query> timeStamp;
+            CHECK_HRCMD(m_device->CreateQuery(&queryDesc, &timeStamp));
+
+            m_context->Begin(timeStampDis.Get());
+            m_context->End(timeStamp.Get());
+            m_context->End(timeStampDis.Get());
+            m_context->Flush();
+
+            UINT64 gpuTimestamp;
+            while (m_context->GetData(timeStamp.Get(), &gpuTimestamp, sizeof(UINT64), 0) != S_OK) {
+            }
+            LARGE_INTEGER cpuTimestamp;
+            QueryPerformanceCounter(&cpuTimestamp);
+
+            D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disData;
+            while (m_context->GetData(timeStampDis.Get(), &disData, sizeof(D3D11_QUERY_DATA_TIMESTAMP_DISJOINT), 0) !=
+                   S_OK) {
+            }
+            if (!disData.Disjoint) {
+                m_clockCalibration.gpuTimestamp = gpuTimestamp;
+                m_clockCalibration.gpuFrequency = disData.Frequency;
+                m_clockCalibration.cpuTimeUs = QpcToMicroseconds(cpuTimestamp.QuadPart);
+            }
+        }
+
+        ProfilingScopeId registerProfilingScope(const std::string& name) override {
+            return m_profiler->registerScope(name);
+        }
+
+        void pushProfilingScope(ProfilingScopeId id) override {
+            m_profiler->pushScope(id);
+        }
+
+        void popProfilingScope() override {
+            m_profiler->popScope();
+        }
+
+        const std::vector<ProfilingResult>& collectProfilingResults() override {
+            return m_profiler->nextFrame();
         }
 
         void setShader(std::shared_ptr<IQuadShader> shader) override {
@@ -950,6 +1206,16 @@ namespace {
             }
         }
 
+        void setViewport(const XrRect2Di& viewport) override {
+            D3D11_VIEWPORT d3dViewport;
+            ZeroMemory(&d3dViewport, sizeof(d3dViewport));
+            d3dViewport.TopLeftX = (float)viewport.offset.x;
+            d3dViewport.TopLeftY = (float)viewport.offset.y;
+            d3dViewport.Width = (float)viewport.extent.width;
+            d3dViewport.Height = (float)viewport.extent.height;
+            m_currentContext->RSSetViewports(1, &d3dViewport);
+        }
+
         void unsetRenderTargets() override {
             std::vector<ID3D11RenderTargetView*> rtvs;
 
@@ -1338,6 +1604,8 @@ namespace {
 
         // Initialize resources for drawString() and related calls.
         void initializeTextResources() {
+            ScopedStartupTimer startupTimer("FW1 font wrapper creation");
+
             CHECK_HRCMD(FW1CreateFactory(FW1_VERSION, &m_fontWrapperFactory));
 
             CHECK_HRCMD(m_fontWrapperFactory->CreateFontWrapper(m_device.Get(), FontFamily.c_str(), &m_fontNormal));
@@ -1357,6 +1625,9 @@ namespace {
         ComPtr<ID3D11DeviceContext> m_context;
         ComPtr<ID3D11DeviceContext> m_currentContext;
         std::string m_deviceName;
+        std::shared_ptr<D3D11TimestampQueryPool> m_timestampQueryPool;
+        ClockCalibration m_clockCalibration;
+        std::shared_ptr<IProfiler> m_profiler;
 
         ComPtr<ID3D11SamplerState> m_linearClampSamplerPS;
         ComPtr<ID3D11SamplerState> m_linearClampSamplerCS;
@@ -658,9 +658,163 @@ namespace {
         mutable struct D3D12::MeshData m_meshData;
     };
 
+    // The location of a timestamp written by a D3D12GpuTimer.
+    struct D3D12Timestamp {
+        uint64_t batch{0};
+        uint32_t index{0};
+    };
+
+    // A pool of timestamp queries shared by all the timers of a device. The timestamps written into a command list are
+    // resolved with a single ResolveQueryData() when the command list is submitted, into a ring of readback buffers
+    // that can be read later without stalling.
+    class D3D12TimestampQueryPool {
+      private:
+        // Each batch is one submitted command list, and there can be up to 3 of them per frame. Keep enough of them for
+        // the layer to read the timers a few frames later.
+        static constexpr size_t NumBatches = 16;
+
+        static constexpr uint32_t InitialCapacity = 16;
+
+        struct Batch {
+            ComPtr<ID3D12Resource> readbackBuffer;
+            uint64_t id{UINT64_MAX};
+            UINT64 fenceValue{0};
+        };
+
+      public:
+        D3D12TimestampQueryPool(ID3D12Device* device, ID3D12CommandQueue* queue, ID3D12Fence* fence)
+            : m_device(device), m_fence(fence) {
+            CHECK_HRCMD(queue->GetTimestampFrequency(&m_gpuFrequency));
+            allocate(InitialCapacity);
+        }
+
+        // Write a timestamp at the current point of the command list.
+        bool writeTimestamp(ID3D12GraphicsCommandList* commandList, D3D12Timestamp& timestamp) {
+            if (m_numUsed == m_capacity) {
+                // Grow the pool when the command list is submitted.
+                m_needGrow = true;
+                return false;
+            }
+
+            timestamp.batch = m_currentBatch;
+            timestamp.index = m_numUsed++;
+            commandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, getQueryIndex(timestamp));
+            return true;
+        }
+
+        // Record the resolve of all the timestamps written into the command list.
+        void resolve(ID3D12GraphicsCommandList* commandList) {
+            if (m_numUsed) {
+                const auto& batch = m_batches[m_currentBatch % NumBatches];
+                commandList->ResolveQueryData(m_queryHeap.Get(),
+                                              D3D12_QUERY_TYPE_TIMESTAMP,
+                                              getQueryIndex({m_currentBatch, 0}),
+                                              m_numUsed,
+                                              batch.readbackBuffer.Get(),
+                                              0);
+            }
+        }
+
+        // Start a new batch once the command list has been submitted.
+        void onSubmitted(UINT64 fenceValue) {
+            auto& batch = m_batches[m_currentBatch % NumBatches];
+            batch.id = m_currentBatch;
+            batch.fenceValue = fenceValue;
+
+            m_currentBatch++;
+            m_numUsed = 0;
+
+            if (m_needGrow) {
+                // The heap and the readback buffers might still be in use by the GPU.
+                if (m_fence->GetCompletedValue() < fenceValue) {
+                    HANDLE eventHandle = CreateEventEx(nullptr, L"Timestamp Query Pool Fence", 0, EVENT_ALL_ACCESS);
+                    CHECK_HRCMD(m_fence->SetEventOnCompletion(fenceValue, eventHandle));
+                    WaitForSingleObject(eventHandle, INFINITE);
+                    CloseHandle(eventHandle);
+                }
+
+                allocate(m_capacity * 2);
+                m_needGrow = false;
+            }
+        }
+
+        // Read a timestamp if its command list has completed and its readback buffer was not recycled yet.
+        bool readTimestamp(const D3D12Timestamp& timestamp, uint64_t& ticks) const {
+            const auto& batch = m_batches[timestamp.batch % NumBatches];
+            if (batch.id != timestamp.batch || m_fence->GetCompletedValue() < batch.fenceValue) {
+                return false;
+            }
+
+            const D3D12_RANGE readRange{timestamp.index * sizeof(uint64_t), (timestamp.index + 1) * sizeof(uint64_t)};
+            void* data;
+            if (FAILED(batch.readbackBuffer->Map(0, &readRange, &data))) {
+                return false;
+            }
+            ticks = reinterpret_cast<const uint64_t*>(data)[timestamp.index];
+            const D3D12_RANGE writtenRange{0, 0};
+            batch.readbackBuffer->Unmap(0, &writtenRange);
+
+            return true;
+        }
+
+        uint64_t getFrequency() const {
+            return m_gpuFrequency;
+        }
+
+      private:
+        void allocate(uint32_t capacity) {
+            Log("Allocating %u timestamp queries per command list\n", capacity);
+
+            D3D12_QUERY_HEAP_DESC desc;
+            ZeroMemory(&desc, sizeof(desc));
+            desc.Count = capacity * NumBatches;
+            desc.NodeMask = 1;
+            desc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+            CHECK_HRCMD(m_device->CreateQueryHeap(&desc, IID_PPV_ARGS(m_queryHeap.ReleaseAndGetAddressOf())));
+            m_queryHeap->SetName(L"Timestamp Query Heap");
+
+            const auto& heapType = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK);
+            const auto bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(capacity * sizeof(uint64_t));
+            for (auto& batch : m_batches) {
+                CHECK_HRCMD(m_device->CreateCommittedResource(
+                    &heapType,
+                    D3D12_HEAP_FLAG_NONE,
+                    &bufferDesc,
+                    D3D12_RESOURCE_STATE_COPY_DEST,
+                    nullptr,
+                    IID_PPV_ARGS(batch.readbackBuffer.ReleaseAndGetAddressOf())));
+                batch.readbackBuffer->SetName(L"Timestamp Readback Buffer");
+
+                // Timestamps from before the reallocation are lost.
+                batch.id = UINT64_MAX;
+            }
+
+            m_capacity = capacity;
+        }
+
+        UINT getQueryIndex(const D3D12Timestamp& timestamp) const {
+            return (UINT)((timestamp.batch % NumBatches) * m_capacity + timestamp.index);
+        }
+
+        const ComPtr<ID3D12Device> m_device;
+        const ComPtr<ID3D12Fence> m_fence;
+        uint64_t m_gpuFrequency{0};
+
+        ComPtr<ID3D12QueryHeap> m_queryHeap;
+        Batch m_batches[NumBatches];
+        uint32_t m_capacity{0};
+
+        uint64_t m_currentBatch{0};
+        uint32_t m_numUsed{0};
+        bool m_needGrow{false};
+    };
+
     class D3D12GpuTimer : public IGpuTimer {
       public:
-        D3D12GpuTimer(std::shared_ptr<IDevice> device) : m_device(device) {
+        D3D12GpuTimer(std::shared_ptr<IDevice> device,
+                      std::shared_ptr<D3D12TimestampQueryPool> queryPool,
+                      const ClockCalibration& clockCalibration)
+            : m_device(device), m_queryPool(queryPool), m_clockCalibration(clockCalibration) {
         }
 
         Api getApi() const override {
@@ -672,27 +826,70 @@ namespace {
         }
 
         void start() override {
-            // TODO: Implement this.
+            assert(!m_valid);
+
+            m_started = m_queryPool->writeTimestamp(m_device->getContext<D3D12>(), m_start);
         }
 
         void stop() override {
-            // TODO: Implement this.
+            assert(!m_valid);
+
+            m_valid = m_queryPool->writeTimestamp(m_device->getContext<D3D12>(), m_end) && m_started;
         }
 
-        uint64_t query(bool reset) const override {
-            // TODO: Implement this.
-            return 0;
+        std::optional<uint64_t> query(bool reset) const override {
+            std::optional<uint64_t> duration;
+
+            uint64_t startTime;
+            uint64_t endTime;
+            if (m_valid && m_queryPool->readTimestamp(m_start, startTime) &&
+                m_queryPool->readTimestamp(m_end, endTime) && endTime >= startTime) {
+                duration = (uint64_t)((endTime - startTime) / double(m_queryPool->getFrequency()) * 1e6);
+
+                m_lastStartTimestamp = startTime;
+                m_lastEndTimestamp = endTime;
+                m_hasTimestamps = true;
+            }
+
+            m_valid = !reset;
+
+            return duration;
+        }
+
+        bool consumeTimestamps(uint64_t& startUs, uint64_t& endUs) override {
+            if (!std::exchange(m_hasTimestamps, false) || !m_clockCalibration.isValid()) {
+                return false;
+            }
+
+            startUs = m_clockCalibration.toCpuTimeUs(m_lastStartTimestamp);
+            endUs = m_clockCalibration.toCpuTimeUs(m_lastEndTimestamp);
+            return true;
         }
 
       private:
         const std::shared_ptr<IDevice> m_device;
+        const std::shared_ptr<D3D12TimestampQueryPool> m_queryPool;
+        const ClockCalibration& m_clockCalibration;
+
+        D3D12Timestamp m_start;
+        D3D12Timestamp m_end;
+        bool m_started{false};
+
+        // Can the timer be queried (it might still only read 0).
+        mutable bool m_valid{false};
+
+        // The timestamps of the last measurement.
+        mutable uint64_t m_lastStartTimestamp{0};
+        mutable uint64_t m_lastEndTimestamp{0};
+        mutable bool m_hasTimestamps{false};
     };
 
     class D3D12Device : public IDevice, public std::enable_shared_from_this<D3D12Device> {
       private:
-        // OpenXR will not allow more than 2 frames in-flight, so 2 would be sufficient, however we might split the
-        // processing in two due to text rendering, so multiply this number by 2.
-        static constexpr size_t NumInflightContexts = 4;
+        // OpenXR will not allow more than 2 frames in-flight, and each frame submits up to 3 command lists (the GPU
+        // timer in xrBeginFrame(), the text rendering and xrEndFrame()). A context is only reused once the GPU is done
+        // with it, so a smaller ring would only stall more often.
+        static constexpr size_t NumInflightContexts = 6;
 
       public:
         D3D12Device(ID3D12Device* device, ID3D12CommandQueue* queue) : m_device(device), m_queue(queue) {
@@ -727,19 +924,6 @@ namespace {
             m_dsvHeap.initialize(m_device.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
             m_rvHeap.initialize(m_device.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
             m_samplerHeap.initialize(m_device.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
-            {
-                D3D12_QUERY_HEAP_DESC desc;
-                ZeroMemory(&desc, sizeof(desc));
-                desc.Count = 16;
-                desc.NodeMask = 1;
-                desc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
-                m_device->CreateQueryHeap(&desc, IID_PPV_ARGS(&m_queryHeap));
-                m_queryHeap->SetName(L"Timestamp Query Heap");
-
-                uint64_t gpuFrequency;
-                m_queue->GetTimestampFrequency(&gpuFrequency);
-                m_gpuTickDelta = 1.0 / gpuFrequency;
-            }
             {
                 for (uint32_t i = 0; i < NumInflightContexts; i++) {
                     CHECK_HRCMD(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT,
@@ -781,6 +965,9 @@ namespace {
             }
 
             CHECK_HRCMD(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
+            m_timestampQueryPool =
+                std::make_shared<D3D12TimestampQueryPool>(m_device.Get(), m_queue.Get(), m_fence.Get());
+            m_profiler = CreateProfiler(*this);
 
             initializeShadingResources();
         }
@@ -796,6 +983,8 @@ namespace {
             m_currentDrawRenderTarget.reset();
             m_currentDrawDepthBuffer.reset();
             m_currentTextRenderTarget.reset();
+
+            m_profiler.reset();
         }
 
         Api getApi() const override {
@@ -849,25 +1038,28 @@ namespace {
         }
 
         void flushContext(bool blocking) override {
+            m_timestampQueryPool->resolve(m_context.Get());
             CHECK_HRCMD(m_context->Close());
 
             ID3D12CommandList* lists[] = {m_context.Get()};
             m_queue->ExecuteCommandLists(1, lists);
 
+            // The fence tells when the timestamps of the command list can be read, and when the context can be reused.
+            m_queue->Signal(m_fence.Get(), ++m_fenceValue);
+            m_timestampQueryPool->onSubmitted(m_fenceValue);
+            m_contextFenceValue[m_currentContext] = m_fenceValue;
+
             if (blocking) {
-                m_queue->Signal(m_fence.Get(), ++m_fenceValue);
-                if (m_fence->GetCompletedValue() < m_fenceValue) {
-                    HANDLE eventHandle = CreateEventEx(nullptr, L"flushContext Fence", 0, EVENT_ALL_ACCESS);
-                    CHECK_HRCMD(m_fence->SetEventOnCompletion(m_fenceValue, eventHandle));
-                    WaitForSingleObject(eventHandle, INFINITE);
-                    CloseHandle(eventHandle);
-                }
+                waitForFence(m_fenceValue);
             }
 
             m_currentContext++;
             if (m_currentContext == NumInflightContexts) {
                 m_currentContext = 0;
             }
+
+            // The command allocator cannot be reset while the GPU is still executing its commands.
+            waitForFence(m_contextFenceValue[m_currentContext]);
             CHECK_HRCMD(m_commandAllocator[m_currentContext]->Reset());
             CHECK_HRCMD(m_commandList[m_currentContext]->Reset(m_commandAllocator[m_currentContext].Get(), nullptr));
             m_context = m_commandList[m_currentContext];
@@ -1059,7 +1251,33 @@ namespace {
         }
 
         std::shared_ptr<IGpuTimer> createTimer() override {
-            return std::make_shared<D3D12GpuTimer>(shared_from_this());
+            return std::make_shared<D3D12GpuTimer>(shared_from_this(), m_timestampQueryPool, m_clockCalibration);
+        }
+
+        void calibrateTimers() override {
+            UINT64 gpuTimestamp;
+            UINT64 cpuTimestamp;
+            if (SUCCEEDED(m_queue->GetClockCalibration(&gpuTimestamp, &cpuTimestamp))) {
+                m_clockCalibration.gpuTimestamp = gpuTimestamp;
+                CHECK_HRCMD(m_queue->GetTimestampFrequency(&m_clockCalibration.gpuFrequency));
+                m_clockCalibration.cpuTimeUs = QpcToMicroseconds(cpuTimestamp);
+            }
+        }
+
+        ProfilingScopeId registerProfilingScope(const std::string& name) override {
+            return m_profiler->registerScope(name);
+        }
+
+        void pushProfilingScope(ProfilingScopeId id) override {
+            m_profiler->pushScope(id);
+        }
+
+        void popProfilingScope() override {
+            m_profiler->popScope();
+        }
+
+        const std::vector<ProfilingResult>& collectProfilingResults() override {
+            return m_profiler->nextFrame();
         }
 
         void setShader(std::shared_ptr<IQuadShader> shader) override {
@@ -1218,6 +1436,7 @@ namespace {
 
                     // The first time, we need to resolve the root signature and create the pipeline state.
                     if (d3d12Shader->needsResolve()) {
+                        ScopedStartupTimer startupTimer("D3D12 pipeline state resolve");
                         d3d12Shader->resolve();
                     }
                 }
@@ -1239,6 +1458,20 @@ namespace {
             }
         }
 
+        void setViewport(const XrRect2Di& viewport) override {
+            const auto d3dViewport = CD3DX12_VIEWPORT((float)viewport.offset.x,
+                                                      (float)viewport.offset.y,
+                                                      (float)viewport.extent.width,
+                                                      (float)viewport.extent.height);
+            m_context->RSSetViewports(1, &d3dViewport);
+
+            const auto scissorRect = CD3DX12_RECT(viewport.offset.x,
+                                                  viewport.offset.y,
+                                                  viewport.offset.x + viewport.extent.width,
+                                                  viewport.offset.y + viewport.extent.height);
+            m_context->RSSetScissorRects(1, &scissorRect);
+        }
+
         void unsetRenderTargets() override {
             m_context->OMSetRenderTargets(0, nullptr, true, nullptr);
 
@@ -1453,6 +1686,15 @@ namespace {
         }
 
       private:
+        void waitForFence(UINT64 fenceValue) {
+            if (m_fence->GetCompletedValue() < fenceValue) {
+                HANDLE eventHandle = CreateEventEx(nullptr, L"flushContext Fence", 0, EVENT_ALL_ACCESS);
+                CHECK_HRCMD(m_fence->SetEventOnCompletion(fenceValue, eventHandle));
+                WaitForSingleObject(eventHandle, INFINITE);
+                CloseHandle(eventHandle);
+            }
+        }
+
         // Initialize the resources needed for dispatchShader() and related calls.
         void initializeShadingResources() {
             {
@@ -1509,6 +1751,7 @@ namespace {
 
         ComPtr<ID3D12CommandAllocator> m_commandAllocator[NumInflightContexts];
         ComPtr<ID3D12GraphicsCommandList> m_commandList[NumInflightContexts];
+        UINT64 m_contextFenceValue[NumInflightContexts]{};
         uint32_t m_currentContext{0};
 
         ComPtr<ID3D12GraphicsCommandList> m_context;
@@ -1516,14 +1759,15 @@ namespace {
         D3D12Heap m_dsvHeap;
         D3D12Heap m_rvHeap;
         D3D12Heap m_samplerHeap;
-        ComPtr<ID3D12QueryHeap> m_queryHeap;
         ComPtr<ID3DBlob> m_quadVertexShaderBytes;
         D3D12_CPU_DESCRIPTOR_HANDLE m_linearClampSamplerPS;
         D3D12_CPU_DESCRIPTOR_HANDLE m_linearClampSamplerCS;
         ComPtr<ID3D12Fence> m_fence;
         UINT64 m_fenceValue{0};
 
-        double m_gpuTickDelta{0};
+        std::shared_ptr<D3D12TimestampQueryPool> m_timestampQueryPool;
+        ClockCalibration m_clockCalibration;
+        std::shared_ptr<IProfiler> m_profiler;
 
         std::shared_ptr<IDevice> m_textDevice;
         ComPtr<ID3D11On12Device> m_textInteropDevice;
@@ -3,6 +3,30 @@
 #include "pch.h"
 
 namespace toolkit::graphics::d3dcommon {
+    // The correlation between the GPU timestamps and the CPU clock.
+    struct ClockCalibration {
+        uint64_t gpuTimestamp{0};
+        uint64_t gpuFrequency{0};
+        uint64_t cpuTimeUs{0};
+
+        bool isValid() const {
+            return gpuFrequency != 0;
+        }
+
+        // Convert a GPU timestamp to microseconds on the QueryPerformanceCounter() clock.
+        uint64_t toCpuTimeUs(uint64_t timestamp) const {
+            const int64_t ticks = (int64_t)(timestamp - gpuTimestamp);
+            return cpuTimeUs + (int64_t)(ticks * 1e6 / gpuFrequency);
+        }
+    };
+
+    // Convert a QueryPerformanceCounter() value to microseconds.
+    inline uint64_t QpcToMicroseconds(uint64_t counter) {
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+        return (uint64_t)(counter * 1e6 / frequency.QuadPart);
+    }
+
     struct ModelConstantBuffer {
         DirectX::XMFLOAT4X4 Model;
     };
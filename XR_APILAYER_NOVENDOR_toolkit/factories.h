@@ -38,6 +38,30 @@ namespace toolkit {
 
         bool UpdateKeyState(bool& keyState, int vkModifier, int vkKey, bool isRepeat);
 
+        // The number of heap allocations made by the calling thread so far.
+        uint64_t GetAllocationCount();
+
+        std::shared_ptr<IFrameAnalyzer> CreateFrameAnalyzer(const std::optional<std::string>& recordFile);
+
+        std::shared_ptr<ILatencyHistogram> CreateLatencyHistogram(uint32_t windowCount);
+
+        std::shared_ptr<ITraceRecorder> CreateTraceRecorder();
+
+        std::shared_ptr<IFrameLogger> CreateFrameLogger(const std::string& path);
+
+        std::shared_ptr<ITelemetryPublisher>
+        CreateTelemetryPublisher(const std::string& applicationName, uint32_t displayWidth, uint32_t displayHeight);
+
+        std::shared_ptr<IFlightRecorder> CreateFlightRecorder(const std::string& pathPrefix, uint32_t thresholdPercent);
+
+        uint32_t BuildVisibilityMask(const std::vector<XrVector2f>& vertices,
+                                     const std::vector<uint32_t>& indices,
+                                     const XrFovf& fov,
+                                     uint32_t tilesX,
+                                     uint32_t tilesY,
+                                     uint32_t* visibleTiles,
+                                     std::vector<uint8_t>& scratch);
+
     } // namespace utilities
 
     namespace config {
@@ -48,6 +72,17 @@ namespace toolkit {
 
     namespace graphics {
 
+        // The region processed for one view, from the rectangle rendered by the application to the rectangle submitted
+        // to the runtime. The rectangle is scaled by the ratio between the runtime and application swapchains, so that
+        // the views packed in the same swapchain do not overlap. When the application renders at renderResolution,
+        // below the viewResolution that its swapchain was created for, the rectangle is upscaled to the whole view.
+        ViewRegion GetViewRegion(uint32_t view,
+                                 const XrRect2Di& imageRect,
+                                 const XrSwapchainCreateInfo& appInfo,
+                                 const XrSwapchainCreateInfo& runtimeInfo,
+                                 const XrExtent2Di& viewResolution = {},
+                                 const XrExtent2Di& renderResolution = {});
+
         std::shared_ptr<IDevice> WrapD3D11Device(ID3D11Device* device);
         std::shared_ptr<IDevice> WrapD3D11TextDevice(ID3D11Device* device);
         std::shared_ptr<ITexture> WrapD3D11Texture(std::shared_ptr<IDevice> device,
@@ -76,6 +111,10 @@ namespace toolkit {
                              std::shared_ptr<IDevice> graphicsDevice,
                              const std::string& shaderFile);
 
+        std::shared_ptr<IProcessingChain> CreateProcessingChain(std::shared_ptr<IDevice> graphicsDevice);
+
+        std::shared_ptr<IProfiler> CreateProfiler(IDevice& device);
+
     } // namespace graphics
 
     namespace input {
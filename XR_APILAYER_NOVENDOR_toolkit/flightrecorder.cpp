@@ -0,0 +1,273 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pch.h"
+
+#include "factories.h"
+#include "interfaces.h"
+#include "log.h"
+
+namespace {
+
+    using namespace toolkit;
+    using namespace toolkit::log;
+    using namespace toolkit::utilities;
+
+    using clock = std::chrono::steady_clock;
+
+    // The frames kept in memory. Must hold the frames before and after the trigger.
+    constexpr size_t RecordedFrames = 256;
+    constexpr size_t PreTriggerFrames = 90;
+    constexpr size_t PostTriggerFrames = 90;
+    static_assert(PreTriggerFrames + PostTriggerFrames < RecordedFrames);
+
+    // The frames used to compute the rolling median of the frame time.
+    constexpr size_t MedianFrames = 64;
+
+    // Keep the captures rare, in case the application stutters continuously.
+    constexpr uint32_t MaxCaptures = 10;
+    constexpr auto CaptureCooldown = std::chrono::seconds(10);
+
+    // The events are recorded from any thread, whether or not a flight recorder exists.
+    constexpr size_t RecordedEvents = 256;
+
+    struct EventSlot {
+        // Odd while the slot is being written, then 2 * (index + 1) once the event with this index is complete.
+        std::atomic<uint64_t> sequence{0};
+        uint64_t timeUs;
+        const char* name;
+    };
+
+    EventSlot g_events[RecordedEvents];
+    std::atomic<uint64_t> g_eventCount{0};
+
+    uint64_t nowUs() {
+        // The Windows implementation of the clock is based on QueryPerformanceCounter(), like the traces.
+        return std::chrono::duration_cast<std::chrono::microseconds>(clock::now().time_since_epoch()).count();
+    }
+
+    struct FrameEntry {
+        FrameLogRecord record;
+        uint64_t timeUs;
+        uint64_t frameTimeUs;
+        uint32_t missedFrames;
+    };
+
+    struct EventEntry {
+        uint64_t timeUs;
+        const char* name;
+    };
+
+    class FlightRecorder : public IFlightRecorder {
+      public:
+        FlightRecorder(const std::string& pathPrefix, uint32_t thresholdPercent)
+            : m_pathPrefix(pathPrefix), m_thresholdPercent(thresholdPercent) {
+            m_frames.resize(RecordedFrames);
+            m_frameTimes.reserve(MedianFrames);
+            m_scratch.reserve(MedianFrames);
+        }
+
+        ~FlightRecorder() override {
+            if (m_writer.joinable()) {
+                m_writer.join();
+            }
+        }
+
+        void recordFrame(const FrameLogRecord& record, uint32_t totalMissedFrames) override {
+            const auto now = clock::now();
+
+            auto& entry = m_frames[m_frameCount % RecordedFrames];
+            entry.record = record;
+            entry.timeUs = nowUs();
+            entry.frameTimeUs =
+                m_frameCount ? std::chrono::duration_cast<std::chrono::microseconds>(now - m_lastFrame).count() : 0;
+            entry.missedFrames = m_frameCount ? totalMissedFrames - m_lastMissedFrames : 0;
+            m_lastFrame = now;
+            m_lastMissedFrames = totalMissedFrames;
+            m_frameCount++;
+
+            if (m_triggerFrame) {
+                if (m_frameCount - m_triggerFrame.value() >= PostTriggerFrames) {
+                    writeCapture();
+                }
+            } else if (m_numCaptures < MaxCaptures && now - m_lastCapture >= CaptureCooldown) {
+                detectStutter(entry, now);
+            }
+
+            // The frame is only compared to the ones before it. There is no frame time for the first frame.
+            if (m_frameCount > 1) {
+                if (m_frameTimes.size() < MedianFrames) {
+                    m_frameTimes.push_back(entry.frameTimeUs);
+                } else {
+                    m_frameTimes[m_frameCount % MedianFrames] = entry.frameTimeUs;
+                }
+            }
+        }
+
+      private:
+        void detectStutter(const FrameEntry& entry, clock::time_point now) {
+            // Wait for the application to settle down.
+            if (m_frameTimes.size() < MedianFrames) {
+                return;
+            }
+
+            if (entry.missedFrames) {
+                m_triggerReason = fmt::format("{} missed frame(s)", entry.missedFrames);
+            } else {
+                m_scratch = m_frameTimes;
+                const auto median = m_scratch.begin() + m_scratch.size() / 2;
+                std::nth_element(m_scratch.begin(), median, m_scratch.end());
+                if (entry.frameTimeUs * 100 <= *median * m_thresholdPercent) {
+                    return;
+                }
+                m_triggerReason = fmt::format("frame time {}us, rolling median {}us", entry.frameTimeUs, *median);
+            }
+
+            m_triggerFrame = m_frameCount;
+            m_lastCapture = now;
+            m_numCaptures++;
+        }
+
+        void writeCapture() {
+            // The trigger frame is the last one recorded when the stutter was detected.
+            const uint64_t lastFrame = m_frameCount;
+            const uint64_t firstFrame =
+                m_triggerFrame.value() > PreTriggerFrames + 1 ? m_triggerFrame.value() - PreTriggerFrames - 1 : 0;
+            std::vector<FrameEntry> frames;
+            frames.reserve(lastFrame - firstFrame);
+            for (uint64_t i = firstFrame; i < lastFrame; i++) {
+                frames.push_back(m_frames[i % RecordedFrames]);
+            }
+
+            const uint64_t startUs = frames.front().timeUs - frames.front().frameTimeUs;
+            std::vector<EventEntry> events;
+            const uint64_t eventCount = g_eventCount.load(std::memory_order_acquire);
+            for (uint64_t i = eventCount > RecordedEvents ? eventCount - RecordedEvents : 0; i < eventCount; i++) {
+                const auto& slot = g_events[i % RecordedEvents];
+                const uint64_t expectedSequence = 2 * (i + 1);
+                if (slot.sequence.load(std::memory_order_acquire) != expectedSequence) {
+                    continue;
+                }
+                const EventEntry event{slot.timeUs, slot.name};
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.sequence.load(std::memory_order_relaxed) == expectedSequence && event.timeUs >= startUs) {
+                    events.push_back(event);
+                }
+            }
+
+            const std::time_t now = std::time(nullptr);
+            char datetime[1024];
+            std::strftime(datetime, sizeof(datetime), "%Y%m%d_%H%M%S", std::localtime(&now));
+            const std::string path = m_pathPrefix + datetime + "_stutter.json";
+            const uint64_t triggerFrame = frames[m_triggerFrame.value() - 1 - firstFrame].record.frameIndex;
+            Log("Stutter detected (%s), writing %s\n", m_triggerReason.c_str(), path.c_str());
+
+            // Write the file in the background, to avoid causing another stutter.
+            if (m_writer.joinable()) {
+                m_writer.join();
+            }
+            m_writer = std::thread([path,
+                                    reason = m_triggerReason,
+                                    triggerFrame,
+                                    frames = std::move(frames),
+                                    events = std::move(events)]() {
+                writeCaptureFile(path, reason, triggerFrame, frames, events);
+            });
+
+            m_triggerFrame.reset();
+        }
+
+        static void writeCaptureFile(const std::string& path,
+                                     const std::string& reason,
+                                     uint64_t triggerFrame,
+                                     const std::vector<FrameEntry>& frames,
+                                     const std::vector<EventEntry>& events) {
+            std::ofstream stream(path);
+            if (!stream.is_open()) {
+                Log("Failed to open %s\n", path.c_str());
+                return;
+            }
+
+            stream << "{\"reason\":\"" << reason << "\",\"trigger_frame\":" << triggerFrame << ",\n\"frames\":[";
+            for (size_t i = 0; i < frames.size(); i++) {
+                const auto& frame = frames[i];
+                stream << (i ? ",\n" : "\n") << "{\"frame\":" << frame.record.frameIndex
+                       << ",\"time_us\":" << frame.timeUs << ",\"frame_time_us\":" << frame.frameTimeUs
+                       << ",\"missed\":" << frame.missedFrames << ",\"latency_us\":[";
+                for (size_t j = 0; j < (size_t)LatencyMetric::MaxValue; j++) {
+                    stream << (j ? "," : "") << frame.record.latencyUs[j];
+                }
+                stream << "],\"allocations\":" << frame.record.endFrameAllocations
+                       << ",\"scaling_type\":" << frame.record.scalingType << ",\"scaling\":" << frame.record.scaling
+                       << "}";
+            }
+            stream << "\n],\n\"events\":[";
+            for (size_t i = 0; i < events.size(); i++) {
+                stream << (i ? ",\n" : "\n") << "{\"time_us\":" << events[i].timeUs << ",\"name\":\""
+                       << events[i].name << "\"}";
+            }
+            stream << "\n]}\n";
+        }
+
+        const std::string m_pathPrefix;
+        const uint32_t m_thresholdPercent;
+
+        std::vector<FrameEntry> m_frames;
+        uint64_t m_frameCount{0};
+        clock::time_point m_lastFrame;
+        uint32_t m_lastMissedFrames{0};
+
+        std::vector<uint64_t> m_frameTimes;
+        std::vector<uint64_t> m_scratch;
+
+        std::optional<uint64_t> m_triggerFrame;
+        std::string m_triggerReason;
+        clock::time_point m_lastCapture;
+        uint32_t m_numCaptures{0};
+
+        std::thread m_writer;
+    };
+
+} // namespace
+
+namespace toolkit::log {
+
+    void RecordEvent(const char* name) {
+        const uint64_t index = g_eventCount.fetch_add(1, std::memory_order_relaxed);
+        auto& slot = g_events[index % RecordedEvents];
+        slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.timeUs = nowUs();
+        slot.name = name;
+        slot.sequence.store(2 * (index + 1), std::memory_order_release);
+    }
+
+} // namespace toolkit::log
+
+namespace toolkit::utilities {
+
+    std::shared_ptr<IFlightRecorder> CreateFlightRecorder(const std::string& pathPrefix, uint32_t thresholdPercent) {
+        return std::make_shared<FlightRecorder>(pathPrefix, thresholdPercent);
+    }
+
+} // namespace toolkit::utilities
@@ -0,0 +1,150 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pch.h"
+
+#include "factories.h"
+#include "interfaces.h"
+#include "log.h"
+
+namespace {
+
+    using namespace toolkit;
+    using namespace toolkit::log;
+    using namespace toolkit::utilities;
+
+    // Enough for several seconds at 120Hz, in case the disk is slow.
+    constexpr size_t RingCapacity = 1024;
+
+    // The writer drains the ring periodically rather than being woken up by the frame thread.
+    constexpr auto DrainPeriod = std::chrono::milliseconds(100);
+
+    const char* const LatencyColumns[(size_t)LatencyMetric::MaxValue] = {"app_cpu",
+                                                                          "app_gpu",
+                                                                          "layer_cpu",
+                                                                          "pre_gpu",
+                                                                          "scale_gpu",
+                                                                          "post_gpu",
+                                                                          "overlay_cpu",
+                                                                          "overlay_gpu",
+                                                                          "prediction"};
+
+    class FrameLogger : public IFrameLogger {
+      public:
+        FrameLogger(const std::string& path) : m_ring(new FrameLogRecord[RingCapacity]) {
+            m_stream.open(path);
+            if (!m_stream.is_open()) {
+                Log("Failed to open %s\n", path.c_str());
+                return;
+            }
+
+            Log("Recording frame statistics to %s\n", path.c_str());
+            m_stream << "frame,display_time";
+            for (const auto column : LatencyColumns) {
+                m_stream << "," << column;
+            }
+            m_stream << ",allocations,scaling_type,scaling,sharpness\n";
+
+            m_writer = std::thread([this]() {
+                while (!m_stop) {
+                    drain();
+                    std::this_thread::sleep_for(DrainPeriod);
+                }
+                drain();
+            });
+        }
+
+        ~FrameLogger() override {
+            m_stop = true;
+            if (m_writer.joinable()) {
+                m_writer.join();
+            }
+
+            const uint64_t dropped = m_droppedRecords;
+            if (dropped) {
+                Log("Dropped %llu rows of frame statistics\n", dropped);
+            }
+        }
+
+        void log(const FrameLogRecord& record) override {
+            if (!m_stream.is_open()) {
+                return;
+            }
+
+            // There is a single producer (the frame thread) and a single consumer (the writer thread).
+            const uint64_t writeIndex = m_writeIndex.load(std::memory_order_relaxed);
+            if (writeIndex - m_readIndex.load(std::memory_order_acquire) >= RingCapacity) {
+                m_droppedRecords.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            m_ring[writeIndex % RingCapacity] = record;
+            m_writeIndex.store(writeIndex + 1, std::memory_order_release);
+        }
+
+        uint64_t getDroppedRecords() const override {
+            return m_droppedRecords;
+        }
+
+      private:
+        void drain() {
+            uint64_t readIndex = m_readIndex.load(std::memory_order_relaxed);
+            const uint64_t writeIndex = m_writeIndex.load(std::memory_order_acquire);
+            if (readIndex == writeIndex) {
+                return;
+            }
+
+            for (; readIndex != writeIndex; readIndex++) {
+                const FrameLogRecord record = m_ring[readIndex % RingCapacity];
+                m_readIndex.store(readIndex + 1, std::memory_order_release);
+
+                m_stream << record.frameIndex << "," << record.displayTime;
+                for (const auto latencyUs : record.latencyUs) {
+                    m_stream << "," << latencyUs;
+                }
+                m_stream << "," << record.endFrameAllocations << "," << record.scalingType << "," << record.scaling
+                         << "," << record.sharpness << "\n";
+            }
+            m_stream.flush();
+        }
+
+        std::ofstream m_stream;
+
+        std::unique_ptr<FrameLogRecord[]> m_ring;
+        std::atomic<uint64_t> m_writeIndex{0};
+        std::atomic<uint64_t> m_readIndex{0};
+        std::atomic<uint64_t> m_droppedRecords{0};
+
+        std::atomic<bool> m_stop{false};
+        std::thread m_writer;
+    };
+
+} // namespace
+
+namespace toolkit::utilities {
+
+    std::shared_ptr<IFrameLogger> CreateFrameLogger(const std::string& path) {
+        return std::make_shared<FrameLogger>(path);
+    }
+
+} // namespace toolkit::utilities
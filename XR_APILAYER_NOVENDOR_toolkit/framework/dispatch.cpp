@@ -41,6 +41,8 @@ namespace LAYER_NAMESPACE {
                                       XrInstance* const instance) {
         DebugLog("--> xrCreateApiLayerInstance\n");
 
+        ScopedStartupTimer startupTimer("xrCreateApiLayerInstance");
+
         if (!apiLayerInfo || apiLayerInfo->structType != XR_LOADER_INTERFACE_STRUCT_API_LAYER_CREATE_INFO ||
             apiLayerInfo->structVersion != XR_API_LAYER_CREATE_INFO_STRUCT_VERSION ||
             apiLayerInfo->structSize != sizeof(XrApiLayerCreateInfo) || !apiLayerInfo->nextInfo ||
@@ -62,7 +64,10 @@ namespace LAYER_NAMESPACE {
         // But first, we need to create a dummy instance in order to be able to perform these checks.
         bool hasHandTrackingExt = false;
         bool hasConvertPerformanceCounterTimeExt = false;
+        bool hasVisibilityMaskExt = false;
         if (!fastInitialization) {
+            ScopedStartupTimer bootstrapTimer("Bootstrap instance");
+
             XrInstance dummyInstance = XR_NULL_HANDLE;
             PFN_xrEnumerateInstanceExtensionProperties xrEnumerateInstanceExtensionProperties = nullptr;
             PFN_xrDestroyInstance xrDestroyInstance = nullptr;
@@ -107,6 +112,8 @@ namespace LAYER_NAMESPACE {
                         hasHandTrackingExt = true;
                     } else if (extensionName == "XR_KHR_win32_convert_performance_counter_time") {
                         hasConvertPerformanceCounterTimeExt = true;
+                    } else if (extensionName == "XR_KHR_visibility_mask") {
+                        hasVisibilityMaskExt = true;
                     }
                 }
             }
@@ -120,13 +127,23 @@ namespace LAYER_NAMESPACE {
         XrInstanceCreateInfo chainInstanceCreateInfo = *instanceCreateInfo;
         std::vector<const char*> newEnabledExtensionNames;
         if (!fastInitialization) {
-            if (hasHandTrackingExt || hasConvertPerformanceCounterTimeExt) {
+            // The application might already use the visibility mask for its own rendering.
+            for (uint32_t i = 0; i < instanceCreateInfo->enabledExtensionCount; i++) {
+                if (std::string(instanceCreateInfo->enabledExtensionNames[i]) == "XR_KHR_visibility_mask") {
+                    hasVisibilityMaskExt = false;
+                }
+            }
+
+            if (hasHandTrackingExt || hasConvertPerformanceCounterTimeExt || hasVisibilityMaskExt) {
                 if (hasHandTrackingExt) {
                     chainInstanceCreateInfo.enabledExtensionCount++;
                 }
                 if (hasConvertPerformanceCounterTimeExt) {
                     chainInstanceCreateInfo.enabledExtensionCount++;
                 }
+                if (hasVisibilityMaskExt) {
+                    chainInstanceCreateInfo.enabledExtensionCount++;
+                }
 
                 newEnabledExtensionNames.resize(chainInstanceCreateInfo.enabledExtensionCount);
                 chainInstanceCreateInfo.enabledExtensionNames = newEnabledExtensionNames.data();
@@ -144,6 +161,9 @@ namespace LAYER_NAMESPACE {
                 if (hasConvertPerformanceCounterTimeExt) {
                     newEnabledExtensionNames[nextExtensionSlot++] = "XR_KHR_win32_convert_performance_counter_time";
                 }
+                if (hasVisibilityMaskExt) {
+                    newEnabledExtensionNames[nextExtensionSlot++] = "XR_KHR_visibility_mask";
+                }
             }
         }
 
@@ -178,6 +198,10 @@ namespace LAYER_NAMESPACE {
                 Log("%s\n", exc.what());
             }
 
+            if (XR_SUCCEEDED(result)) {
+                InstallCrashHandler();
+            }
+
             // Cleanup attempt before returning an error.
             if (XR_FAILED(result)) {
                 PFN_xrDestroyInstance xrDestroyInstance = nullptr;
@@ -210,6 +234,11 @@ namespace LAYER_NAMESPACE {
 
         DebugLog("<-- xrDestroyInstance %d\n", result);
 
+        // The DLL might be unloaded after this call. Stop the writer thread now, since it cannot be joined during the
+        // unloading.
+        RemoveCrashHandler();
+        FlushLog();
+
         return result;
     }
 
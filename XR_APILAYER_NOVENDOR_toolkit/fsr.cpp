@@ -50,6 +50,7 @@ namespace {
         uint32_t Const2[4];
         uint32_t Const3[4];
         uint32_t Const4[4];
+        uint32_t Const5[4];
     };
 
     class FSRUpscaler : public IUpscaler {
@@ -60,78 +61,148 @@ namespace {
                     uint32_t outputHeight)
             : m_configManager(configManager), m_device(graphicsDevice), m_outputWidth(outputWidth),
               m_outputHeight(outputHeight) {
-            // The upscaling factor is only read upon initialization of the session. It cannot be changed after.
-            std::tie(m_inputWidth, m_inputHeight) = utilities::GetScaledDimensions(
-                m_outputWidth, m_outputHeight, configManager->getValue(SettingScaling), 2);
-
-            if (m_inputWidth != m_outputWidth || m_inputHeight != m_outputHeight) {
-                initializeScaler();
-            } else {
-                initializeSharpen();
-            }
+            m_sharpness = m_configManager->getSnapshot().getValue(SettingId::Sharpness);
+            m_noSharpening = m_sharpness == 0;
+
+            initializeShaders();
 
+            // Each view has its own constants, since they are both uploaded within the same frame.
             // TODO: Consider making immutable and create a new buffer in update(). For now, our D3D12 implementation
             // does not do heap descriptor recycling.
-            m_configBuffer = m_device->createBuffer(sizeof(FSRConstants), "FSR Constants CB");
-            update();
-        }
+            for (uint32_t i = 0; i < ViewCount; i++) {
+                m_views[i].configBuffer =
+                    m_device->createBuffer(sizeof(FSRConstants), fmt::format("FSR Constants {} CB", i));
+                m_views[i].easuScope = m_device->registerProfilingScope(fmt::format("EASU eye{}", i));
+                m_views[i].rcasScope = m_device->registerProfilingScope(fmt::format("RCAS eye{}", i));
+            }
+            m_scope = m_device->registerProfilingScope("FSR");
 
-        void update() override {
-            if (m_configManager->hasChanged(SettingSharpness)) {
-                const auto sharpness = m_configManager->getValue(SettingSharpness) / 100.f;
-                const auto attenuation = 1.f - AClampF1(sharpness, 0, 1);
-
-                FSRConstants config = {};
-                if (!m_isSharpenOnly) {
-                    FsrEasuCon(config.Const0,
-                               config.Const1,
-                               config.Const2,
-                               config.Const3,
-                               static_cast<AF1>(m_inputWidth),
-                               static_cast<AF1>(m_inputHeight),
-                               static_cast<AF1>(m_inputWidth),
-                               static_cast<AF1>(m_inputHeight),
-                               static_cast<AF1>(m_outputWidth),
-                               static_cast<AF1>(m_outputHeight));
-                }
+            // The intermediary only holds one view, the output viewport is applied when sharpening.
+            initializeIntermediary(m_outputWidth, m_outputHeight, 0 /* format */);
+        }
 
-                FsrRcasCon(config.Const4, static_cast<AF1>(attenuation));
+        StageRequirements getRequirements() const override {
+            StageRequirements requirements;
+            requirements.outputWidth = m_outputWidth;
+            requirements.outputHeight = m_outputHeight;
+            requirements.outputUsage = XR_SWAPCHAIN_USAGE_UNORDERED_ACCESS_BIT;
+            return requirements;
+        }
 
-                // TODO:
-                // The AMD FSR sample is using a value in the constant buffer to correct the output color accordingly.
-                // We're replacing the constant with a shader compilation define because the project code is not HDR
-                // aware yet, When we'll be supporting HDR, we might need to change the implementation back to something
-                // like:
-                //
-                // config.Const4[3] = hdr ? 1 : 0;
+        bool isIdentity() const override {
+            // Without any scaling, the only effect is the sharpening.
+            return m_noSharpening;
+        }
 
-                m_configBuffer->uploadData(&config, sizeof(config));
+        void update(const SettingsSnapshot& settings) override {
+            // The constants are uploaded with the next frame, once the input resolution is known.
+            const int sharpness = settings.getValue(SettingId::Sharpness);
+            if (sharpness != m_sharpness) {
+                m_sharpness = sharpness;
+                m_noSharpening = m_sharpness == 0;
+                for (auto& view : m_views) {
+                    view.needConfigUpdate = true;
+                }
             }
         }
 
-        void upscale(std::shared_ptr<ITexture> input, std::shared_ptr<ITexture> output, int32_t slice = -1) override {
-            if (!m_intermediary) {
-                const auto& infos = output->getInfo();
-                initializeIntermediary(infos.width, infos.height, 0 /* infos.format */);
+        void upscale(const std::shared_ptr<ITexture>& input,
+                     const std::shared_ptr<ITexture>& output,
+                     const ViewRegion& region,
+                     const std::shared_ptr<IShaderBuffer>& visibilityMask,
+                     int32_t slice = -1) override {
+            auto& view = m_views[region.view];
+            if (view.needConfigUpdate || memcmp(&region.input, &view.input, sizeof(XrRect2Di)) ||
+                memcmp(&region.output, &view.output, sizeof(XrRect2Di)) ||
+                input->getInfo().width != view.inputTextureWidth ||
+                input->getInfo().height != view.inputTextureHeight) {
+                view.input = region.input;
+                view.output = region.output;
+                view.inputTextureWidth = input->getInfo().width;
+                view.inputTextureHeight = input->getInfo().height;
+                updateConfig(view);
             }
 
+            ScopedProfiling scope(*m_device, m_scope);
+
             if (!m_isSharpenOnly) {
+                ScopedProfiling easuScope(*m_device, view.easuScope);
                 m_device->setShader(m_shaderEASU);
-                m_device->setShaderInput(0, m_configBuffer);
+                m_device->setShaderInput(0, view.configBuffer);
+                m_device->setShaderInput(1, visibilityMask);
                 m_device->setShaderInput(0, input, slice);
                 m_device->setShaderOutput(0, m_intermediary);
                 m_device->dispatchShader();
             }
 
+            ScopedProfiling rcasScope(*m_device, view.rcasScope);
             m_device->setShader(m_shaderRCAS);
-            m_device->setShaderInput(0, m_configBuffer);
+            m_device->setShaderInput(0, view.configBuffer);
+            m_device->setShaderInput(1, visibilityMask);
             m_device->setShaderInput(0, m_isSharpenOnly ? input : m_intermediary);
             m_device->setShaderOutput(0, output, slice);
             m_device->dispatchShader();
         }
 
       private:
-        void initializeScaler() {
+        // The regions processed for a view, and the constants derived from them.
+        struct ViewState {
+            XrRect2Di input{};
+            XrRect2Di output{};
+            uint32_t inputTextureWidth{0};
+            uint32_t inputTextureHeight{0};
+            bool needConfigUpdate{true};
+            std::shared_ptr<IShaderBuffer> configBuffer;
+            ProfilingScopeId easuScope;
+            ProfilingScopeId rcasScope;
+        };
+
+        void updateConfig(ViewState& view) {
+            const auto sharpness = m_sharpness / 100.f;
+            const auto attenuation = 1.f - AClampF1(sharpness, 0, 1);
+
+            FSRConstants config = {};
+            if (!m_isSharpenOnly) {
+                FsrEasuCon(config.Const0,
+                           config.Const1,
+                           config.Const2,
+                           config.Const3,
+                           static_cast<AF1>(view.input.extent.width),
+                           static_cast<AF1>(view.input.extent.height),
+                           static_cast<AF1>(view.inputTextureWidth),
+                           static_cast<AF1>(view.inputTextureHeight),
+                           static_cast<AF1>(view.output.extent.width),
+                           static_cast<AF1>(view.output.extent.height));
+
+                // FsrEasuCon() assumes that the input viewport starts at the origin of the texture. Move the position
+                // of the input pixels (in pixels of the input texture) by the offset of the viewport.
+                float inputOffset[2];
+                memcpy(inputOffset, &config.Const0[2], sizeof(inputOffset));
+                inputOffset[0] += view.input.offset.x;
+                inputOffset[1] += view.input.offset.y;
+                memcpy(&config.Const0[2], inputOffset, sizeof(inputOffset));
+            }
+
+            FsrRcasCon(config.Const4, static_cast<AF1>(attenuation));
+
+            config.Const5[0] = view.output.offset.x;
+            config.Const5[1] = view.output.offset.y;
+            config.Const5[2] = view.output.extent.width;
+            config.Const5[3] = view.output.extent.height;
+
+            // TODO:
+            // The AMD FSR sample is using a value in the constant buffer to correct the output color accordingly.
+            // We're replacing the constant with a shader compilation define because the project code is not HDR
+            // aware yet, When we'll be supporting HDR, we might need to change the implementation back to something
+            // like:
+            //
+            // config.Const4[3] = hdr ? 1 : 0;
+
+            view.configBuffer->uploadData(&config, sizeof(config));
+            view.needConfigUpdate = false;
+        }
+
+        void initializeShaders() {
             const auto shadersDir = std::filesystem::path(dllHome) / std::filesystem::path("shaders");
             const auto shaderPath = shadersDir / std::filesystem::path("FSR.hlsl");
 
@@ -161,18 +232,10 @@ namespace {
             m_shaderRCAS = m_device->createComputeShader(
                 shaderPath.string(), "mainCS", "FSR RCAS CS", threadGroups, defines.get(), shadersDir.string());
 
-            m_isSharpenOnly = false;
-        }
-
-        void initializeSharpen() {
             // TODO:
             // AMD offers 2 libs: FSR and CAS. The former does both, the latter seems to be designed for the sharpen
             // only case. Right now the code is using the "RCAS" half of FSR for the Sharpen only case but it is
             // untested/unvalidated yet. m_isSharpenOnly = true;
-
-            initializeScaler();
-
-            // m_isSharpenOnly = true;
         }
 
         void initializeIntermediary(uint32_t width, uint32_t height, int64_t format) {
@@ -181,11 +244,16 @@ namespace {
                 format = m_device->getTextureFormat(TextureFormat::R16G16B16A16_UNORM);
             }
 
-            DebugLog("FSRUpscaler initializeIntermediary with %u, %u, %u\n", width, height, format);
+            LOG_CHANNEL(Channel::Graphics,
+                        Verbosity::Verbose,
+                        "FSRUpscaler initializeIntermediary with %u, %u, %u\n",
+                        width,
+                        height,
+                        format);
 
             if (m_device->isTextureFormatSRGB(format)) {
                 format = DXGI_FORMAT_R8G8B8A8_UNORM;
-                DebugLog("  sRGB output format changed to: %u\n", format);
+                LOG_CHANNEL(Channel::Graphics, Verbosity::Verbose, "  sRGB output format changed to: %u\n", format);
             }
 
             // create the intermediary texture between upscale and sharpen pass
@@ -206,13 +274,15 @@ namespace {
         const uint32_t m_outputWidth;
         const uint32_t m_outputHeight;
 
-        uint32_t m_inputWidth;
-        uint32_t m_inputHeight;
+        ViewState m_views[ViewCount];
+        ProfilingScopeId m_scope;
+        int m_sharpness{0};
+        bool m_noSharpening{false};
         bool m_isSharpenOnly{false};
 
+        // The thread groups cover the resolution of one view.
         std::shared_ptr<IComputeShader> m_shaderEASU;
         std::shared_ptr<IComputeShader> m_shaderRCAS;
-        std::shared_ptr<IShaderBuffer> m_configBuffer;
         std::shared_ptr<ITexture> m_intermediary;
     };
 
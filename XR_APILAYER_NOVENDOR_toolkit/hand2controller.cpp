@@ -267,7 +267,7 @@ namespace {
 
             actionSpace.poseInActionSpace = poseInActionSpace;
 
-            DebugLog("Simulating action space %s\n", path.c_str());
+            LOG_CHANNEL(Channel::HandTracking, Verbosity::Verbose, "Simulating action space %s\n", path.c_str());
             m_actionSpaces.insert_or_assign(space, actionSpace);
         }
 
@@ -317,7 +317,8 @@ namespace {
                     SubAction subAction;
                     subAction.hand = hand;
                     subAction.path = fullPath;
-                    DebugLog("Simulating action path %s\n", fullPath.c_str());
+                    LOG_CHANNEL(
+                        Channel::HandTracking, Verbosity::Verbose, "Simulating action path %s\n", fullPath.c_str());
                     entry.subActions.insert_or_assign(subActionPath, subAction);
                 }
             }
@@ -415,7 +416,7 @@ namespace {
 
             // Inhibit one and or the other if request. The config file acts as a global override.
             const auto handTrackingEnabled =
-                m_configManager->getEnumValue<HandTrackingEnabled>(SettingHandTrackingEnabled);
+                m_configManager->getEnumValue<HandTrackingEnabled>(SettingId::HandTrackingEnabled);
             m_leftHandEnabled = m_config.leftHandEnabled && (handTrackingEnabled == HandTrackingEnabled::Both ||
                                                              handTrackingEnabled == HandTrackingEnabled::Left);
             m_rightHandEnabled = m_config.rightHandEnabled && (handTrackingEnabled == HandTrackingEnabled::Both ||
@@ -502,9 +503,9 @@ namespace {
 
         void render(const XrPosef& pose,
                     XrSpace baseSpace,
-                    std::shared_ptr<graphics::ITexture> renderTarget) const override {
+                    const std::shared_ptr<graphics::ITexture>& renderTarget) const override {
             // TODO: Support opacity.
-            const int meshIndex = m_configManager->getValue(SettingHandVisibilityAndSkinTone) - 1;
+            const int meshIndex = m_configManager->getValue(SettingId::HandVisibilityAndSkinTone) - 1;
             if (meshIndex < 0) {
                 return;
             }
@@ -956,13 +957,13 @@ namespace {
 
 #undef PARSE_ACTION
                 else {
-                    Log("L%u: Unrecognized option\n", lineNumber);
+                    LOG_CHANNEL(Channel::HandTracking, Verbosity::Info, "L%u: Unrecognized option\n", lineNumber);
                 }
             } else {
-                Log("L%u: Improperly formatted option\n", lineNumber);
+                LOG_CHANNEL(Channel::HandTracking, Verbosity::Info, "L%u: Improperly formatted option\n", lineNumber);
             }
         } catch (...) {
-            Log("L%u: Parsing error\n", lineNumber);
+            LOG_CHANNEL(Channel::HandTracking, Verbosity::Info, "L%u: Parsing error\n", lineNumber);
         }
     }
 
@@ -0,0 +1,147 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pch.h"
+
+#include "factories.h"
+#include "interfaces.h"
+
+namespace {
+
+    using namespace toolkit;
+    using namespace toolkit::utilities;
+
+    // Each power of two is split into 32 buckets, which bounds the error to about 1.6% of the value.
+    constexpr uint32_t SubBucketBits = 5;
+    constexpr uint32_t SubBucketCount = 1 << SubBucketBits;
+
+    // Values are clamped to about 67 seconds.
+    constexpr uint32_t ValueBits = 26;
+    constexpr uint64_t MaxValue = (1ull << ValueBits) - 1;
+    constexpr uint32_t BucketCount = (ValueBits - SubBucketBits + 1) * SubBucketCount;
+
+    class LatencyHistogram : public ILatencyHistogram {
+      public:
+        LatencyHistogram(uint32_t windowCount) : m_windows(std::max(windowCount, 1u)) {
+            for (auto& bucket : m_buckets) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        void record(uint64_t valueUs) override {
+            const uint64_t value = std::min(valueUs, MaxValue);
+            m_buckets[getBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+
+            uint64_t max = m_max.load(std::memory_order_relaxed);
+            while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+            }
+        }
+
+        FrameTimePercentiles computePercentiles() override {
+            // Take the counts and start a new window. Values recorded concurrently land in either window. The counts
+            // replace the ones of the oldest window in the running sum.
+            Window& window = m_windows[m_nextWindow];
+            m_nextWindow = (m_nextWindow + 1) % m_windows.size();
+            uint64_t total = 0;
+            for (uint32_t i = 0; i < BucketCount; i++) {
+                const uint32_t count = m_buckets[i].exchange(0, std::memory_order_relaxed);
+                m_counts[i] = m_counts[i] - window.counts[i] + count;
+                window.counts[i] = count;
+                total += m_counts[i];
+            }
+            window.max = m_max.exchange(0, std::memory_order_relaxed);
+
+            uint64_t max = 0;
+            for (const auto& entry : m_windows) {
+                max = std::max(max, entry.max);
+            }
+
+            FrameTimePercentiles percentiles;
+            if (!total) {
+                return percentiles;
+            }
+
+            const uint64_t ranks[] = {(total - 1) * 50 / 100, (total - 1) * 95 / 100, (total - 1) * 99 / 100};
+            uint64_t* results[] = {&percentiles.p50, &percentiles.p95, &percentiles.p99};
+            uint64_t seen = 0;
+            size_t next = 0;
+            for (uint32_t i = 0; i < BucketCount && next < std::size(ranks); i++) {
+                seen += m_counts[i];
+                while (next < std::size(ranks) && ranks[next] < seen) {
+                    // The percentiles cannot exceed the exact maximum.
+                    *results[next++] = std::min(getBucketValue(i), max);
+                }
+            }
+            percentiles.max = max;
+
+            return percentiles;
+        }
+
+      private:
+        // The first 2 powers of two are exact, then each power of two is split into the same number of buckets.
+        static uint32_t getBucketIndex(uint64_t value) {
+            if (value < 2 * SubBucketCount) {
+                return (uint32_t)value;
+            }
+
+            uint32_t msb = SubBucketBits + 1;
+            while (value >> (msb + 1)) {
+                msb++;
+            }
+            const uint32_t shift = msb - SubBucketBits;
+            return shift * SubBucketCount + (uint32_t)(value >> shift);
+        }
+
+        // The middle of the range covered by a bucket.
+        static uint64_t getBucketValue(uint32_t index) {
+            if (index < 2 * SubBucketCount) {
+                return index;
+            }
+
+            const uint32_t shift = index / SubBucketCount - 1;
+            const uint64_t lowest = (uint64_t)(index - shift * SubBucketCount) << shift;
+            return lowest + ((1ull << shift) >> 1);
+        }
+
+        std::atomic<uint32_t> m_buckets[BucketCount];
+        std::atomic<uint64_t> m_max{0};
+
+        // The counts of the last windows, and their sum. Only used while computing the percentiles.
+        struct Window {
+            uint32_t counts[BucketCount]{};
+            uint64_t max{0};
+        };
+        std::vector<Window> m_windows;
+        size_t m_nextWindow{0};
+        uint64_t m_counts[BucketCount]{};
+    };
+
+} // namespace
+
+namespace toolkit::utilities {
+
+    std::shared_ptr<ILatencyHistogram> CreateLatencyHistogram(uint32_t windowCount) {
+        return std::make_shared<LatencyHistogram>(windowCount);
+    }
+
+} // namespace toolkit::utilities
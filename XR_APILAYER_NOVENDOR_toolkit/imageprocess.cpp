@@ -60,29 +60,76 @@ namespace {
 
             // TODO: For now, we're going to require that all image processing shaders share the same configuration
             // structure.
-            m_configBuffer = m_device->createBuffer(sizeof(PostProcessConfig), "Post-process Configuration CB");
+            // Each view has its own configuration, since they are both uploaded within the same frame.
+            for (uint32_t i = 0; i < ViewCount; i++) {
+                m_views[i].configBuffer = m_device->createBuffer(sizeof(PostProcessConfig),
+                                                                 fmt::format("Post-process Configuration {} CB", i));
+                m_views[i].scope = m_device->registerProfilingScope(fmt::format("eye{}", i));
+            }
         }
 
-        void update() override {
-            // TODO: Future usage: check configManager, then upload new parameters to m_configBuffer.
+        StageRequirements getRequirements() const override {
+            // We render a quad at the resolution of the input.
+            return {};
         }
 
-        void process(std::shared_ptr<ITexture> input, std::shared_ptr<ITexture> output, int32_t slice) override {
+        bool isIdentity() const override {
+            // For now, our shader only does a copy.
+            return true;
+        }
+
+        void update(const SettingsSnapshot& settings) override {
+            // TODO: Future usage: check the settings, then upload new parameters to the configuration buffers.
+        }
+
+        void process(const std::shared_ptr<ITexture>& input,
+                     const std::shared_ptr<ITexture>& output,
+                     const ViewRegion& region,
+                     const std::shared_ptr<IShaderBuffer>& visibilityMask,
+                     int32_t slice) override {
+            auto& view = m_views[region.view];
+            if (memcmp(&region.input, &view.input, sizeof(XrRect2Di)) ||
+                input->getInfo().width != view.inputTextureWidth ||
+                input->getInfo().height != view.inputTextureHeight) {
+                view.input = region.input;
+                view.inputTextureWidth = input->getInfo().width;
+                view.inputTextureHeight = input->getInfo().height;
+
+                PostProcessConfig config{};
+                config.SourceOffsetX = (float)view.input.offset.x / view.inputTextureWidth;
+                config.SourceOffsetY = (float)view.input.offset.y / view.inputTextureHeight;
+                config.SourceScaleX = (float)view.input.extent.width / view.inputTextureWidth;
+                config.SourceScaleY = (float)view.input.extent.height / view.inputTextureHeight;
+                view.configBuffer->uploadData(&config, sizeof(config));
+            }
+
+            ScopedProfiling scope(*m_device, view.scope);
             m_device->setShader(!input->isArray() ? m_shader : m_shaderVPRT);
-            m_device->setShaderInput(0, m_configBuffer);
+            m_device->setShaderInput(0, view.configBuffer);
+            m_device->setShaderInput(1, visibilityMask);
             m_device->setShaderInput(0, input, slice);
             m_device->setShaderOutput(0, output, slice);
+            m_device->setViewport(region.output);
 
             m_device->dispatchShader();
         }
 
       private:
+        // The region of the input processed for a view, and the configuration derived from it.
+        struct ViewState {
+            XrRect2Di input{};
+            uint32_t inputTextureWidth{0};
+            uint32_t inputTextureHeight{0};
+            std::shared_ptr<IShaderBuffer> configBuffer;
+            ProfilingScopeId scope;
+        };
+
         const std::shared_ptr<IConfigManager> m_configManager;
         const std::shared_ptr<IDevice> m_device;
 
         std::shared_ptr<IQuadShader> m_shader;
         std::shared_ptr<IQuadShader> m_shaderVPRT;
-        std::shared_ptr<IShaderBuffer> m_configBuffer;
+        ViewState m_views[ViewCount];
     };
 
 } // namespace
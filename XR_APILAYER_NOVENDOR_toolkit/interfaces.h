@@ -22,8 +22,56 @@
 
 #pragma once
 
+#include "log.h"
+
 namespace toolkit {
 
+    // Percentiles of a frame timing, in microseconds.
+    struct FrameTimePercentiles {
+        uint64_t p50{0};
+        uint64_t p95{0};
+        uint64_t p99{0};
+        uint64_t max{0};
+    };
+
+    struct FramePacingStatistics {
+        // Time blocked in xrWaitFrame().
+        FrameTimePercentiles waitFrameUs;
+        // Time between xrWaitFrame() returning and xrBeginFrame().
+        FrameTimePercentiles waitToBeginUs;
+        // Time between xrBeginFrame() and xrEndFrame() (the application CPU time).
+        FrameTimePercentiles beginToEndUs;
+        // Time spent by the layer in xrEndFrame().
+        FrameTimePercentiles endFrameUs;
+        FrameTimePercentiles displayPeriodUs;
+        uint32_t missedFrames{0};
+    };
+
+    // The latencies recorded for each frame.
+    enum class LatencyMetric {
+        AppCpu = 0,
+        AppGpu,
+        EndFrameCpu,
+        PreProcessorGpu,
+        UpscalerGpu,
+        PostProcessorGpu,
+        OverlayCpu,
+        OverlayGpu,
+        Prediction,
+        MaxValue
+    };
+
+    // The most profiling scopes shown in the statistics.
+    constexpr size_t MaxProfilingScopes = 32;
+
+    // The average time spent in a profiling scope during the last statistics window.
+    struct ProfilingStatistics {
+        char path[64];
+        uint32_t depth;
+        uint64_t cpuTimeUs;
+        uint64_t gpuTimeUs;
+    };
+
     struct LayerStatistics {
         float fps{0.0f};
         uint64_t appCpuTimeUs{0};
@@ -36,51 +84,262 @@ namespace toolkit {
         uint64_t overlayGpuTimeUs{0};
 
         uint64_t predictionTimeUs{0};
+
+        // Number of heap allocations made by the layer in xrEndFrame() during the last statistics window.
+        uint64_t endFrameAllocations{0};
+
+        // Video memory saved by sharing intermediate textures.
+        uint64_t memorySavedMB{0};
+
+        // Whether the upscaler writes the runtime texture of a swapchain, so it cannot be turned off until restarting.
+        bool isUpscalingBypassIgnored{false};
+
+        // The upscaling factor applied to the rectangle rendered by the application, in percent.
+        uint32_t appliedScaling{0};
+
+        // Number of GPU measurements left out of the statistics because their result was not available in time.
+        uint32_t lateGpuResults{0};
+
+        FramePacingStatistics pacing;
+
+        // The distribution of the latencies during the last statistics window.
+        FrameTimePercentiles latency[(size_t)LatencyMetric::MaxValue];
+
+        ProfilingStatistics scopes[MaxProfilingScopes];
+        uint32_t numScopes{0};
     };
 
-    namespace {
+    // A generic timer.
+    struct ITimer {
+        virtual ~ITimer() = default;
 
-        // A generic timer.
-        struct ITimer {
-            virtual ~ITimer() = default;
+        virtual void start() = 0;
+        virtual void stop() = 0;
 
-            virtual void start() = 0;
-            virtual void stop() = 0;
+        // Retrieve the start and end of the last completed measurement, in microseconds on the
+        // QueryPerformanceCounter() clock. GPU measurements complete when query() returns them. Each measurement
+        // can only be retrieved once.
+        virtual bool consumeTimestamps(uint64_t& startUs, uint64_t& endUs) = 0;
+    };
 
+    namespace utilities {
+
+        // A CPU synchronous timer.
+        struct ICpuTimer : public ITimer {
             virtual uint64_t query(bool reset = true) const = 0;
         };
 
-    } // namespace
+        // A histogram of latencies with a fixed memory footprint.
+        struct ILatencyHistogram {
+            virtual ~ILatencyHistogram() = default;
 
-    namespace utilities {
+            // Record a value in microseconds. This can be called from any thread without locking.
+            virtual void record(uint64_t valueUs) = 0;
 
-        // A CPU synchronous timer.
-        struct ICpuTimer : public ITimer {};
+            // Compute the percentiles of the values recorded during the last windows, and start a new window. Each call
+            // closes a window, and the number of windows covered is given upon creation.
+            virtual FrameTimePercentiles computePercentiles() = 0;
+        };
+
+        // The measurements of one frame, for the performance log.
+        struct FrameLogRecord {
+            uint64_t frameIndex{0};
+            XrTime displayTime{0};
+            uint64_t latencyUs[(size_t)LatencyMetric::MaxValue]{};
+
+            // The heap allocations made by the layer in xrEndFrame() for the previous frame.
+            uint64_t endFrameAllocations{0};
+
+            // The scaling settings in use.
+            uint32_t scalingType{0};
+            uint32_t scaling{0};
+            uint32_t sharpness{0};
+        };
+
+        // A log of the measurements of each frame, written to a CSV file by a background thread.
+        struct IFrameLogger {
+            virtual ~IFrameLogger() = default;
+
+            // Queue a row for writing. This never blocks: the row is dropped when the queue is full.
+            virtual void log(const FrameLogRecord& record) = 0;
+
+            // The number of rows dropped so far.
+            virtual uint64_t getDroppedRecords() const = 0;
+        };
+
+        // A live feed of the measurements of each frame, in shared memory for external monitoring tools (see
+        // telemetry.h).
+        struct ITelemetryPublisher {
+            virtual ~ITelemetryPublisher() = default;
+
+            // Publish the measurements of a frame. This never blocks, even when a reader is copying a record.
+            virtual void publish(const FrameLogRecord& record,
+                                 uint32_t renderWidth,
+                                 uint32_t renderHeight,
+                                 uint32_t missedFrames) = 0;
+        };
+
+        // A recorder keeping the last frames in memory, and writing them to a file along with the surrounding events
+        // (see log::RecordEvent()) when a frame takes much longer than the recent ones or when frames are missed.
+        struct IFlightRecorder {
+            virtual ~IFlightRecorder() = default;
+
+            // Record the measurements of a frame and check it for a stutter. This never blocks.
+            virtual void recordFrame(const FrameLogRecord& record, uint32_t totalMissedFrames) = 0;
+        };
+
+        // A recorder for the timeline of the CPU and GPU work, written in the Chrome trace event format.
+        struct ITraceRecorder {
+            virtual ~ITraceRecorder() = default;
+
+            // Record all events for the given duration. The trace is written to the file once the capture ends.
+            virtual void startCapture(const std::string& path, uint32_t durationSeconds) = 0;
+            virtual bool isCapturing() const = 0;
+
+            // Add an event, with timestamps in microseconds on the QueryPerformanceCounter() clock. The CPU events are
+            // attributed to the calling thread. This can be called from any thread.
+            virtual void addCpuEvent(const char* name, uint64_t startUs, uint64_t endUs) = 0;
+            virtual void addGpuEvent(const char* name, uint64_t startUs, uint64_t endUs) = 0;
+
+            // End the capture once its duration has elapsed.
+            virtual void update() = 0;
+        };
+
+        // A recorder for the timeline of the frame loop.
+        struct IFrameAnalyzer {
+            virtual ~IFrameAnalyzer() = default;
+
+            // The frames are identified by the display time returned to the application by xrWaitFrame(), which may
+            // be called from a different thread.
+            virtual void onWaitFrameStart() = 0;
+            virtual void onWaitFrameEnd(XrTime frameTime,
+                                        XrTime predictedDisplayTime,
+                                        XrDuration predictedDisplayPeriod) = 0;
+            virtual void onBeginFrame() = 0;
+            virtual void onEndFrameStart(XrTime frameTime) = 0;
+            virtual void onEndFrameEnd(XrTime frameTime) = 0;
+
+            // Compute the statistics for the frames recorded since the last call.
+            virtual FramePacingStatistics computeStatistics() = 0;
+
+            // The frames missed since the analyzer was created.
+            virtual uint32_t getTotalMissedFrames() const = 0;
+        };
 
     } // namespace utilities
 
     namespace config {
 
-        const std::string SettingScreenshotEnabled = "enable_screenshot";
-        const std::string SettingOverlayEyeOffset = "overlay_eye_offset";
-        const std::string SettingOverlayType = "overlay";
-        const std::string SettingMenuFontSize = "font_size";
-        const std::string SettingMenuTimeout = "menu_timeout";
-        const std::string SettingScalingType = "scaling_type";
-        const std::string SettingScaling = "scaling";
-        const std::string SettingSharpness = "sharpness";
-        const std::string SettingICD = "icd";
-        const std::string SettingFOV = "fov";
-        const std::string SettingHandTrackingEnabled = "enable_hand_tracking";
-        const std::string SettingHandVisibilityAndSkinTone = "hand_visibility";
-        const std::string SettingPredictionDampen = "prediction_dampen";
-
         enum class OverlayType { None = 0, FPS, Advanced, MaxValue };
         enum class MenuFontSize { Small = 0, Medium, Large, MaxValue };
         enum class MenuTimeout { Small = 0, Medium, Large, MaxValue };
         enum class ScalingType { None = 0, NIS, FSR, MaxValue };
         enum class HandTrackingEnabled { Off = 0, Both, Left, Right, MaxValue };
 
+        // The settings, in the order of the SettingsTable below.
+        enum class SettingId : uint32_t {
+            FirstRun = 0,
+            ScreenshotEnabled,
+            OverlayEyeOffset,
+            OverlayType,
+            MenuFontSize,
+            MenuTimeout,
+            ScalingType,
+            Scaling,
+            Sharpness,
+            ICD,
+            FOV,
+            HandTrackingEnabled,
+            HandVisibilityAndSkinTone,
+            PredictionDampen,
+            RecordPacing,
+            VisibilityMask,
+            TraceDuration,
+            RecordStats,
+            Telemetry,
+            StutterThreshold,
+            // One per log channel, in the order of log::Channel.
+            LogResolution,
+            LogSwapchain,
+            LogHandTracking,
+            LogGraphics,
+            MaxValue
+        };
+
+        struct SettingDefinition {
+            SettingId id;
+            // The name of the value in the registry.
+            const char* name;
+            int defaultValue;
+            // The values read from the registry are clamped to this range.
+            int minValue;
+            int maxValue;
+        };
+
+        // clang-format off
+        inline constexpr SettingDefinition SettingsTable[(size_t)SettingId::MaxValue] = {
+            {SettingId::FirstRun, "first_run", 0, 0, std::numeric_limits<int>::max()},
+            {SettingId::ScreenshotEnabled, "enable_screenshot", 0, 0, 1},
+            // The default is calibrated at runtime (see IMenuHandler::calibrate()).
+            {SettingId::OverlayEyeOffset, "overlay_eye_offset", 0, -500, 500},
+            {SettingId::OverlayType, "overlay", (int)OverlayType::None, 0, (int)OverlayType::MaxValue - 1},
+            {SettingId::MenuFontSize, "font_size", (int)MenuFontSize::Medium, 0, (int)MenuFontSize::MaxValue - 1},
+            {SettingId::MenuTimeout, "menu_timeout", (int)MenuTimeout::Medium, 0, (int)MenuTimeout::MaxValue - 1},
+            {SettingId::ScalingType, "scaling_type", (int)ScalingType::None, 0, (int)ScalingType::MaxValue - 1},
+            {SettingId::Scaling, "scaling", 100, 100, 200},
+            {SettingId::Sharpness, "sharpness", 20, 0, 100},
+            // In tenth of millimeters. 0 means that it is initialized from the IPD.
+            {SettingId::ICD, "icd", 0, 0, 10000},
+            {SettingId::FOV, "fov", 100, 50, 150},
+            {SettingId::HandTrackingEnabled, "enable_hand_tracking", (int)HandTrackingEnabled::Off, 0,
+                (int)HandTrackingEnabled::MaxValue - 1},
+            // Visible - Medium.
+            {SettingId::HandVisibilityAndSkinTone, "hand_visibility", 2, 0, 4},
+            {SettingId::PredictionDampen, "prediction_dampen", 100, 0, 200},
+            {SettingId::RecordPacing, "record_pacing", 0, 0, 1},
+            {SettingId::VisibilityMask, "visibility_mask", 1, 0, 1},
+            {SettingId::TraceDuration, "trace_duration", 5, 0, 3600},
+            {SettingId::RecordStats, "record_stats", 0, 0, 1},
+            {SettingId::Telemetry, "telemetry", 0, 0, 1},
+            {SettingId::StutterThreshold, "stutter_threshold", 300, 0, 100000},
+            {SettingId::LogResolution, "log_resolution", (int)log::DefaultVerbosity, 0,
+                (int)log::Verbosity::MaxValue - 1},
+            {SettingId::LogSwapchain, "log_swapchain", (int)log::DefaultVerbosity, 0,
+                (int)log::Verbosity::MaxValue - 1},
+            {SettingId::LogHandTracking, "log_hand_tracking", (int)log::DefaultVerbosity, 0,
+                (int)log::Verbosity::MaxValue - 1},
+            {SettingId::LogGraphics, "log_graphics", (int)log::DefaultVerbosity, 0,
+                (int)log::Verbosity::MaxValue - 1},
+        };
+        // clang-format on
+
+        constexpr bool IsSettingsTableOrdered() {
+            for (size_t i = 0; i < (size_t)SettingId::MaxValue; i++) {
+                if ((size_t)SettingsTable[i].id != i) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        static_assert(IsSettingsTableOrdered(), "SettingsTable must follow the order of SettingId");
+        static_assert((size_t)SettingId::LogGraphics - (size_t)SettingId::LogResolution + 1 ==
+                      (size_t)log::Channel::MaxValue);
+
+        // The values of all the settings at one point of the frame loop. The snapshot is updated by the frame thread
+        // while other threads (such as the one calling xrLocateViews()) read it, so each value is read atomically.
+        struct SettingsSnapshot {
+            std::atomic<int> values[(size_t)SettingId::MaxValue]{};
+
+            int getValue(SettingId id) const {
+                return values[(size_t)id].load(std::memory_order_relaxed);
+            }
+
+            template <typename T, std::enable_if_t<std::is_enum<T>::value, bool> = true>
+            T getEnumValue(SettingId id) const {
+                return (T)getValue(id);
+            }
+        };
+
         struct IConfigManager {
             virtual ~IConfigManager() = default;
 
@@ -88,12 +347,13 @@ namespace toolkit {
             // database.
             virtual void tick() = 0;
 
-            virtual void setDefault(const std::string& name, int value) = 0;
+            // Override the default from the SettingsTable, for defaults that are only known at runtime.
+            virtual void setDefault(SettingId id, int value) = 0;
 
-            virtual int getValue(const std::string& name) const = 0;
-            virtual int peekValue(const std::string& name) const = 0;
-            virtual void setValue(const std::string& name, int value, bool noCommitDelay = false) = 0;
-            virtual bool hasChanged(const std::string& name) const = 0;
+            virtual int getValue(SettingId id) const = 0;
+            virtual int peekValue(SettingId id) const = 0;
+            virtual void setValue(SettingId id, int value, bool noCommitDelay = false) = 0;
+            virtual bool hasChanged(SettingId id) const = 0;
 
             virtual void resetToDefaults() = 0;
 
@@ -102,14 +362,15 @@ namespace toolkit {
             virtual bool isSafeMode() const = 0;
             virtual bool isExperimentalMode() const = 0;
 
-            template <typename T, std::enable_if_t<std::is_enum<T>::value, bool> = true>
-            void setEnumDefault(const std::string& name, T value) {
-                setDefault(name, (int)value);
-            }
+            // Capture the current values for the frame loop. This is done once per frame, so that all the reads within
+            // a frame see the same values without looking up each setting. Other threads see each value either from
+            // the previous or from the current snapshot.
+            virtual void takeSnapshot() = 0;
+            virtual const SettingsSnapshot& getSnapshot() const = 0;
 
             template <typename T, std::enable_if_t<std::is_enum<T>::value, bool> = true>
-            T getEnumValue(const std::string& name) const {
-                return (T)getValue(name);
+            T getEnumValue(SettingId id) const {
+                return (T)getValue(id);
             }
         };
 
@@ -117,11 +378,14 @@ namespace toolkit {
 
     namespace graphics {
 
+        // 2 views to process, one per eye.
+        constexpr uint32_t ViewCount = 2;
+
         enum class Api { D3D11, D3D12 };
 
         // Type traits for D3D11.
         struct D3D11 {
-            static constexpr Api Api = Api::D3D11;
+            static constexpr graphics::Api Api = graphics::Api::D3D11;
 
             using Device = ID3D11Device*;
             using Context = ID3D11DeviceContext*;
@@ -144,7 +408,7 @@ namespace toolkit {
 
         // Type traits for D3D12.
         struct D3D12 {
-            static constexpr Api Api = Api::D3D12;
+            static constexpr graphics::Api Api = graphics::Api::D3D12;
 
             using Device = ID3D12Device*;
             using Context = ID3D12GraphicsCommandList*;
@@ -363,10 +627,54 @@ namespace toolkit {
             }
         };
 
+        // The xrWaitFrame() loop might cause to have 2 frames in-flight, so we want to delay the GPU timer re-use by
+        // those 2 frames.
+        constexpr uint32_t GpuTimerLatency = 2;
+
         // A GPU asynchronous timer.
         struct IGpuTimer : public ITimer {
             virtual Api getApi() const = 0;
             virtual std::shared_ptr<IDevice> getDevice() const = 0;
+
+            // The result of a measurement is read asynchronously. There is no result when it is not available yet or
+            // when it is invalid (eg: disjoint).
+            virtual std::optional<uint64_t> query(bool reset = true) const = 0;
+        };
+
+        // The time spent in a profiling scope during one frame. A scope entered several times during the frame
+        // accumulates all its measurements.
+        struct ProfilingResult {
+            // The names of the enclosing scopes and of the scope itself, separated by '/'.
+            std::string path;
+            uint32_t depth{0};
+            uint32_t count{0};
+            uint64_t cpuTimeUs{0};
+            uint64_t gpuTimeUs{0};
+
+            // The GPU measurements that have no result, and are missing from gpuTimeUs.
+            uint32_t numLateGpuResults{0};
+
+            // Each measurement, in microseconds on the QueryPerformanceCounter() clock, once the timers are calibrated.
+            std::vector<std::pair<uint64_t, uint64_t>> cpuSpans;
+            std::vector<std::pair<uint64_t, uint64_t>> gpuSpans;
+        };
+
+        // The name of a profiling scope, registered once so that entering the scope does not need to allocate.
+        using ProfilingScopeId = uint32_t;
+
+        // Measure the CPU and GPU time of nested, named scopes.
+        struct IProfiler {
+            virtual ~IProfiler() = default;
+
+            // Registering the same name twice returns the same id.
+            virtual ProfilingScopeId registerScope(const std::string& name) = 0;
+
+            virtual void pushScope(ProfilingScopeId id) = 0;
+            virtual void popScope() = 0;
+
+            // Start a new frame, and return the results of the oldest frame in-flight. The scopes are listed in the
+            // order they were first entered.
+            virtual const std::vector<ProfilingResult>& nextFrame() = 0;
         };
 
         // A graphics device.
@@ -409,6 +717,19 @@ namespace toolkit {
                                                                         const std::string includePath = "") = 0;
             virtual std::shared_ptr<IGpuTimer> createTimer() = 0;
 
+            // Correlate the GPU timestamps with the CPU clock, for IGpuTimer::consumeTimestamps(). This might wait for
+            // the GPU to become idle.
+            virtual void calibrateTimers() = 0;
+
+            // Profiling scopes nest (eg: "Upscaler/FSR/EASU eye0"). Register the names upfront, and prefer using
+            // ScopedProfiling.
+            virtual ProfilingScopeId registerProfilingScope(const std::string& name) = 0;
+            virtual void pushProfilingScope(ProfilingScopeId id) = 0;
+            virtual void popProfilingScope() = 0;
+
+            // Start a new frame of profiling, and return the results of the oldest frame in-flight.
+            virtual const std::vector<ProfilingResult>& collectProfilingResults() = 0;
+
             // Must be invoked prior to setting the input/output.
             virtual void setShader(std::shared_ptr<IQuadShader> shader) = 0;
 
@@ -421,6 +742,9 @@ namespace toolkit {
 
             virtual void dispatchShader(bool doNotClear = false) const = 0;
 
+            // Restrict the quad shaders to a region of the render target. Must be invoked after setting the output.
+            virtual void setViewport(const XrRect2Di& viewport) = 0;
+
             virtual void unsetRenderTargets() = 0;
             virtual void setRenderTargets(std::vector<std::shared_ptr<ITexture>> renderTargets,
                                           std::shared_ptr<ITexture> depthBuffer = {}) = 0;
@@ -482,13 +806,57 @@ namespace toolkit {
             }
         };
 
+        // Measure a profiling scope until the end of the C++ scope.
+        class ScopedProfiling {
+          public:
+            ScopedProfiling(IDevice& device, ProfilingScopeId id) : m_device(device) {
+                m_device.pushProfilingScope(id);
+            }
+
+            ~ScopedProfiling() {
+                m_device.popProfilingScope();
+            }
+
+          private:
+            IDevice& m_device;
+        };
+
+        // The requirements of a processing stage for its input and output textures.
+        struct StageRequirements {
+            // The resolution produced by the stage for one view. A value of 0 means the stage preserves the input
+            // resolution.
+            uint32_t outputWidth{0};
+            uint32_t outputHeight{0};
+
+            XrSwapchainUsageFlags inputUsage{XR_SWAPCHAIN_USAGE_SAMPLED_BIT};
+            XrSwapchainUsageFlags outputUsage{XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT};
+        };
+
+        // The regions of the input and output textures that a stage processes for one view.
+        struct ViewRegion {
+            uint32_t view{0};
+            XrRect2Di input{};
+            XrRect2Di output{};
+        };
+
         // A texture upscaler (such as NIS).
+        // The visibility mask is a constant buffer with a VisibilityMaskConfig, to bind to slot 1.
         struct IUpscaler {
             virtual ~IUpscaler() = default;
 
-            virtual void update() = 0;
-            virtual void upscale(std::shared_ptr<ITexture> input,
-                                 std::shared_ptr<ITexture> output,
+            virtual StageRequirements getRequirements() const = 0;
+
+            // Whether the upscaler leaves the image untouched when the input and output regions have the same size.
+            // An upscaler whose output has the resolution of the views is removed from the chains of the swapchains
+            // created while it is an identity.
+            virtual bool isIdentity() const = 0;
+
+            // Apply the settings of the frame.
+            virtual void update(const config::SettingsSnapshot& settings) = 0;
+            virtual void upscale(const std::shared_ptr<ITexture>& input,
+                                 const std::shared_ptr<ITexture>& output,
+                                 const ViewRegion& region,
+                                 const std::shared_ptr<IShaderBuffer>& visibilityMask,
                                  int32_t slice = -1) = 0;
         };
 
@@ -496,12 +864,89 @@ namespace toolkit {
         struct IImageProcessor {
             virtual ~IImageProcessor() = default;
 
-            virtual void update() = 0;
-            virtual void process(std::shared_ptr<ITexture> input,
-                                 std::shared_ptr<ITexture> output,
+            virtual StageRequirements getRequirements() const = 0;
+
+            // Whether the processor leaves the image untouched. This must not change during the lifetime of the
+            // processor, since the processor is removed from the chains created while it is an identity.
+            virtual bool isIdentity() const = 0;
+
+            // Apply the settings of the frame.
+            virtual void update(const config::SettingsSnapshot& settings) = 0;
+            virtual void process(const std::shared_ptr<ITexture>& input,
+                                 const std::shared_ptr<ITexture>& output,
+                                 const ViewRegion& region,
+                                 const std::shared_ptr<IShaderBuffer>& visibilityMask,
                                  int32_t slice = -1) = 0;
         };
 
+        // The stages of the processing chain, in their order of execution.
+        enum class StageType { PreProcessing = 0, Upscaling, PostProcessing, MaxValue };
+
+        // The names of the profiling scopes of the stages.
+        inline const char* const StageNames[(size_t)StageType::MaxValue] = {"Preprocess", "Upscaler", "Postprocess"};
+
+        // The stages that run for the images of a swapchain, in their order of execution.
+        struct ChainLayout {
+            StageType stages[(size_t)StageType::MaxValue];
+            size_t count{0};
+        };
+
+        // The processing chain applied to the application's swapchain images before handing them to the runtime.
+        // The chain decides which intermediate textures to create and in which order the stages are executed.
+        struct IProcessingChain {
+            virtual ~IProcessingChain() = default;
+
+            virtual void addStage(StageType type, std::shared_ptr<IUpscaler> upscaler) = 0;
+            virtual void addStage(StageType type, std::shared_ptr<IImageProcessor> processor) = 0;
+            virtual bool hasStage(StageType type) const = 0;
+
+            // Skip a stage without releasing its resources. The last stage of the chain is never skipped.
+            // Stages that are an identity are skipped automatically, and removed from the chains of the swapchains
+            // created while they are an identity and preserve the resolution.
+            virtual void setBypass(StageType type, bool bypass) = 0;
+
+            // Apply the settings of the frame to the stages. The settings are the snapshot taken for the frame, so that
+            // the stages do not read the live values while the menu changes them.
+            virtual void update(const config::SettingsSnapshot& settings) = 0;
+
+            // Choose the stages to run for a swapchain. The view resolution is the resolution recommended to the
+            // application for one view. The layout is kept for the lifetime of the swapchain, and passed to the other
+            // methods below.
+            virtual ChainLayout getLayout(const XrSwapchainCreateInfo& appInfo,
+                                          const XrExtent2Di& viewResolution) const = 0;
+
+            // The description of the runtime swapchain to create in place of the application swapchain. Swapchains
+            // holding several views (such as double-wide swapchains) are resized proportionally.
+            virtual XrSwapchainCreateInfo getRuntimeSwapchainInfo(const XrSwapchainCreateInfo& appInfo,
+                                                                  const XrExtent2Di& viewResolution,
+                                                                  const ChainLayout& layout) const = 0;
+
+            // Create the textures for all the images of a swapchain. For each image, the first entry is the texture
+            // handed to the application, and the last entry is the runtime texture. Intermediate textures are shared
+            // between images.
+            virtual std::vector<std::vector<std::shared_ptr<ITexture>>>
+            createSwapchainImages(const XrSwapchainCreateInfo& appInfo,
+                                  const XrExtent2Di& viewResolution,
+                                  const ChainLayout& layout,
+                                  const std::vector<std::shared_ptr<ITexture>>& runtimeTextures) = 0;
+
+            // Whether the stage produces the runtime texture of a swapchain, in which case it cannot be bypassed.
+            virtual bool isLastStage(StageType type) const = 0;
+
+            // The video memory (in bytes) saved by sharing the intermediate textures.
+            virtual uint64_t getMemorySaved() const = 0;
+
+            // Execute all the stages on one view of a swapchain image. The region goes from the rectangle rendered by
+            // the application to the rectangle submitted to the runtime. The visibility mask (which may be null) lets
+            // the stages skip the regions hidden by the lenses. Each stage is measured in a profiling scope named after
+            // StageNames.
+            virtual void process(const std::vector<std::shared_ptr<ITexture>>& chain,
+                                 const ChainLayout& layout,
+                                 int32_t slice,
+                                 const ViewRegion& region,
+                                 const std::shared_ptr<IShaderBuffer>& visibilityMask) const = 0;
+        };
+
     } // namespace graphics
 
     namespace input {
@@ -530,7 +975,7 @@ namespace toolkit {
             virtual bool locate(XrSpace space, XrSpace baseSpace, XrTime time, XrSpaceLocation& location) const = 0;
             virtual void render(const XrPosef& pose,
                                 XrSpace baseSpace,
-                                std::shared_ptr<graphics::ITexture> renderTarget) const = 0;
+                                const std::shared_ptr<graphics::ITexture>& renderTarget) const = 0;
 
             virtual bool getActionState(const XrActionStateGetInfo& getInfo, XrActionStateBoolean& state) const = 0;
             virtual bool getActionState(const XrActionStateGetInfo& getInfo, XrActionStateFloat& state) const = 0;
@@ -553,7 +998,7 @@ namespace toolkit {
                                    const XrSwapchainCreateInfo& rightImageInfo) = 0;
             virtual void render(uint32_t eye,
                                 const XrPosef& pose,
-                                std::shared_ptr<graphics::ITexture> renderTarget) const = 0;
+                                const std::shared_ptr<graphics::ITexture>& renderTarget) const = 0;
             virtual void updateStatistics(const LayerStatistics& stats) = 0;
         };
 
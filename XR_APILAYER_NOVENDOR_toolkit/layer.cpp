@@ -29,32 +29,85 @@
 #include "interfaces.h"
 #include "layer.h"
 #include "log.h"
+#include "swapchains.h"
+#include "visibilitymask.h"
 
 namespace {
 
-    // 2 views to process, one per eye.
-    constexpr uint32_t ViewCount = 2;
+    // The latency percentiles are refreshed with the statistics every second, and cover the last 5 seconds so that a
+    // rare slow frame stays visible for more than one refresh.
+    constexpr uint32_t LatencyWindowCount = 5;
 
-    // The xrWaitFrame() loop might cause to have 2 frames in-flight, so we want to delay the GPU timer re-use by those
-    // 2 frames.
-    constexpr uint32_t GpuTimerLatency = 2;
+    // Some runtimes move the FOV by tiny amounts from one frame to the next. A change below this angle (in radians) moves
+    // the edges of the visibility mask by less than a pixel, which the one tile margin of the mask already covers.
+    constexpr float VisibilityMaskFovTolerance = 0.0005f;
 
     using namespace toolkit;
     using namespace toolkit::log;
 
+    using graphics::GpuTimerLatency;
+    using graphics::ViewCount;
+
     using namespace xr::math;
 
     struct SwapchainImages {
         std::vector<std::shared_ptr<graphics::ITexture>> chain;
-
-        std::shared_ptr<graphics::IGpuTimer> upscalerGpuTimer[ViewCount];
-        std::shared_ptr<graphics::IGpuTimer> preProcessorGpuTimer[ViewCount];
-        std::shared_ptr<graphics::IGpuTimer> postProcessorGpuTimer[ViewCount];
     };
 
     struct SwapchainState {
         std::vector<SwapchainImages> images;
         uint32_t acquiredImageIndex{0};
+
+        // The stages chosen for the swapchain when it was created.
+        graphics::ChainLayout layout;
+
+        // The resolution of a view recommended to the application when the swapchain was created.
+        XrExtent2Di viewResolution{};
+    };
+
+    // Storage for the composition layers that we rewrite in xrEndFrame(). The storage is kept from one frame to the
+    // next, so that we only allocate memory when the application submits more layers than it did before.
+    class FrameLayersArena {
+      public:
+        // Prepare the storage for a new frame.
+        void reset(uint32_t layerCount) {
+            m_layers.clear();
+            m_projections.clear();
+            m_projectionViews.clear();
+
+            // We must reserve the underlying storage to keep our pointers stable.
+            m_layers.reserve(layerCount);
+            m_projections.reserve(layerCount);
+            m_projectionViews.reserve(layerCount);
+        }
+
+        XrCompositionLayerProjection* newProjection(const XrCompositionLayerProjection& proj) {
+            assert(m_projections.size() < m_projections.capacity());
+            return &m_projections.emplace_back(proj);
+        }
+
+        XrCompositionLayerProjectionView* newProjectionViews(const XrCompositionLayerProjectionView* views) {
+            assert(m_projectionViews.size() < m_projectionViews.capacity());
+            static_assert(ViewCount == 2);
+            auto& projectionViews = m_projectionViews.emplace_back();
+            projectionViews[0] = views[0];
+            projectionViews[1] = views[1];
+            return projectionViews.data();
+        }
+
+        void addLayer(const XrCompositionLayerBaseHeader* layer) {
+            assert(m_layers.size() < m_layers.capacity());
+            m_layers.push_back(layer);
+        }
+
+        const XrCompositionLayerBaseHeader* const* getLayers() const {
+            return m_layers.data();
+        }
+
+      private:
+        std::vector<const XrCompositionLayerBaseHeader*> m_layers;
+        std::vector<XrCompositionLayerProjection> m_projections;
+        std::vector<std::array<XrCompositionLayerProjectionView, ViewCount>> m_projectionViews;
     };
 
     class OpenXrLayer : public toolkit::OpenXrApi {
@@ -71,6 +124,9 @@ namespace {
             xrGetInstanceProcAddr(GetXrInstance(),
                                   "xrConvertWin32PerformanceCounterToTimeKHR",
                                   reinterpret_cast<PFN_xrVoidFunction*>(&xrConvertWin32PerformanceCounterToTimeKHR));
+            xrGetInstanceProcAddr(GetXrInstance(),
+                                  "xrGetVisibilityMaskKHR",
+                                  reinterpret_cast<PFN_xrVoidFunction*>(&xrGetVisibilityMaskKHR));
 
             m_applicationName = createInfo->applicationInfo.applicationName;
 
@@ -85,12 +141,11 @@ namespace {
             Log("Using OpenXR runtime %s\n", m_runtimeName.c_str());
 
             m_configManager = config::CreateConfigManager(createInfo->applicationInfo.applicationName);
+            updateLogVerbosity();
 
-            // We must initialize hand tracking early on, because the application can start creating actions etc
-            // before creating the session.
-            m_configManager->setEnumDefault(config::SettingHandTrackingEnabled, config::HandTrackingEnabled::Off);
-            m_configManager->setDefault(config::SettingHandVisibilityAndSkinTone, 2); // Visible - Medium
-            if (m_configManager->getEnumValue<config::HandTrackingEnabled>(config::SettingHandTrackingEnabled) !=
+            // We must initialize hand tracking early on, because the application can start creating actions etc before
+            // creating the session.
+            if (m_configManager->getEnumValue<config::HandTrackingEnabled>(config::SettingId::HandTrackingEnabled) !=
                 config::HandTrackingEnabled::Off) {
                 m_handTracker = input::CreateHandTracker(*this, m_configManager);
                 m_sendInterationProfileEvent = true;
@@ -111,6 +166,7 @@ namespace {
 
                 m_displayWidth = views[0].recommendedImageRectWidth;
                 m_displayHeight = views[0].recommendedImageRectHeight;
+                m_recommendedViewResolution = {(int32_t)m_displayWidth, (int32_t)m_displayHeight};
 
                 // Check for hand tracking support.
                 XrSystemHandTrackingPropertiesEXT handTrackingSystemProperties{
@@ -143,13 +199,6 @@ namespace {
                     m_handTracker.reset();
                 }
 
-                // Set the default settings.
-                m_configManager->setEnumDefault(config::SettingScalingType, config::ScalingType::None);
-                m_configManager->setDefault(config::SettingScaling, 100);
-                m_configManager->setDefault(config::SettingSharpness, 20);
-                m_configManager->setDefault(config::SettingFOV, 100);
-                m_configManager->setDefault(config::SettingPredictionDampen, 100);
-
                 // Remember the XrSystemId to use.
                 m_vrSystemId = *systemId;
             }
@@ -167,7 +216,8 @@ namespace {
                 instance, systemId, viewConfigurationType, viewCapacityInput, viewCountOutput, views);
             if (XR_SUCCEEDED(result) && isVrSystem(systemId) && views) {
                 // Determine the application resolution.
-                const auto upscaleMode = m_configManager->getEnumValue<config::ScalingType>(config::SettingScalingType);
+                const auto upscaleMode =
+                    m_configManager->getEnumValue<config::ScalingType>(config::SettingId::ScalingType);
 
                 uint32_t inputWidth = m_displayWidth;
                 uint32_t inputHeight = m_displayHeight;
@@ -178,7 +228,7 @@ namespace {
 
                 case config::ScalingType::NIS:
                     std::tie(inputWidth, inputHeight) = utilities::GetScaledDimensions(
-                        m_displayWidth, m_displayHeight, m_configManager->getValue(config::SettingScaling), 2);
+                        m_displayWidth, m_displayHeight, m_configManager->getValue(config::SettingId::Scaling), 2);
                     break;
 
                 case config::ScalingType::None:
@@ -189,6 +239,7 @@ namespace {
                     break;
                 }
 
+                m_recommendedViewResolution = {(int32_t)inputWidth, (int32_t)inputHeight};
                 if (inputWidth != m_displayWidth || inputHeight != m_displayHeight) {
                     // Override the recommended image size to account for scaling.
                     for (uint32_t i = 0; i < *viewCountOutput; i++) {
@@ -196,7 +247,10 @@ namespace {
                         views[i].recommendedImageRectHeight = inputHeight;
 
                         if (i == 0) {
-                            Log("Upscaling from %ux%u to %ux%u (%u%%)\n",
+                            LOG_CHANNEL(
+                                Channel::Resolution,
+                                Verbosity::Info,
+                                "Upscaling from %ux%u to %ux%u (%u%%)\n",
                                 views[i].recommendedImageRectWidth,
                                 views[i].recommendedImageRectHeight,
                                 m_displayWidth,
@@ -206,7 +260,11 @@ namespace {
                         }
                     }
                 } else {
-                    Log("Using OpenXR resolution (no upscaling): %ux%u\n", m_displayWidth, m_displayHeight);
+                    LOG_CHANNEL(Channel::Resolution,
+                                Verbosity::Info,
+                                "Using OpenXR resolution (no upscaling): %ux%u\n",
+                                m_displayWidth,
+                                m_displayHeight);
                 }
             }
 
@@ -216,6 +274,8 @@ namespace {
         XrResult xrCreateSession(XrInstance instance,
                                  const XrSessionCreateInfo* createInfo,
                                  XrSession* session) override {
+            ScopedStartupTimer startupTimer("xrCreateSession");
+
             const XrResult result = OpenXrApi::xrCreateSession(instance, createInfo, session);
             if (XR_SUCCEEDED(result) && isVrSystem(createInfo->systemId)) {
                 // Get the graphics device.
@@ -224,11 +284,13 @@ namespace {
                     if (entry->type == XR_TYPE_GRAPHICS_BINDING_D3D11_KHR) {
                         const XrGraphicsBindingD3D11KHR* d3dBindings =
                             reinterpret_cast<const XrGraphicsBindingD3D11KHR*>(entry);
+                        ScopedStartupTimer wrapTimer("D3D11 device wrap");
                         m_graphicsDevice = graphics::WrapD3D11Device(d3dBindings->device);
                         break;
                     } else if (entry->type == XR_TYPE_GRAPHICS_BINDING_D3D12_KHR) {
                         const XrGraphicsBindingD3D12KHR* d3dBindings =
                             reinterpret_cast<const XrGraphicsBindingD3D12KHR*>(entry);
+                        ScopedStartupTimer wrapTimer("D3D12 device wrap");
                         m_graphicsDevice = graphics::WrapD3D12Device(d3dBindings->device, d3dBindings->queue);
                         break;
                     }
@@ -238,23 +300,18 @@ namespace {
 
                 if (m_graphicsDevice) {
                     // Initialize the other resources.
-                    m_upscaleMode = m_configManager->getEnumValue<config::ScalingType>(config::SettingScalingType);
+                    m_upscaleMode = m_configManager->getEnumValue<config::ScalingType>(config::SettingId::ScalingType);
 
+                    std::shared_ptr<graphics::IUpscaler> upscaler;
                     switch (m_upscaleMode) {
                     case config::ScalingType::FSR:
-                        m_upscaler = graphics::CreateFSRUpscaler(
+                        upscaler = graphics::CreateFSRUpscaler(
                             m_configManager, m_graphicsDevice, m_displayWidth, m_displayHeight);
-
-                        // Latch this value now.
-                        m_upscalingFactor = m_configManager->getValue(config::SettingScaling);
                         break;
 
                     case config::ScalingType::NIS:
-                        m_upscaler = graphics::CreateNISUpscaler(
+                        upscaler = graphics::CreateNISUpscaler(
                             m_configManager, m_graphicsDevice, m_displayWidth, m_displayHeight);
-
-                        // Latch this value now.
-                        m_upscalingFactor = m_configManager->getValue(config::SettingScaling);
                         break;
 
                     case config::ScalingType::None:
@@ -265,20 +322,63 @@ namespace {
                         break;
                     }
 
-                    m_postProcessor =
-                        graphics::CreateImageProcessor(m_configManager, m_graphicsDevice, "postprocess.hlsl");
+                    m_processingChain = graphics::CreateProcessingChain(m_graphicsDevice);
+                    if (upscaler) {
+                        m_processingChain->addStage(graphics::StageType::Upscaling, upscaler);
+
+                        // The post-processor only copies its input, and it is only kept in the chain to convert the
+                        // output of the upscaler to sRGB. The format of the swapchains is not known yet.
+                        m_processingChain->addStage(
+                            graphics::StageType::PostProcessing,
+                            graphics::CreateImageProcessor(m_configManager, m_graphicsDevice, "postprocess.hlsl"));
+                    }
 
                     m_performanceCounters.appCpuTimer = utilities::CreateCpuTimer();
                     m_performanceCounters.endFrameCpuTimer = utilities::CreateCpuTimer();
                     m_performanceCounters.overlayCpuTimer = utilities::CreateCpuTimer();
+                    m_performanceCounters.waitFrameCpuTimer = utilities::CreateCpuTimer();
+                    m_performanceCounters.screenshotCpuTimer = utilities::CreateCpuTimer();
 
                     for (unsigned int i = 0; i <= GpuTimerLatency; i++) {
                         m_performanceCounters.appGpuTimer[i] = m_graphicsDevice->createTimer();
                         m_performanceCounters.overlayGpuTimer[i] = m_graphicsDevice->createTimer();
                     }
+                    for (auto& histogram : m_performanceCounters.latencyHistograms) {
+                        histogram = utilities::CreateLatencyHistogram(LatencyWindowCount);
+                    }
 
                     m_performanceCounters.lastWindowStart = std::chrono::steady_clock::now();
 
+                    std::optional<std::string> pacingFile;
+                    if (m_configManager->getValue(config::SettingId::RecordPacing)) {
+                        pacingFile = (std::filesystem::path(getenv("LOCALAPPDATA")) /
+                                      std::filesystem::path(m_applicationName + "_pacing.csv"))
+                                         .string();
+                    }
+                    m_frameAnalyzer = utilities::CreateFrameAnalyzer(pacingFile);
+                    m_traceRecorder = utilities::CreateTraceRecorder();
+                    if (m_configManager->getValue(config::SettingId::RecordStats)) {
+                        m_frameLogger = utilities::CreateFrameLogger(
+                            (std::filesystem::path(getenv("LOCALAPPDATA")) /
+                             std::filesystem::path(m_applicationName + "_stats.csv"))
+                                .string());
+                    }
+                    if (m_configManager->getValue(config::SettingId::StutterThreshold)) {
+                        m_flightRecorder = utilities::CreateFlightRecorder(
+                            (std::filesystem::path(getenv("LOCALAPPDATA")) /
+                             std::filesystem::path(m_applicationName + "_"))
+                                .string(),
+                            m_configManager->getValue(config::SettingId::StutterThreshold));
+                    }
+                    if (m_configManager->getValue(config::SettingId::Telemetry)) {
+                        m_telemetryPublisher =
+                            utilities::CreateTelemetryPublisher(m_applicationName, m_displayWidth, m_displayHeight);
+                    }
+
+                    if (m_configManager->getValue(config::SettingId::VisibilityMask)) {
+                        queryVisibilityMasks(*session);
+                    }
+
                     m_menuHandler = menu::CreateMenuHandler(m_configManager,
                                                             m_graphicsDevice,
                                                             m_displayWidth,
@@ -311,9 +411,7 @@ namespace {
                 if (m_handTracker) {
                     m_handTracker->endSession();
                 }
-                m_upscaler.reset();
-                m_preProcessor.reset();
-                m_postProcessor.reset();
+                m_processingChain.reset();
                 for (unsigned int i = 0; i <= GpuTimerLatency; i++) {
                     m_performanceCounters.appGpuTimer[i].reset();
                     m_performanceCounters.overlayGpuTimer[i].reset();
@@ -321,10 +419,25 @@ namespace {
                 m_performanceCounters.appCpuTimer.reset();
                 m_performanceCounters.endFrameCpuTimer.reset();
                 m_performanceCounters.overlayCpuTimer.reset();
+                m_performanceCounters.waitFrameCpuTimer.reset();
+                m_performanceCounters.screenshotCpuTimer.reset();
+                for (auto& histogram : m_performanceCounters.latencyHistograms) {
+                    histogram.reset();
+                }
+                m_frameAnalyzer.reset();
+                m_traceRecorder.reset();
+                m_frameLogger.reset();
+                m_telemetryPublisher.reset();
+                m_flightRecorder.reset();
+                for (uint32_t eye = 0; eye < ViewCount; eye++) {
+                    m_visibilityMasks[eye] = {};
+                }
                 m_swapchains.clear();
                 m_menuHandler.reset();
-                m_graphicsDevice->shutdown();
-                m_graphicsDevice.reset();
+                if (m_graphicsDevice) {
+                    m_graphicsDevice->shutdown();
+                    m_graphicsDevice.reset();
+                }
                 m_vrSession = XR_NULL_HANDLE;
                 // A good check to ensure there are no resources leak is to confirm that the graphics device is
                 // destroyed _before_ we see this message.
@@ -350,51 +463,36 @@ namespace {
             // buffers.
             const bool useSwapchain = createInfo->usageFlags & XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT;
 
-            Log("Creating swapchain with dimensions=%ux%u, arraySize=%u, mipCount=%u, sampleCount=%u, format=%d, "
-                "usage=0x%x\n",
-                createInfo->width,
-                createInfo->height,
-                createInfo->arraySize,
-                createInfo->mipCount,
-                createInfo->sampleCount,
-                createInfo->format,
-                createInfo->usageFlags);
-
-            XrSwapchainCreateInfo chainCreateInfo = *createInfo;
+            RecordEvent("Swapchain creation");
+            LOG_CHANNEL(Channel::Swapchain,
+                        Verbosity::Info,
+                        "Creating swapchain with dimensions=%ux%u, arraySize=%u, mipCount=%u, sampleCount=%u, "
+                        "format=%d, usage=0x%x\n",
+                        createInfo->width,
+                        createInfo->height,
+                        createInfo->arraySize,
+                        createInfo->mipCount,
+                        createInfo->sampleCount,
+                        createInfo->format,
+                        createInfo->usageFlags);
+
+            // Modify the swapchain to handle our processing chain (eg: change resolution and/or select usage
+            // XR_SWAPCHAIN_USAGE_UNORDERED_ACCESS_BIT).
+            graphics::ChainLayout layout;
             if (useSwapchain) {
-                // TODO: Modify the swapchain to handle our processing chain (eg: change resolution and/or select usage
-                // XR_SWAPCHAIN_USAGE_UNORDERED_ACCESS_BIT).
-
-                if (m_preProcessor) {
-                    // This is redundant (given the useSwapchain conditions) but we do this for correctness.
-                    chainCreateInfo.usageFlags |= XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT;
-                }
-
-                if (m_upscaler) {
-                    // When upscaling, be sure to request the full resolution with the runtime.
-                    chainCreateInfo.width = m_displayWidth;
-                    chainCreateInfo.height = m_displayHeight;
-
-                    // The upscaler requires to use as an unordered access view.
-                    chainCreateInfo.usageFlags |= XR_SWAPCHAIN_USAGE_UNORDERED_ACCESS_BIT;
-                }
-
-                if (m_postProcessor) {
-                    // We no longer need the runtime swapchain to have this flag since we will use an intermediate
-                    // texture.
-                    chainCreateInfo.usageFlags &= ~XR_SWAPCHAIN_USAGE_UNORDERED_ACCESS_BIT;
-
-                    // This is redundant (given the useSwapchain conditions) but we do this for correctness.
-                    chainCreateInfo.usageFlags |= XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT;
-                }
+                layout = m_processingChain->getLayout(*createInfo, m_recommendedViewResolution);
             }
+            const XrSwapchainCreateInfo chainCreateInfo =
+                useSwapchain
+                    ? m_processingChain->getRuntimeSwapchainInfo(*createInfo, m_recommendedViewResolution, layout)
+                    : *createInfo;
 
             const XrResult result = OpenXrApi::xrCreateSwapchain(session, &chainCreateInfo, swapchain);
             if (XR_SUCCEEDED(result) && useSwapchain) {
                 uint32_t imageCount;
                 CHECK_XRCMD(OpenXrApi::xrEnumerateSwapchainImages(*swapchain, 0, &imageCount, nullptr));
 
-                SwapchainState swapchainState;
+                std::vector<std::shared_ptr<graphics::ITexture>> runtimeTextures;
                 if (m_graphicsDevice->getApi() == graphics::Api::D3D11) {
                     std::vector<XrSwapchainImageD3D11KHR> d3dImages(imageCount, {XR_TYPE_SWAPCHAIN_IMAGE_D3D11_KHR});
                     CHECK_XRCMD(OpenXrApi::xrEnumerateSwapchainImages(
@@ -403,16 +501,12 @@ namespace {
                         &imageCount,
                         reinterpret_cast<XrSwapchainImageBaseHeader*>(d3dImages.data())));
                     for (uint32_t i = 0; i < imageCount; i++) {
-                        SwapchainImages images;
-
-                        // Store the runtime images into the state (last entry in the processing chain).
-                        images.chain.push_back(
+                        // Store the runtime images (last entry in the processing chain).
+                        runtimeTextures.push_back(
                             graphics::WrapD3D11Texture(m_graphicsDevice,
                                                        chainCreateInfo,
                                                        d3dImages[i].texture,
                                                        fmt::format("Runtime swapchain {} TEX2D", i)));
-
-                        swapchainState.images.push_back(images);
                     }
                 } else if (m_graphicsDevice->getApi() == graphics::Api::D3D12) {
                     std::vector<XrSwapchainImageD3D12KHR> d3dImages(imageCount, {XR_TYPE_SWAPCHAIN_IMAGE_D3D12_KHR});
@@ -422,94 +516,32 @@ namespace {
                         &imageCount,
                         reinterpret_cast<XrSwapchainImageBaseHeader*>(d3dImages.data())));
                     for (uint32_t i = 0; i < imageCount; i++) {
-                        SwapchainImages images;
-
-                        // Store the runtime images into the state (last entry in the processing chain).
-                        images.chain.push_back(
+                        // Store the runtime images (last entry in the processing chain).
+                        runtimeTextures.push_back(
                             graphics::WrapD3D12Texture(m_graphicsDevice,
                                                        chainCreateInfo,
                                                        d3dImages[i].texture,
                                                        fmt::format("Runtime swapchain {} TEX2D", i)));
-
-                        swapchainState.images.push_back(images);
                     }
                 } else {
                     throw new std::runtime_error("Unsupported graphics runtime");
                 }
 
-                for (uint32_t i = 0; i < imageCount; i++) {
-                    SwapchainImages& images = swapchainState.images[i];
-
-                    // TODO: Create other entries in the chain based on the processing to do (scaling,
-                    // post-processing...).
-
-                    if (m_preProcessor) {
-                        // Create an intermediate texture with the same resolution as the input.
-                        XrSwapchainCreateInfo inputCreateInfo = *createInfo;
-                        inputCreateInfo.usageFlags |= XR_SWAPCHAIN_USAGE_SAMPLED_BIT;
-                        if (m_upscaler) {
-                            // The upscaler requires to use as a shader input.
-                            inputCreateInfo.usageFlags |= XR_SWAPCHAIN_USAGE_SAMPLED_BIT;
-                        }
-
-                        auto inputTexture = m_graphicsDevice->createTexture(
-                            inputCreateInfo, fmt::format("Postprocess input swapchain {} TEX2D", i));
-
-                        // We place the texture at the very front (app texture).
-                        images.chain.insert(images.chain.begin(), inputTexture);
+                // Create the other entries in the chain based on the processing to do (scaling,
+                // post-processing...).
+                auto chains = m_processingChain->createSwapchainImages(
+                    *createInfo, m_recommendedViewResolution, layout, runtimeTextures);
 
-                        images.preProcessorGpuTimer[0] = m_graphicsDevice->createTimer();
-                        if (createInfo->arraySize > 1) {
-                            images.preProcessorGpuTimer[1] = m_graphicsDevice->createTimer();
-                        }
-                    }
-
-                    if (m_upscaler) {
-                        // Create an app texture with the lower resolution.
-                        XrSwapchainCreateInfo inputCreateInfo = *createInfo;
-                        inputCreateInfo.usageFlags |= XR_SWAPCHAIN_USAGE_SAMPLED_BIT;
-                        auto inputTexture =
-                            m_graphicsDevice->createTexture(inputCreateInfo, fmt::format("App swapchain {} TEX2D", i));
-
-                        // We place the texture before the runtime texture, which means at the very front (app
-                        // texture) or after the pre-processor.
-                        images.chain.insert(images.chain.end() - 1, inputTexture);
-
-                        images.upscalerGpuTimer[0] = m_graphicsDevice->createTimer();
-                        if (createInfo->arraySize > 1) {
-                            images.upscalerGpuTimer[1] = m_graphicsDevice->createTimer();
-                        }
-                    }
-
-                    if (m_postProcessor) {
-                        // Create an intermediate texture with the same resolution as the output.
-                        XrSwapchainCreateInfo intermediateCreateInfo = chainCreateInfo;
-                        intermediateCreateInfo.usageFlags |= XR_SWAPCHAIN_USAGE_SAMPLED_BIT;
-                        if (m_upscaler) {
-                            // The upscaler requires to use as an unordered access view.
-                            intermediateCreateInfo.usageFlags |= XR_SWAPCHAIN_USAGE_UNORDERED_ACCESS_BIT;
-
-                            // This also means we need a non-sRGB type.
-                            if (m_graphicsDevice->isTextureFormatSRGB(intermediateCreateInfo.format)) {
-                                // good balance between visuals and perf
-                                intermediateCreateInfo.format =
-                                    m_graphicsDevice->getTextureFormat(graphics::TextureFormat::R10G10B10A2_UNORM);
-                            }
-                        }
-                        auto intermediateTexture = m_graphicsDevice->createTexture(
-                            intermediateCreateInfo, fmt::format("Postprocess input swapchain {} TEX2D", i));
-
-                        // We place the texture just before the runtime texture.
-                        images.chain.insert(images.chain.end() - 1, intermediateTexture);
-
-                        images.postProcessorGpuTimer[0] = m_graphicsDevice->createTimer();
-                        if (createInfo->arraySize > 1) {
-                            images.postProcessorGpuTimer[1] = m_graphicsDevice->createTimer();
-                        }
-                    }
+                SwapchainState swapchainState;
+                swapchainState.layout = layout;
+                swapchainState.viewResolution = m_recommendedViewResolution;
+                for (uint32_t i = 0; i < imageCount; i++) {
+                    SwapchainImages images;
+                    images.chain = std::move(chains[i]);
+                    swapchainState.images.push_back(std::move(images));
                 }
 
-                m_swapchains.insert_or_assign(*swapchain, swapchainState);
+                m_swapchains.insert_or_assign(*swapchain, std::move(swapchainState));
             }
 
             return result;
@@ -586,20 +618,19 @@ namespace {
             const XrResult result =
                 OpenXrApi::xrEnumerateSwapchainImages(swapchain, imageCapacityInput, imageCountOutput, images);
             if (XR_SUCCEEDED(result) && images) {
-                auto swapchainIt = m_swapchains.find(swapchain);
-                if (swapchainIt != m_swapchains.end()) {
-                    auto swapchainState = swapchainIt->second;
+                const auto swapchainState = m_swapchains.find(swapchain);
+                if (swapchainState) {
 
                     // Return the application texture (first entry in the processing chain).
                     if (m_graphicsDevice->getApi() == graphics::Api::D3D11) {
                         XrSwapchainImageD3D11KHR* d3dImages = reinterpret_cast<XrSwapchainImageD3D11KHR*>(images);
                         for (uint32_t i = 0; i < *imageCountOutput; i++) {
-                            d3dImages[i].texture = swapchainState.images[i].chain[0]->getNative<graphics::D3D11>();
+                            d3dImages[i].texture = swapchainState->images[i].chain[0]->getNative<graphics::D3D11>();
                         }
                     } else if (m_graphicsDevice->getApi() == graphics::Api::D3D12) {
                         XrSwapchainImageD3D12KHR* d3dImages = reinterpret_cast<XrSwapchainImageD3D12KHR*>(images);
                         for (uint32_t i = 0; i < *imageCountOutput; i++) {
-                            d3dImages[i].texture = swapchainState.images[i].chain[0]->getNative<graphics::D3D12>();
+                            d3dImages[i].texture = swapchainState->images[i].chain[0]->getNative<graphics::D3D12>();
                         }
                     } else {
                         throw new std::runtime_error("Unsupported graphics runtime");
@@ -616,9 +647,9 @@ namespace {
             const XrResult result = OpenXrApi::xrAcquireSwapchainImage(swapchain, acquireInfo, index);
             if (XR_SUCCEEDED(result)) {
                 // Record the index so we know which texture to use in xrEndFrame().
-                auto swapchainIt = m_swapchains.find(swapchain);
-                if (swapchainIt != m_swapchains.end()) {
-                    swapchainIt->second.acquiredImageIndex = *index;
+                const auto swapchainState = m_swapchains.find(swapchain);
+                if (swapchainState) {
+                    swapchainState->acquiredImageIndex = *index;
                 }
             }
 
@@ -637,7 +668,19 @@ namespace {
                 return XR_SUCCESS;
             }
 
-            return OpenXrApi::xrPollEvent(instance, eventData);
+            const XrResult result = OpenXrApi::xrPollEvent(instance, eventData);
+            if (result == XR_SUCCESS && eventData->type == XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED) {
+                RecordEvent("Session state change");
+            }
+            if (result == XR_SUCCESS && eventData->type == XR_TYPE_EVENT_DATA_VISIBILITY_MASK_CHANGED_KHR) {
+                const XrEventDataVisibilityMaskChangedKHR* const event =
+                    reinterpret_cast<const XrEventDataVisibilityMaskChangedKHR*>(eventData);
+                if (isVrSession(event->session) && m_configManager->getValue(config::SettingId::VisibilityMask)) {
+                    queryVisibilityMasks(event->session);
+                }
+            }
+
+            return result;
         }
 
         XrResult xrGetCurrentInteractionProfile(XrSession session,
@@ -670,11 +713,14 @@ namespace {
                 const auto vec = views[1].pose.position - views[0].pose.position;
                 const auto ipd = Length(vec);
 
-                // If it's the first time, initialize the ICD to be the same as IPD.
-                int icdInTenthmm = m_configManager->getValue(config::SettingICD);
+                // If it's the first time, initialize the ICD to be the same as IPD. The new value reaches the snapshot
+                // with the next frame.
+                int icdInTenthmm = m_configManager->getSnapshot().getValue(config::SettingId::ICD);
                 if (icdInTenthmm == 0) {
                     icdInTenthmm = (int)(ipd * 10000.0f);
-                    m_configManager->setValue(config::SettingICD, icdInTenthmm);
+                    if (m_configManager->peekValue(config::SettingId::ICD) == 0) {
+                        m_configManager->setValue(config::SettingId::ICD, icdInTenthmm);
+                    }
                 }
                 const float icd = icdInTenthmm / 10000.0f;
 
@@ -689,7 +735,7 @@ namespace {
                 }
 
                 // Override the FOV if requested.
-                const int fov = m_configManager->getValue(config::SettingFOV);
+                const int fov = m_configManager->getSnapshot().getValue(config::SettingId::FOV);
                 if (fov != 100) {
                     const float multiplier = fov / 100.0f;
 
@@ -769,11 +815,24 @@ namespace {
         XrResult xrWaitFrame(XrSession session,
                              const XrFrameWaitInfo* frameWaitInfo,
                              XrFrameState* frameState) override {
+            if (isVrSession(session) && m_frameAnalyzer) {
+                m_frameAnalyzer->onWaitFrameStart();
+                m_performanceCounters.waitFrameCpuTimer->start();
+            }
+
             const XrResult result = OpenXrApi::xrWaitFrame(session, frameWaitInfo, frameState);
             if (XR_SUCCEEDED(result) && isVrSession(session)) {
+                if (m_performanceCounters.waitFrameCpuTimer) {
+                    m_performanceCounters.waitFrameCpuTimer->stop();
+                    traceTimer("xrWaitFrame", *m_performanceCounters.waitFrameCpuTimer, false);
+                }
+
+                const XrTime predictedDisplayTime = frameState->predictedDisplayTime;
+
                 // Apply prediction dampening if possible and if needed.
                 if (xrConvertWin32PerformanceCounterToTimeKHR) {
-                    const int predictionDampen = m_configManager->getValue(config::SettingPredictionDampen);
+                    const int predictionDampen =
+                        m_configManager->getSnapshot().getValue(config::SettingId::PredictionDampen);
                     if (predictionDampen != 100) {
                         // Find the current time.
                         LARGE_INTEGER qpcTimeNow;
@@ -789,9 +848,16 @@ namespace {
                         }
 
                         m_stats.predictionTimeUs += predictionAmount;
+                        recordLatency(LatencyMetric::Prediction, std::max(predictionAmount, (XrTime)0) / 1000);
                     }
                 }
 
+                // The application submits the frame with the dampened display time.
+                if (m_frameAnalyzer) {
+                    m_frameAnalyzer->onWaitFrameEnd(
+                        frameState->predictedDisplayTime, predictedDisplayTime, frameState->predictedDisplayPeriod);
+                }
+
                 // Record the predicted display time.
                 m_waitedFrameTime = frameState->predictedDisplayTime;
             }
@@ -805,17 +871,105 @@ namespace {
                 // Record the predicted display time.
                 m_begunFrameTime = m_waitedFrameTime;
 
+                if (m_frameAnalyzer) {
+                    m_frameAnalyzer->onBeginFrame();
+                }
+
                 if (m_graphicsDevice) {
                     m_performanceCounters.appCpuTimer->start();
-                    m_stats.appGpuTimeUs +=
-                        m_performanceCounters.appGpuTimer[m_performanceCounters.gpuTimerIndex]->query();
+                    recordGpuTime(LatencyMetric::AppGpu,
+                                  m_performanceCounters.appGpuTimer[m_performanceCounters.gpuTimerIndex]->query(),
+                                  m_stats.appGpuTimeUs);
+                    traceTimer("App", *m_performanceCounters.appGpuTimer[m_performanceCounters.gpuTimerIndex], true);
                     m_performanceCounters.appGpuTimer[m_performanceCounters.gpuTimerIndex]->start();
+                    if (m_graphicsDevice->getApi() == graphics::Api::D3D12) {
+                        // The timestamp is written into our own command list, which must reach the queue before the
+                        // application's work.
+                        m_graphicsDevice->flushContext();
+                    }
                 }
             }
 
             return result;
         }
 
+        // A GPU measurement without a result is left out of the statistics, rather than being counted as 0.
+        void recordGpuTime(LatencyMetric metric, const std::optional<uint64_t>& timeUs, uint64_t& totalTimeUs) {
+            if (!timeUs) {
+                // The timers are only started after the first frames.
+                if (m_performanceCounters.frameIndex > GpuTimerLatency) {
+                    m_stats.lateGpuResults++;
+                }
+                return;
+            }
+
+            totalTimeUs += timeUs.value();
+            m_performanceCounters.numGpuSamples[(size_t)metric]++;
+            recordLatency(metric, timeUs.value());
+        }
+
+        void recordLatency(LatencyMetric metric, uint64_t valueUs) {
+            m_performanceCounters.frameLatenciesUs[(size_t)metric] += valueUs;
+
+            const auto& histogram = m_performanceCounters.latencyHistograms[(size_t)metric];
+            if (histogram) {
+                histogram->record(valueUs);
+            }
+        }
+
+        // Accumulate the profiling scopes of the oldest frame in-flight into the statistics and the trace, and
+        // retrieve the GPU time of each stage that ran and has a result.
+        void collectProfilingResults(std::optional<uint64_t>* stageGpuTimesUs) {
+            const bool isCapturing = m_traceRecorder && m_traceRecorder->isCapturing();
+            const auto& results = m_graphicsDevice->collectProfilingResults();
+            for (size_t i = 0; i < results.size(); i++) {
+                const auto& result = results[i];
+                if (result.depth == 0) {
+                    for (size_t stage = 0; stage < (size_t)graphics::StageType::MaxValue; stage++) {
+                        if (result.path == graphics::StageNames[stage] && result.count && !result.numLateGpuResults) {
+                            stageGpuTimesUs[stage] = stageGpuTimesUs[stage].value_or(0) + result.gpuTimeUs;
+                        }
+                    }
+                }
+
+                if (i < MaxProfilingScopes) {
+                    auto& scope = m_stats.scopes[i];
+                    if (!scope.path[0]) {
+                        strncpy_s(scope.path, sizeof(scope.path), result.path.c_str(), _TRUNCATE);
+                        scope.depth = result.depth;
+                        m_stats.numScopes = std::max(m_stats.numScopes, (uint32_t)i + 1);
+                    }
+                    scope.cpuTimeUs += result.cpuTimeUs;
+                    if (result.count && !result.numLateGpuResults) {
+                        scope.gpuTimeUs += result.gpuTimeUs;
+                        m_performanceCounters.numScopeGpuSamples[i]++;
+                    }
+                }
+                m_stats.lateGpuResults += result.numLateGpuResults;
+
+                if (isCapturing) {
+                    for (const auto& span : result.cpuSpans) {
+                        m_traceRecorder->addCpuEvent(result.path.c_str(), span.first, span.second);
+                    }
+                    for (const auto& span : result.gpuSpans) {
+                        m_traceRecorder->addGpuEvent(result.path.c_str(), span.first, span.second);
+                    }
+                }
+            }
+        }
+
+        // Add the last measurement of a timer to the trace being captured.
+        void traceTimer(const char* name, ITimer& timer, bool isGpu) {
+            uint64_t startUs, endUs;
+            if (m_traceRecorder && m_traceRecorder->isCapturing() && timer.consumeTimestamps(startUs, endUs)) {
+                if (isGpu) {
+                    m_traceRecorder->addGpuEvent(name, startUs, endUs);
+                } else {
+                    m_traceRecorder->addCpuEvent(name, startUs, endUs);
+                }
+            }
+        }
+
         void updateStatisticsForFrame() {
             const auto now = std::chrono::steady_clock::now();
             const auto numFrames = ++m_performanceCounters.numFrames;
@@ -827,14 +981,32 @@ namespace {
                 // Push the last averaged statistics.
                 m_stats.fps = static_cast<float>(numFrames);
                 m_stats.appCpuTimeUs /= numFrames;
-                m_stats.appGpuTimeUs /= numFrames;
                 m_stats.endFrameCpuTimeUs /= numFrames;
-                m_stats.upscalerGpuTimeUs /= numFrames;
-                m_stats.preProcessorGpuTimeUs /= numFrames;
-                m_stats.postProcessorGpuTimeUs /= numFrames;
                 m_stats.overlayCpuTimeUs /= numFrames;
-                m_stats.overlayGpuTimeUs /= numFrames;
+
+                // The GPU times are averaged over the frames that have a result.
+                auto& numGpuSamples = m_performanceCounters.numGpuSamples;
+                const auto averageGpuTime = [&](uint64_t& totalTimeUs, LatencyMetric metric) {
+                    totalTimeUs /= std::max(std::exchange(numGpuSamples[(size_t)metric], 0u), 1u);
+                };
+                averageGpuTime(m_stats.appGpuTimeUs, LatencyMetric::AppGpu);
+                averageGpuTime(m_stats.preProcessorGpuTimeUs, LatencyMetric::PreProcessorGpu);
+                averageGpuTime(m_stats.upscalerGpuTimeUs, LatencyMetric::UpscalerGpu);
+                averageGpuTime(m_stats.postProcessorGpuTimeUs, LatencyMetric::PostProcessorGpu);
+                averageGpuTime(m_stats.overlayGpuTimeUs, LatencyMetric::OverlayGpu);
                 m_stats.predictionTimeUs /= numFrames;
+                for (uint32_t i = 0; i < m_stats.numScopes; i++) {
+                    m_stats.scopes[i].cpuTimeUs /= numFrames;
+                    m_stats.scopes[i].gpuTimeUs /=
+                        std::max(std::exchange(m_performanceCounters.numScopeGpuSamples[i], 0u), 1u);
+                }
+                m_stats.memorySavedMB = m_processingChain->getMemorySaved() / (1024 * 1024);
+                m_stats.isUpscalingBypassIgnored = m_processingChain->isLastStage(graphics::StageType::Upscaling);
+                m_stats.appliedScaling = m_appliedScaling;
+                m_stats.pacing = m_frameAnalyzer->computeStatistics();
+                for (size_t i = 0; i < (size_t)LatencyMetric::MaxValue; i++) {
+                    m_stats.latency[i] = m_performanceCounters.latencyHistograms[i]->computePercentiles();
+                }
 
                 m_menuHandler->updateStatistics(m_stats);
 
@@ -846,20 +1018,25 @@ namespace {
         void updateConfiguration() {
             // Make sure config gets written if needed.
             m_configManager->tick();
+            m_configManager->takeSnapshot();
 
             // Refresh the configuration.
-            if (m_preProcessor) {
-                m_preProcessor->update();
-            }
-            if (m_upscaler) {
-                m_upscaler->update();
-            }
-            if (m_postProcessor) {
-                m_postProcessor->update();
+            updateLogVerbosity();
+            m_processingChain->update(m_configManager->getSnapshot());
+        }
+
+        // The verbosity can be changed from the menu at any time.
+        void updateLogVerbosity() {
+            const auto& settings = m_configManager->getSnapshot();
+            for (size_t i = 0; i < (size_t)Channel::MaxValue; i++) {
+                const auto setting = (config::SettingId)((size_t)config::SettingId::LogResolution + i);
+                SetVerbosity((Channel)i, settings.getEnumValue<Verbosity>(setting));
             }
         }
 
-        void takeScreenshot(std::shared_ptr<graphics::ITexture> texture) const {
+        void takeScreenshot(const std::shared_ptr<graphics::ITexture>& texture) const {
+            RecordEvent("Screenshot");
+
             std::stringstream parameters;
             if (m_upscaleMode != config::ScalingType::None) {
                 // TODO: add a getUpscaleModeName() helper to keep enum and string in sync.
@@ -867,8 +1044,8 @@ namespace {
                                          : m_upscaleMode == config::ScalingType::FSR ? "FSR_"
                                                                                      : "SCL_";
 
-                parameters << upscaleName << m_upscalingFactor << "_"
-                           << m_configManager->getValue(config::SettingSharpness);
+                parameters << upscaleName << m_appliedScaling << "_"
+                           << m_configManager->getValue(config::SettingId::Sharpness);
             }
             const std::time_t now = std::time(nullptr);
             char datetime[1024];
@@ -884,13 +1061,23 @@ namespace {
                 return OpenXrApi::xrEndFrame(session, frameEndInfo);
             }
 
+            const uint64_t allocationCountAtStart = utilities::GetAllocationCount();
+
+            m_frameAnalyzer->onEndFrameStart(frameEndInfo->displayTime);
+
             updateStatisticsForFrame();
 
             m_performanceCounters.appCpuTimer->stop();
-            m_stats.appCpuTimeUs += m_performanceCounters.appCpuTimer->query();
+            const auto appCpuTimeUs = m_performanceCounters.appCpuTimer->query();
+            m_stats.appCpuTimeUs += appCpuTimeUs;
+            recordLatency(LatencyMetric::AppCpu, appCpuTimeUs);
+            traceTimer("App", *m_performanceCounters.appCpuTimer, false);
             m_performanceCounters.appGpuTimer[m_performanceCounters.gpuTimerIndex]->stop();
 
-            m_stats.endFrameCpuTimeUs += m_performanceCounters.endFrameCpuTimer->query();
+            const auto endFrameCpuTimeUs = m_performanceCounters.endFrameCpuTimer->query();
+            m_stats.endFrameCpuTimeUs += endFrameCpuTimeUs;
+            recordLatency(LatencyMetric::EndFrameCpu, endFrameCpuTimeUs);
+            traceTimer("xrEndFrame", *m_performanceCounters.endFrameCpuTimer, false);
             m_performanceCounters.endFrameCpuTimer->start();
 
             // Toggle to the next set of GPU timers.
@@ -907,21 +1094,40 @@ namespace {
             // Unbind all textures from the render targets.
             m_graphicsDevice->unsetRenderTargets();
 
-            std::shared_ptr<graphics::ITexture> textureForOverlay[ViewCount] = {};
+            // The last texture of each view's chain, which is also held by the swapchain registry.
+            const std::shared_ptr<graphics::ITexture>* textureForOverlay[ViewCount] = {};
             XrCompositionLayerProjectionView* viewsForOverlay = nullptr;
             XrSpace spaceForOverlay = XR_NULL_HANDLE;
 
             // Because the frame info is passed const, we are going to need to reconstruct a writable version of it to
             // patch the resolution.
             XrFrameEndInfo chainFrameEndInfo = *frameEndInfo;
-            std::vector<const XrCompositionLayerBaseHeader*> correctedLayers;
-
-            std::vector<XrCompositionLayerProjection> layerProjectionAllocator;
-            std::vector<std::array<XrCompositionLayerProjectionView, 2>> layerProjectionViewsAllocator;
-
-            // We must reserve the underlying storage to keep our pointers stable.
-            layerProjectionAllocator.reserve(chainFrameEndInfo.layerCount);
-            layerProjectionViewsAllocator.reserve(chainFrameEndInfo.layerCount);
+            m_frameLayers.reset(chainFrameEndInfo.layerCount);
+
+            // We allow to bypass scaling when the menu option is turned off. This is only for quick
+            // comparison/testing, since we're still holding to all the underlying resources. The bypass is ignored
+            // when the upscaler writes the runtime texture, which the menu reports.
+            m_processingChain->setBypass(
+                graphics::StageType::Upscaling,
+                m_configManager->getSnapshot().getEnumValue<config::ScalingType>(config::SettingId::ScalingType) ==
+                    config::ScalingType::None);
+            std::optional<uint64_t> gpuTimesUs[(size_t)graphics::StageType::MaxValue];
+            collectProfilingResults(gpuTimesUs);
+
+            // The resolution rendered by the application for the first view, for the telemetry.
+            XrExtent2Di renderExtent{};
+
+            // The resolution recommended to the application at the current upscaling factor. The applications that
+            // query the view configuration again render it inside the swapchains they created for another factor.
+            XrExtent2Di renderResolution{};
+            if (m_upscaleMode != config::ScalingType::None) {
+                const auto [width, height] = utilities::GetScaledDimensions(
+                    m_displayWidth,
+                    m_displayHeight,
+                    m_configManager->getSnapshot().getValue(config::SettingId::Scaling),
+                    2);
+                renderResolution = {(int32_t)width, (int32_t)height};
+            }
 
             // Apply the processing chain to all the (supported) layers.
             for (uint32_t i = 0; i < chainFrameEndInfo.layerCount; i++) {
@@ -931,136 +1137,110 @@ namespace {
 
                     // To patch the resolution of the layer we need to recreate the whole projection & views
                     // data structures.
-                    auto correctedProjectionLayer = &layerProjectionAllocator.emplace_back(*proj);
-                    auto correctedProjectionViews = layerProjectionViewsAllocator
-                                                        .emplace_back(std::array<XrCompositionLayerProjectionView, 2>(
-                                                            {proj->views[0], proj->views[1]}))
-                                                        .data();
-
-                    // For VPRT, we need to handle texture arrays.
-                    static_assert(ViewCount == 2);
-                    const bool useVPRT = proj->views[0].subImage.swapchain == proj->views[1].subImage.swapchain;
-
                     assert(proj->viewCount == ViewCount);
+                    auto correctedProjectionLayer = m_frameLayers.newProjection(*proj);
+                    auto correctedProjectionViews = m_frameLayers.newProjectionViews(proj->views);
+
                     for (uint32_t eye = 0; eye < ViewCount; eye++) {
                         const XrCompositionLayerProjectionView& view = proj->views[eye];
 
-                        auto swapchainIt = m_swapchains.find(view.subImage.swapchain);
-                        if (swapchainIt == m_swapchains.end()) {
+                        const auto swapchainState =
+                            m_swapchains.find(view.subImage.swapchain, m_eyeSwapchainSlots[eye]);
+                        if (!swapchainState) {
                             throw new std::runtime_error("Swapchain is not registered");
                         }
-                        auto swapchainState = swapchainIt->second;
-                        auto swapchainImages = swapchainState.images[swapchainState.acquiredImageIndex];
-                        uint32_t nextImage = 0;
-                        uint32_t lastImage = 0;
-                        uint32_t gpuTimerIndex = useVPRT ? eye : 0;
-
-                        // TODO: Insert processing below.
-                        // The pattern typically follows these steps:
-                        // - Advanced to the right source and/or destination image;
-                        // - Pull the previously measured timer value;
-                        // - Start the timer;
-                        // - Invoke the processing;
-                        // - Stop the timer;
-                        // - Advanced to the right source and/or destination image;
-
-                        // Perform post-processing.
-                        if (m_preProcessor) {
-                            nextImage++;
-
-                            m_stats.preProcessorGpuTimeUs +=
-                                swapchainImages.preProcessorGpuTimer[gpuTimerIndex]->query();
-                            swapchainImages.preProcessorGpuTimer[gpuTimerIndex]->start();
-
-                            m_preProcessor->process(
-                                swapchainImages.chain[lastImage], swapchainImages.chain[nextImage], useVPRT ? eye : -1);
-                            swapchainImages.preProcessorGpuTimer[gpuTimerIndex]->stop();
-
-                            lastImage++;
-                        }
+                        const auto& swapchainImages = swapchainState->images[swapchainState->acquiredImageIndex];
+                        const auto& appInfo = swapchainImages.chain.front()->getInfo();
+                        const auto& runtimeInfo = swapchainImages.chain.back()->getInfo();
 
-                        // Perform upscaling (if requested).
-                        if (m_upscaler) {
-                            nextImage++;
-
-                            // We allow to bypass scaling when the menu option is turned off. This is only for quick
-                            // comparison/testing, since we're still holding to all the underlying resources.
-                            if (m_configManager->getEnumValue<config::ScalingType>(config::SettingScalingType) !=
-                                config::ScalingType::None) {
-                                m_stats.upscalerGpuTimeUs += swapchainImages.upscalerGpuTimer[gpuTimerIndex]->query();
-                                swapchainImages.upscalerGpuTimer[gpuTimerIndex]->start();
-
-                                m_upscaler->upscale(swapchainImages.chain[lastImage],
-                                                    swapchainImages.chain[nextImage],
-                                                    useVPRT ? eye : -1);
-                                swapchainImages.upscalerGpuTimer[gpuTimerIndex]->stop();
+                        // Patch the FOV when set above 100%.
+                        const int fov = m_configManager->getSnapshot().getValue(config::SettingId::FOV);
+                        if (fov > 100) {
+                            const float multiplier = 100.0f / fov;
 
-                                lastImage++;
-                            }
+                            correctedProjectionViews[eye].fov.angleUp *= multiplier;
+                            correctedProjectionViews[eye].fov.angleDown *= multiplier;
+                            correctedProjectionViews[eye].fov.angleLeft *= multiplier;
+                            correctedProjectionViews[eye].fov.angleRight *= multiplier;
                         }
 
-                        // Perform post-processing.
-                        if (m_postProcessor) {
-                            nextImage++;
-
-                            m_stats.postProcessorGpuTimeUs +=
-                                swapchainImages.postProcessorGpuTimer[gpuTimerIndex]->query();
-                            swapchainImages.postProcessorGpuTimer[gpuTimerIndex]->start();
-
-                            m_postProcessor->process(
-                                swapchainImages.chain[lastImage], swapchainImages.chain[nextImage], useVPRT ? eye : -1);
-                            swapchainImages.postProcessorGpuTimer[gpuTimerIndex]->stop();
-
-                            lastImage++;
+                        // Process the rectangle rendered by the application. When upscaling, the rectangle submitted to
+                        // the runtime is scaled along with the swapchain.
+                        const XrRect2Di& imageRect = view.subImage.imageRect;
+                        if (imageRect.offset.x < 0 || imageRect.offset.y < 0 || imageRect.extent.width < 0 ||
+                            imageRect.extent.height < 0 ||
+                            (int64_t)imageRect.offset.x + imageRect.extent.width > appInfo.width ||
+                            (int64_t)imageRect.offset.y + imageRect.extent.height > appInfo.height) {
+                            throw new std::runtime_error("Image rectangle is outside of the swapchain");
                         }
 
-                        // Make sure the chain was completed.
-                        if (nextImage != swapchainImages.chain.size() - 1) {
-                            throw new std::runtime_error("Processing chain incomplete!");
+                        const graphics::ViewRegion region = graphics::GetViewRegion(
+                            eye, imageRect, appInfo, runtimeInfo, swapchainState->viewResolution, renderResolution);
+                        if (!renderExtent.width && region.input.extent.width) {
+                            renderExtent = region.input.extent;
+
+                            // The upscaling factor actually applied, from the rectangle rendered by the application.
+                            m_appliedScaling = (uint32_t)((region.output.extent.width * 100 + renderExtent.width / 2) /
+                                                          renderExtent.width);
                         }
 
-                        textureForOverlay[eye] = swapchainImages.chain.back();
+                        // The mask covers the view, which is what the runtime sees with the corrected FOV.
+                        const auto& visibilityMask = getVisibilityMask(eye, correctedProjectionViews[eye].fov);
 
-                        // Patch the resolution.
-                        correctedProjectionViews[eye].subImage.imageRect.extent.width = m_displayWidth;
-                        correctedProjectionViews[eye].subImage.imageRect.extent.height = m_displayHeight;
+                        m_processingChain->process(swapchainImages.chain,
+                                                   swapchainState->layout,
+                                                   appInfo.arraySize > 1 ? (int32_t)view.subImage.imageArrayIndex : -1,
+                                                   region,
+                                                   visibilityMask);
 
-                        // Patch the FOV when set above 100%.
-                        const int fov = m_configManager->getValue(config::SettingFOV);
-                        if (fov > 100) {
-                            const float multiplier = 100.0f / fov;
+                        textureForOverlay[eye] = &swapchainImages.chain.back();
 
-                            correctedProjectionViews[eye].fov.angleUp *= multiplier;
-                            correctedProjectionViews[eye].fov.angleDown *= multiplier;
-                            correctedProjectionViews[eye].fov.angleLeft *= multiplier;
-                            correctedProjectionViews[eye].fov.angleRight *= multiplier;
-                        }
+                        // Patch the rectangle.
+                        correctedProjectionViews[eye].subImage.imageRect = region.output;
                     }
 
                     viewsForOverlay = correctedProjectionViews;
                     spaceForOverlay = proj->space;
 
                     correctedProjectionLayer->views = correctedProjectionViews;
-                    correctedLayers.push_back(
+                    m_frameLayers.addLayer(
                         reinterpret_cast<const XrCompositionLayerBaseHeader*>(correctedProjectionLayer));
                 } else {
-                    correctedLayers.push_back(chainFrameEndInfo.layers[i]);
+                    m_frameLayers.addLayer(chainFrameEndInfo.layers[i]);
                 }
             }
 
-            chainFrameEndInfo.layers = correctedLayers.data();
+            chainFrameEndInfo.layers = m_frameLayers.getLayers();
+
+            // The late results of the stages are already counted by collectProfilingResults().
+            if (const auto& timeUs = gpuTimesUs[(size_t)graphics::StageType::PreProcessing]) {
+                recordGpuTime(LatencyMetric::PreProcessorGpu, timeUs, m_stats.preProcessorGpuTimeUs);
+            }
+            if (const auto& timeUs = gpuTimesUs[(size_t)graphics::StageType::Upscaling]) {
+                recordGpuTime(LatencyMetric::UpscalerGpu, timeUs, m_stats.upscalerGpuTimeUs);
+            }
+            if (const auto& timeUs = gpuTimesUs[(size_t)graphics::StageType::PostProcessing]) {
+                recordGpuTime(LatencyMetric::PostProcessorGpu, timeUs, m_stats.postProcessorGpuTimeUs);
+            }
 
             // We intentionally exclude the overlay from this timer, as it has its own separate timer.
             m_performanceCounters.endFrameCpuTimer->stop();
 
             // Render our overlays.
             if (textureForOverlay[0]) {
-                const bool useVPRT = textureForOverlay[1] == textureForOverlay[0];
+                const bool useVPRT = (*textureForOverlay[0])->isArray();
 
                 if (m_menuHandler || m_handTracker) {
-                    m_stats.overlayCpuTimeUs += m_performanceCounters.overlayCpuTimer->query();
-                    m_stats.overlayGpuTimeUs +=
-                        m_performanceCounters.overlayGpuTimer[m_performanceCounters.gpuTimerIndex]->query();
+                    const auto overlayCpuTimeUs = m_performanceCounters.overlayCpuTimer->query();
+                    m_stats.overlayCpuTimeUs += overlayCpuTimeUs;
+                    recordLatency(LatencyMetric::OverlayCpu, overlayCpuTimeUs);
+                    traceTimer("Overlay", *m_performanceCounters.overlayCpuTimer, false);
+                    recordGpuTime(LatencyMetric::OverlayGpu,
+                                  m_performanceCounters.overlayGpuTimer[m_performanceCounters.gpuTimerIndex]->query(),
+                                  m_stats.overlayGpuTimeUs);
+                    traceTimer("Overlay",
+                               *m_performanceCounters.overlayGpuTimer[m_performanceCounters.gpuTimerIndex],
+                               true);
 
                     m_performanceCounters.overlayCpuTimer->start();
                     m_performanceCounters.overlayGpuTimer[m_performanceCounters.gpuTimerIndex]->start();
@@ -1070,25 +1250,30 @@ namespace {
                 if (m_menuHandler && m_needCalibrateEyeOffsets) {
                     m_menuHandler->calibrate(viewsForOverlay[0].pose,
                                              viewsForOverlay[0].fov,
-                                             textureForOverlay[0]->getInfo(),
+                                             (*textureForOverlay[0])->getInfo(),
                                              viewsForOverlay[1].pose,
                                              viewsForOverlay[1].fov,
-                                             textureForOverlay[1]->getInfo());
+                                             (*textureForOverlay[1])->getInfo());
                     m_needCalibrateEyeOffsets = false;
+
+                    // The calibrated default is picked up with the snapshot of the next frame. Taking a snapshot here
+                    // would overwrite the buffer that the other threads may still be reading.
                 }
 
                 // Render the hands.
                 if (m_handTracker) {
                     for (uint32_t eye = 0; eye < ViewCount; eye++) {
                         if (!useVPRT) {
-                            m_graphicsDevice->setRenderTargets({textureForOverlay[eye]});
+                            m_graphicsDevice->setRenderTargets({*textureForOverlay[eye]});
                         } else {
-                            m_graphicsDevice->setRenderTargets({std::make_pair(textureForOverlay[eye], eye)});
+                            m_graphicsDevice->setRenderTargets({std::make_pair(
+                                *textureForOverlay[eye], (int32_t)viewsForOverlay[eye].subImage.imageArrayIndex)});
                         }
+                        m_graphicsDevice->setViewport(viewsForOverlay[eye].subImage.imageRect);
                         m_graphicsDevice->setViewProjection(
                             viewsForOverlay[eye].pose, viewsForOverlay[eye].fov, 0.001f, 100.0f);
 
-                        m_handTracker->render(viewsForOverlay[eye].pose, spaceForOverlay, textureForOverlay[eye]);
+                        m_handTracker->render(viewsForOverlay[eye].pose, spaceForOverlay, *textureForOverlay[eye]);
                     }
                 }
 
@@ -1101,13 +1286,15 @@ namespace {
                     }
                     for (uint32_t eye = 0; eye < ViewCount; eye++) {
                         if (!useVPRT) {
-                            m_graphicsDevice->setRenderTargets({textureForOverlay[eye]});
+                            m_graphicsDevice->setRenderTargets({*textureForOverlay[eye]});
                         } else {
-                            m_graphicsDevice->setRenderTargets({std::make_pair(textureForOverlay[eye], eye)});
+                            m_graphicsDevice->setRenderTargets({std::make_pair(
+                                *textureForOverlay[eye], (int32_t)viewsForOverlay[eye].subImage.imageArrayIndex)});
                         }
+                        m_graphicsDevice->setViewport(viewsForOverlay[eye].subImage.imageRect);
 
                         m_graphicsDevice->beginText();
-                        m_menuHandler->render(eye, viewsForOverlay[eye].pose, textureForOverlay[eye]);
+                        m_menuHandler->render(eye, viewsForOverlay[eye].pose, *textureForOverlay[eye]);
                         m_graphicsDevice->flushText();
                     }
                 }
@@ -1123,15 +1310,81 @@ namespace {
             // TODO: The screenshot does not work with multi-layer applications.
             const bool requestScreenshot =
                 utilities::UpdateKeyState(m_requestScreenShotKeyState, VK_CONTROL, VK_F12, false) &&
-                m_configManager->getValue(config::SettingScreenshotEnabled);
+                m_configManager->getSnapshot().getValue(config::SettingId::ScreenshotEnabled);
 
             if (textureForOverlay[0] && requestScreenshot) {
-                takeScreenshot(textureForOverlay[0]);
+                m_performanceCounters.screenshotCpuTimer->start();
+                takeScreenshot(*textureForOverlay[0]);
+                m_performanceCounters.screenshotCpuTimer->stop();
+                traceTimer("Screenshot", *m_performanceCounters.screenshotCpuTimer, false);
+            }
+
+            // Capture a trace of the next frames. The GPU clock is calibrated at the start of each capture, since it
+            // drifts from the CPU clock.
+            const uint32_t traceDuration = m_configManager->getSnapshot().getValue(config::SettingId::TraceDuration);
+            if (utilities::UpdateKeyState(m_requestTraceKeyState, VK_CONTROL, VK_F11, false) && traceDuration &&
+                !m_traceRecorder->isCapturing()) {
+                m_graphicsDevice->calibrateTimers();
+
+                const std::time_t now = std::time(nullptr);
+                char datetime[1024];
+                std::strftime(datetime, sizeof(datetime), "%Y%m%d_%H%M%S", std::localtime(&now));
+                const std::string traceFilename = m_applicationName + "_" + datetime + "_trace.json";
+                m_traceRecorder->startCapture(
+                    (std::filesystem::path(getenv("LOCALAPPDATA")) / traceFilename).string(), traceDuration);
+            }
+            m_traceRecorder->update();
+
+            // Log the raw measurements of the frame.
+            if (m_frameLogger || m_telemetryPublisher || m_flightRecorder) {
+                utilities::FrameLogRecord record;
+                record.frameIndex = m_performanceCounters.frameIndex;
+                record.displayTime = frameEndInfo->displayTime;
+                std::copy(std::begin(m_performanceCounters.frameLatenciesUs),
+                          std::end(m_performanceCounters.frameLatenciesUs),
+                          record.latencyUs);
+                // The allocations of a frame are only known once its record is written, so the record holds the
+                // allocations of the previous frame.
+                record.endFrameAllocations = m_performanceCounters.lastEndFrameAllocations;
+                const auto& settings = m_configManager->getSnapshot();
+                record.scalingType =
+                    (uint32_t)settings.getEnumValue<config::ScalingType>(config::SettingId::ScalingType);
+                record.scaling = m_appliedScaling;
+                record.sharpness = settings.getValue(config::SettingId::Sharpness);
+                if (m_frameLogger) {
+                    m_frameLogger->log(record);
+                }
+                if (m_telemetryPublisher) {
+                    m_telemetryPublisher->publish(record,
+                                                  renderExtent.width,
+                                                  renderExtent.height,
+                                                  m_frameAnalyzer->getTotalMissedFrames());
+                }
+                if (m_flightRecorder) {
+                    m_flightRecorder->recordFrame(record, m_frameAnalyzer->getTotalMissedFrames());
+                }
             }
+            m_performanceCounters.frameIndex++;
+            std::fill(std::begin(m_performanceCounters.frameLatenciesUs),
+                      std::end(m_performanceCounters.frameLatenciesUs),
+                      0);
 
             m_graphicsDevice->flushContext();
 
-            return OpenXrApi::xrEndFrame(session, &chainFrameEndInfo);
+            m_frameAnalyzer->onEndFrameEnd(frameEndInfo->displayTime);
+
+            // Everything the layer does until the submission is counted, including the logging of the frame.
+            m_performanceCounters.lastEndFrameAllocations = utilities::GetAllocationCount() - allocationCountAtStart;
+            m_stats.endFrameAllocations += m_performanceCounters.lastEndFrameAllocations;
+
+            const XrResult result = OpenXrApi::xrEndFrame(session, &chainFrameEndInfo);
+
+            // The startup ends with the submission of the first frame.
+            if (std::exchange(m_isFirstFrame, false)) {
+                LogStartupTimes();
+            }
+
+            return result;
         }
 
       private:
@@ -1143,6 +1396,103 @@ namespace {
             return session == m_vrSession;
         }
 
+        // Retrieve the area of each view that is visible through the lenses. The tile masks are built upon the next
+        // frame, once the FOV is known.
+        void queryVisibilityMasks(XrSession session) {
+            for (uint32_t eye = 0; eye < ViewCount; eye++) {
+                auto& mask = m_visibilityMasks[eye];
+                mask.vertices.clear();
+                mask.indices.clear();
+                mask.needRebuild = true;
+                if (!xrGetVisibilityMaskKHR) {
+                    continue;
+                }
+
+                XrVisibilityMaskKHR visibilityMask{XR_TYPE_VISIBILITY_MASK_KHR};
+                XrResult result = xrGetVisibilityMaskKHR(session,
+                                                         XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO,
+                                                         eye,
+                                                         XR_VISIBILITY_MASK_TYPE_VISIBLE_TRIANGLE_MESH_KHR,
+                                                         &visibilityMask);
+                if (XR_SUCCEEDED(result) && visibilityMask.vertexCountOutput && visibilityMask.indexCountOutput) {
+                    mask.vertices.resize(visibilityMask.vertexCountOutput);
+                    mask.indices.resize(visibilityMask.indexCountOutput);
+                    visibilityMask.vertexCapacityInput = visibilityMask.vertexCountOutput;
+                    visibilityMask.vertices = mask.vertices.data();
+                    visibilityMask.indexCapacityInput = visibilityMask.indexCountOutput;
+                    visibilityMask.indices = mask.indices.data();
+                    result = xrGetVisibilityMaskKHR(session,
+                                                    XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO,
+                                                    eye,
+                                                    XR_VISIBILITY_MASK_TYPE_VISIBLE_TRIANGLE_MESH_KHR,
+                                                    &visibilityMask);
+                }
+
+                if (XR_FAILED(result) || mask.indices.empty()) {
+                    Log("No visibility mask for view %u: %d\n", eye, result);
+                    mask.vertices.clear();
+                    mask.indices.clear();
+                    continue;
+                }
+
+                // The tile mask is rebuilt during the frames, so its storage is allocated upfront.
+                if (!mask.config) {
+                    mask.config = std::make_unique<VisibilityMaskConfig>();
+                    mask.scratch.reserve(VISIBILITY_MASK_MAX_WORDS * 32);
+                    mask.buffer = m_graphicsDevice->createBuffer(sizeof(VisibilityMaskConfig),
+                                                                 fmt::format("Visibility Mask {} CB", eye));
+                }
+            }
+        }
+
+        static bool isSameFov(const XrFovf& a, const XrFovf& b) {
+            return std::abs(a.angleLeft - b.angleLeft) < VisibilityMaskFovTolerance &&
+                   std::abs(a.angleRight - b.angleRight) < VisibilityMaskFovTolerance &&
+                   std::abs(a.angleUp - b.angleUp) < VisibilityMaskFovTolerance &&
+                   std::abs(a.angleDown - b.angleDown) < VisibilityMaskFovTolerance;
+        }
+
+        // The tile mask of a view for the current FOV, or null if the whole view must be processed.
+        const std::shared_ptr<graphics::IShaderBuffer>& getVisibilityMask(uint32_t eye, const XrFovf& fov) {
+            auto& mask = m_visibilityMasks[eye];
+            if (mask.indices.empty() || !m_configManager->getSnapshot().getValue(config::SettingId::VisibilityMask)) {
+                return m_noVisibilityMask;
+            }
+
+            if (mask.needRebuild || !isSameFov(fov, mask.fov)) {
+                // Start with 16x16 pixel tiles, and make them larger until the mask fits in the constant buffer.
+                uint32_t tileSize = 16;
+                uint32_t tilesX, tilesY;
+                do {
+                    tilesX = (m_displayWidth + tileSize - 1) / tileSize;
+                    tilesY = (m_displayHeight + tileSize - 1) / tileSize;
+                    tileSize *= 2;
+                } while (tilesX * tilesY > VISIBILITY_MASK_MAX_WORDS * 32);
+
+                auto& config = mask.config;
+                config->tilesX = tilesX;
+                config->tilesY = tilesY;
+                config->enabled = 1;
+                const uint32_t visibleTiles = utilities::BuildVisibilityMask(
+                    mask.vertices, mask.indices, fov, tilesX, tilesY, config->visibleTiles, mask.scratch);
+
+                mask.buffer->uploadData(config.get(), sizeof(VisibilityMaskConfig));
+
+                LOG_CHANNEL(Channel::Graphics,
+                            Verbosity::Verbose,
+                            "Visibility mask for view %u: %ux%u tiles, %.1f%% hidden\n",
+                            eye,
+                            tilesX,
+                            tilesY,
+                            100.0f * (tilesX * tilesY - visibleTiles) / (tilesX * tilesY));
+
+                mask.fov = fov;
+                mask.needRebuild = false;
+            }
+
+            return mask.buffer;
+        }
+
         const std::string getPath(XrPath path) {
             char buf[XR_MAX_PATH_LENGTH];
             uint32_t count;
@@ -1158,28 +1508,49 @@ namespace {
         XrSession m_vrSession{XR_NULL_HANDLE};
         uint32_t m_displayWidth{0};
         uint32_t m_displayHeight{0};
+        XrExtent2Di m_recommendedViewResolution{};
         bool m_supportHandTracking{false};
 
         XrTime m_waitedFrameTime;
         XrTime m_begunFrameTime;
         bool m_sendInterationProfileEvent{false};
+        bool m_isFirstFrame{true};
 
         std::shared_ptr<config::IConfigManager> m_configManager;
 
         std::shared_ptr<graphics::IDevice> m_graphicsDevice;
-        std::map<XrSwapchain, SwapchainState> m_swapchains;
+        utilities::SwapchainRegistry<SwapchainState> m_swapchains;
+
+        // The slots of the swapchains last submitted for each eye, as hints for the lookups. Only used by xrEndFrame().
+        uint32_t m_eyeSwapchainSlots[ViewCount]{};
+        FrameLayersArena m_frameLayers;
 
-        std::shared_ptr<graphics::IUpscaler> m_upscaler;
+        std::shared_ptr<graphics::IProcessingChain> m_processingChain;
         config::ScalingType m_upscaleMode{config::ScalingType::None};
-        uint32_t m_upscalingFactor{100};
+        uint32_t m_appliedScaling{100};
+        std::shared_ptr<utilities::IFrameAnalyzer> m_frameAnalyzer;
+        std::shared_ptr<utilities::ITraceRecorder> m_traceRecorder;
+        std::shared_ptr<utilities::IFrameLogger> m_frameLogger;
+        std::shared_ptr<utilities::ITelemetryPublisher> m_telemetryPublisher;
+        std::shared_ptr<utilities::IFlightRecorder> m_flightRecorder;
 
-        std::shared_ptr<graphics::IImageProcessor> m_preProcessor;
-        std::shared_ptr<graphics::IImageProcessor> m_postProcessor;
+        struct {
+            std::vector<XrVector2f> vertices;
+            std::vector<uint32_t> indices;
+            XrFovf fov{};
+            bool needRebuild{true};
+            std::unique_ptr<VisibilityMaskConfig> config;
+            std::vector<uint8_t> scratch;
+            std::shared_ptr<graphics::IShaderBuffer> buffer;
+        } m_visibilityMasks[ViewCount];
+        // Returned by reference when a view has no visibility mask.
+        const std::shared_ptr<graphics::IShaderBuffer> m_noVisibilityMask;
 
         std::shared_ptr<input::IHandTracker> m_handTracker;
 
         std::shared_ptr<menu::IMenuHandler> m_menuHandler;
         bool m_requestScreenShotKeyState{false};
+        bool m_requestTraceKeyState{false};
         bool m_needCalibrateEyeOffsets{true};
 
         struct {
@@ -1188,6 +1559,20 @@ namespace {
             std::shared_ptr<utilities::ICpuTimer> endFrameCpuTimer;
             std::shared_ptr<utilities::ICpuTimer> overlayCpuTimer;
             std::shared_ptr<graphics::IGpuTimer> overlayGpuTimer[GpuTimerLatency + 1];
+            std::shared_ptr<utilities::ICpuTimer> waitFrameCpuTimer;
+            std::shared_ptr<utilities::ICpuTimer> screenshotCpuTimer;
+            std::shared_ptr<utilities::ILatencyHistogram> latencyHistograms[(size_t)LatencyMetric::MaxValue];
+
+            // The measurements of the current frame.
+            uint64_t frameLatenciesUs[(size_t)LatencyMetric::MaxValue]{};
+            uint64_t frameIndex{0};
+
+            // The heap allocations made in xrEndFrame() for the previous frame.
+            uint64_t lastEndFrameAllocations{0};
+
+            // The number of GPU measurements with a result during the statistics window.
+            uint32_t numGpuSamples[(size_t)LatencyMetric::MaxValue]{};
+            uint32_t numScopeGpuSamples[MaxProfilingScopes]{};
 
             unsigned int gpuTimerIndex{0};
             std::chrono::steady_clock::time_point lastWindowStart;
@@ -1198,6 +1583,7 @@ namespace {
 
         // TODO: These should be auto-generated and accessible via OpenXrApi.
         PFN_xrConvertWin32PerformanceCounterToTimeKHR xrConvertWin32PerformanceCounterToTimeKHR{nullptr};
+        PFN_xrGetVisibilityMaskKHR xrGetVisibilityMaskKHR{nullptr};
     };
 
     std::unique_ptr<OpenXrLayer> g_instance = nullptr;
@@ -23,24 +23,262 @@
 
 #include "pch.h"
 
+#include "log.h"
+
 namespace toolkit::log {
     extern std::ofstream logStream;
 
     namespace {
 
+        // Enough for a burst of messages (eg: during the creation of the swapchains) while the disk is busy. Messages
+        // are dropped when the ring is full.
+        constexpr size_t RingCapacity = 256;
+        constexpr size_t MaxMessageLength = 1024;
+
+        // The writer drains the ring periodically rather than being woken up by the callers.
+        constexpr auto DrainPeriod = std::chrono::milliseconds(100);
+
+        // How long a crashing thread waits for the writer to release the ring.
+        constexpr auto CrashFlushTimeout = std::chrono::milliseconds(500);
+
+        // The callers only format their message into the ring, and a background thread adds the timestamp and writes
+        // the messages in batches. The ring is a bounded multi-producer queue where each slot carries a sequence
+        // number: a slot is free for the producer holding the ticket equal to its sequence, and ready for the consumer
+        // once its sequence is one past that ticket. There is a single consumer at a time, either the writer thread or
+        // a thread flushing the log.
+        class AsyncLogger {
+          public:
+            AsyncLogger() {
+                for (size_t i = 0; i < RingCapacity; i++) {
+                    m_ring[i].sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            ~AsyncLogger() {
+                // We cannot join during the unloading of the DLL. xrDestroyInstance() already joined the writer thread,
+                // so if it is still around, the process is exiting and the thread was already terminated.
+                if (m_writer.joinable()) {
+                    m_writer.detach();
+                }
+
+                // Write the messages the writer thread did not get to, unless it was terminated while holding the ring.
+                std::unique_lock consumerLock(m_consumerLock, std::try_to_lock);
+                if (consumerLock.owns_lock()) {
+                    drain();
+                }
+            }
+
+            void enqueue(const char* fmt, va_list va) {
+                if (!m_isRunning.load(std::memory_order_acquire)) {
+                    start();
+                }
+
+                uint64_t ticket = m_enqueueTicket.load(std::memory_order_relaxed);
+                Slot* slot;
+                while (true) {
+                    slot = &m_ring[ticket % RingCapacity];
+                    const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+                    if (sequence == ticket) {
+                        if (m_enqueueTicket.compare_exchange_weak(ticket, ticket + 1, std::memory_order_relaxed)) {
+                            break;
+                        }
+                    } else if (sequence < ticket) {
+                        // The slot still holds a message from the previous lap: the ring is full.
+                        m_droppedMessages.fetch_add(1, std::memory_order_relaxed);
+                        return;
+                    } else {
+                        ticket = m_enqueueTicket.load(std::memory_order_relaxed);
+                    }
+                }
+
+                slot->time = std::time(nullptr);
+                vsnprintf_s(slot->text, sizeof(slot->text), _TRUNCATE, fmt, va);
+                slot->sequence.store(ticket + 1, std::memory_order_release);
+            }
+
+            // Write the pending messages and stop the writer thread.
+            void flush() {
+                std::unique_lock lock(m_lifecycleLock);
+
+                if (m_isRunning.load(std::memory_order_relaxed)) {
+                    m_stop = true;
+                    m_writer.join();
+                    m_stop = false;
+                    m_isRunning.store(false, std::memory_order_release);
+                }
+
+                // Messages might have been queued after the writer thread exited.
+                std::unique_lock consumerLock(m_consumerLock);
+                drain();
+            }
+
+            // Write the pending messages from a crashing thread. This does not stop the writer thread.
+            void flushOnCrash() {
+                // The writer thread might be the one crashing, while it holds the consumer lock.
+                if (std::this_thread::get_id() == m_writer.get_id()) {
+                    return;
+                }
+
+                std::unique_lock consumerLock(m_consumerLock, CrashFlushTimeout);
+                if (consumerLock.owns_lock()) {
+                    drain();
+                }
+            }
+
+          private:
+            void start() {
+                std::unique_lock lock(m_lifecycleLock);
+
+                if (m_isRunning.load(std::memory_order_relaxed)) {
+                    return;
+                }
+
+                m_writer = std::thread([this]() {
+                    while (!m_stop) {
+                        {
+                            std::unique_lock consumerLock(m_consumerLock);
+                            drain();
+                        }
+                        std::this_thread::sleep_for(DrainPeriod);
+                    }
+
+                    std::unique_lock consumerLock(m_consumerLock);
+                    drain();
+                });
+                m_isRunning.store(true, std::memory_order_release);
+            }
+
+            // Must be called with the consumer lock held.
+            void drain() {
+                bool hasMessages = false;
+                while (true) {
+                    Slot& slot = m_ring[m_dequeueTicket % RingCapacity];
+                    if (slot.sequence.load(std::memory_order_acquire) != m_dequeueTicket + 1) {
+                        break;
+                    }
+
+                    write(slot.time, slot.text);
+                    slot.sequence.store(m_dequeueTicket + RingCapacity, std::memory_order_release);
+                    m_dequeueTicket++;
+                    hasMessages = true;
+                }
+
+                const uint64_t droppedMessages = m_droppedMessages.exchange(0, std::memory_order_relaxed);
+                if (droppedMessages) {
+                    char text[64];
+                    sprintf_s(text, sizeof(text), "%llu log messages were dropped\n", droppedMessages);
+                    write(std::time(nullptr), text);
+                    hasMessages = true;
+                }
+
+                if (hasMessages && logStream.is_open()) {
+                    logStream.flush();
+                }
+            }
+
+            static void write(std::time_t time, const char* text) {
+                char buf[MaxMessageLength + 64];
+                size_t offset =
+                    std::strftime(buf, sizeof(buf), "[OXRTK] %Y-%m-%d %H:%M:%S %z: ", std::localtime(&time));
+                strcpy_s(buf + offset, sizeof(buf) - offset, text);
+                OutputDebugStringA(buf);
+                if (logStream.is_open()) {
+                    logStream << buf;
+                }
+            }
+
+            struct Slot {
+                std::atomic<uint64_t> sequence;
+                std::time_t time;
+                char text[MaxMessageLength];
+            };
+
+            Slot m_ring[RingCapacity];
+            std::atomic<uint64_t> m_enqueueTicket{0};
+            uint64_t m_dequeueTicket{0};
+            std::atomic<uint64_t> m_droppedMessages{0};
+
+            std::timed_mutex m_consumerLock;
+
+            std::mutex m_lifecycleLock;
+            std::atomic<bool> m_isRunning{false};
+            std::atomic<bool> m_stop{false};
+            std::thread m_writer;
+        };
+
+        AsyncLogger& GetLogger() {
+            static AsyncLogger logger;
+            return logger;
+        }
+
+        // The vectored handler sees every exception before the application's own handlers, including the ones that
+        // are expected and handled (such as C++ exceptions). Only flush for the exceptions that are usually fatal.
+        LONG WINAPI FlushOnCrash(EXCEPTION_POINTERS* exceptionInfo) {
+            const EXCEPTION_RECORD* record = exceptionInfo->ExceptionRecord;
+            bool isFatal = record->ExceptionFlags & EXCEPTION_NONCONTINUABLE;
+            switch (record->ExceptionCode) {
+            case EXCEPTION_ACCESS_VIOLATION:
+            case EXCEPTION_ARRAY_BOUNDS_EXCEEDED:
+            case EXCEPTION_ILLEGAL_INSTRUCTION:
+            case EXCEPTION_IN_PAGE_ERROR:
+            case EXCEPTION_INT_DIVIDE_BY_ZERO:
+            case EXCEPTION_NONCONTINUABLE_EXCEPTION:
+            case EXCEPTION_PRIV_INSTRUCTION:
+            case EXCEPTION_STACK_OVERFLOW:
+                isFatal = true;
+                break;
+            }
+
+            if (isFatal) {
+                GetLogger().flushOnCrash();
+            }
+
+            // Let the application and the other handlers process the exception.
+            return EXCEPTION_CONTINUE_SEARCH;
+        }
+
+        std::mutex crashHandlerLock;
+        PVOID crashHandler = nullptr;
+
         // Utility logging function.
         void InternalLog(const char* fmt, va_list va) {
-            const std::time_t now = std::time(nullptr);
+            GetLogger().enqueue(fmt, va);
+        }
+
+        // The budget of messages of each LOG_CHANNEL() site.
+        constexpr uint32_t MaxMessagesPerPeriod = 10;
+        constexpr auto RateLimitPeriod = std::chrono::seconds(10);
 
-            char buf[1024];
-            size_t offset =
-                std::strftime(buf, sizeof(buf), "[OXRTK] %Y-%m-%d %H:%M:%S %z: ", std::localtime(&now));
-            vsnprintf_s(buf + offset, sizeof(buf) - offset, _TRUNCATE, fmt, va);
-            OutputDebugStringA(buf);
-            if (logStream.is_open()) {
-                logStream << buf;
-                logStream.flush();
+        std::atomic<Verbosity> channelVerbosity[(size_t)Channel::MaxValue] = {
+            DefaultVerbosity, DefaultVerbosity, DefaultVerbosity, DefaultVerbosity};
+
+        // The LOG_CHANNEL() sites that were used, for FlushLog().
+        std::atomic<LogSite*> logSites{nullptr};
+
+        // The accumulated duration of a startup step.
+        struct StartupStep {
+            std::string name;
+            uint32_t count{0};
+            uint64_t totalUs{0};
+        };
+
+        std::mutex startupStepsLock;
+        std::vector<StartupStep> startupSteps;
+        bool startupTimesLogged = false;
+
+        // The time elapsed since the process was created.
+        uint64_t GetProcessUptimeUs() {
+            FILETIME creationTime, exitTime, kernelTime, userTime, now;
+            if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime)) {
+                return 0;
             }
+            GetSystemTimeAsFileTime(&now);
+
+            // FILETIMEs are in units of 100ns.
+            const auto toUint64 = [](const FILETIME& ft) {
+                return ((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+            };
+            return (toUint64(now) - toUint64(creationTime)) / 10;
         }
     } // namespace
 
@@ -60,4 +298,136 @@ namespace toolkit::log {
 #endif
     }
 
+    void SetVerbosity(Channel channel, Verbosity verbosity) {
+        channelVerbosity[(size_t)channel].store(verbosity, std::memory_order_relaxed);
+    }
+
+    bool IsEnabled(Channel channel, Verbosity verbosity) {
+        return channelVerbosity[(size_t)channel].load(std::memory_order_relaxed) >= verbosity;
+    }
+
+    void LogSite::log(const char* fmt, ...) {
+        const auto now = std::chrono::steady_clock::now();
+        std::unique_lock lock(m_lock);
+
+        if (!std::exchange(m_isRegistered, true)) {
+            m_next = logSites.load(std::memory_order_relaxed);
+            while (!logSites.compare_exchange_weak(m_next, this, std::memory_order_release)) {
+            }
+        }
+
+        if (now - m_periodStart >= RateLimitPeriod) {
+            m_periodStart = now;
+            m_messagesInPeriod = 0;
+        }
+
+        // Past the budget, we do not even format the message.
+        if (m_messagesInPeriod >= MaxMessagesPerPeriod) {
+            m_suppressedMessages++;
+            return;
+        }
+        m_messagesInPeriod++;
+
+        char buf[1024];
+        va_list va;
+        va_start(va, fmt);
+        vsnprintf_s(buf, sizeof(buf), _TRUNCATE, fmt, va);
+        va_end(va);
+
+        if (m_lastMessage == buf) {
+            m_repeatedMessages++;
+            return;
+        }
+
+        flushCountsLocked();
+        m_lastMessage = buf;
+
+        Log("%s", buf);
+    }
+
+    void LogSite::flushCounts() {
+        std::unique_lock lock(m_lock);
+        flushCountsLocked();
+    }
+
+    void LogSite::flushCountsLocked() {
+        // The last message ends with a new line.
+        if (m_repeatedMessages) {
+            Log("Repeated %u times: %s", m_repeatedMessages, m_lastMessage.c_str());
+        }
+        if (m_suppressedMessages) {
+            Log("%u messages suppressed by the rate limit after: %s", m_suppressedMessages, m_lastMessage.c_str());
+        }
+        m_repeatedMessages = m_suppressedMessages = 0;
+    }
+
+    void InstallCrashHandler() {
+        std::unique_lock lock(crashHandlerLock);
+
+        if (!crashHandler) {
+            // Be the last vectored handler, so that the ones from the application get a chance to run first.
+            crashHandler = AddVectoredExceptionHandler(0, FlushOnCrash);
+        }
+    }
+
+    void RemoveCrashHandler() {
+        std::unique_lock lock(crashHandlerLock);
+
+        if (crashHandler) {
+            RemoveVectoredExceptionHandler(crashHandler);
+            crashHandler = nullptr;
+        }
+    }
+
+    void FlushLog() {
+        for (LogSite* site = logSites.load(std::memory_order_acquire); site; site = site->m_next) {
+            site->flushCounts();
+        }
+        GetLogger().flush();
+    }
+
+    void RecordStartupTime(const std::string& step, uint64_t durationUs) {
+        std::unique_lock lock(startupStepsLock);
+
+        if (startupTimesLogged) {
+            return;
+        }
+
+        auto it = std::find_if(
+            startupSteps.begin(), startupSteps.end(), [&](const StartupStep& entry) { return entry.name == step; });
+        if (it == startupSteps.end()) {
+            startupSteps.push_back({step});
+            it = startupSteps.end() - 1;
+        }
+        it->count++;
+        it->totalUs += durationUs;
+    }
+
+    void LogStartupTimes() {
+        std::vector<StartupStep> steps;
+        {
+            std::unique_lock lock(startupStepsLock);
+
+            if (std::exchange(startupTimesLogged, true)) {
+                return;
+            }
+            steps = std::move(startupSteps);
+        }
+
+        // Longest first. Some steps include others (eg: the instance creation includes the configuration reads).
+        std::sort(steps.begin(), steps.end(), [](const StartupStep& a, const StartupStep& b) {
+            return a.totalUs > b.totalUs;
+        });
+
+        Log("First frame submitted %.1fms after the process started, startup steps:\n",
+            GetProcessUptimeUs() / 1000.0);
+        for (const auto& step : steps) {
+            if (step.count > 1) {
+                Log("  %s: %.1fms (%u times)\n", step.name.c_str(), step.totalUs / 1000.0, step.count);
+            } else {
+                Log("  %s: %.1fms\n", step.name.c_str(), step.totalUs / 1000.0);
+            }
+        }
+    }
+
 } // namespace toolkit::log
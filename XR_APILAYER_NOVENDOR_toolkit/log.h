@@ -32,4 +32,96 @@ namespace toolkit::log {
     // Debug logging function. Can make things very slow (only enabled on Debug builds).
     void DebugLog(const char* fmt, ...);
 
+    // The groups of diagnostics whose verbosity can be changed at runtime.
+    enum class Channel { Resolution = 0, Swapchain, HandTracking, Graphics, MaxValue };
+
+    // The names used in the configuration settings.
+    inline const char* const ChannelNames[(size_t)Channel::MaxValue] = {
+        "resolution", "swapchain", "hand_tracking", "graphics"};
+
+    enum class Verbosity { Off = 0, Info, Verbose, MaxValue };
+
+#ifdef _DEBUG
+    constexpr Verbosity DefaultVerbosity = Verbosity::Verbose;
+#else
+    constexpr Verbosity DefaultVerbosity = Verbosity::Info;
+#endif
+
+    void SetVerbosity(Channel channel, Verbosity verbosity);
+    bool IsEnabled(Channel channel, Verbosity verbosity);
+
+    // The state of a call site of LOG_CHANNEL(). Each site formats a limited number of messages per period, and the
+    // messages identical to the previous one are only counted. The counts are written along with the next message, or
+    // by FlushLog().
+    class LogSite {
+      public:
+        void log(const char* fmt, ...);
+
+        // Write the counts of the messages that were not written.
+        void flushCounts();
+
+      private:
+        friend void FlushLog();
+
+        void flushCountsLocked();
+
+        LogSite* m_next{nullptr};
+        bool m_isRegistered{false};
+
+        std::mutex m_lock;
+        std::chrono::steady_clock::time_point m_periodStart;
+        uint32_t m_messagesInPeriod{0};
+        uint32_t m_repeatedMessages{0};
+        uint32_t m_suppressedMessages{0};
+        std::string m_lastMessage;
+    };
+
+    // The messages are written to the log file by a background thread. Write the pending messages now and stop the
+    // thread, which restarts with the next message.
+    void FlushLog();
+
+    // Write the pending messages when the process crashes. The handler is installed once per instance and must be
+    // removed before the DLL might be unloaded.
+    void InstallCrashHandler();
+    void RemoveCrashHandler();
+
+    // Record a notable event (such as a shader compilation) for the flight recorder. The name must be a string literal.
+    // This never blocks and can be called from any thread.
+    void RecordEvent(const char* name);
+
+    // Add the duration of a startup step to the breakdown logged by LogStartupTimes(). The durations of the steps with
+    // the same name are accumulated. This can be called from any thread, and has no effect after the breakdown.
+    void RecordStartupTime(const std::string& step, uint64_t durationUs);
+
+    // Log the breakdown of the startup steps along with the time elapsed since the process was started. Only the first
+    // call has an effect.
+    void LogStartupTimes();
+
+    // Record the duration of the enclosing scope as a startup step.
+    class ScopedStartupTimer {
+      public:
+        ScopedStartupTimer(std::string step) : m_step(std::move(step)), m_start(std::chrono::steady_clock::now()) {
+        }
+
+        ~ScopedStartupTimer() {
+            RecordStartupTime(
+                m_step,
+                std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start)
+                    .count());
+        }
+
+      private:
+        const std::string m_step;
+        const std::chrono::steady_clock::time_point m_start;
+    };
+
 } // namespace toolkit::log
+
+// Log a message in a channel, when enabled at the given verbosity. Nothing is evaluated or formatted otherwise.
+#define LOG_CHANNEL(channel, verbosity, fmt, ...)                                                                      \
+    do {                                                                                                               \
+        static toolkit::log::LogSite logSite;                                                                          \
+        if (toolkit::log::IsEnabled(channel, verbosity)) {                                                             \
+            logSite.log(fmt, ##__VA_ARGS__);                                                                           \
+        }                                                                                                              \
+    } while (false)
@@ -50,8 +50,8 @@ namespace {
     struct MenuEntry {
         std::string title;
         MenuEntryType type;
-#define BUTTON_OR_SEPARATOR "", 0, 0, [](int value) { return ""; }
-        std::string configName;
+#define BUTTON_OR_SEPARATOR SettingId::MaxValue, 0, 0, [](int value) { return ""; }
+        SettingId configId;
         int minValue;
         int maxValue;
         std::function<std::string(int)> valueToString;
@@ -78,63 +78,80 @@ namespace {
             m_lastInput = std::chrono::steady_clock::now();
 
             // We display the hint for menu hotkeys for the first few runs.
-            int firstRun = m_configManager->getValue("first_run");
+            int firstRun = m_configManager->getValue(SettingId::FirstRun);
             if (firstRun <= 10) {
                 m_numSplashLeft = 10 - firstRun;
                 m_state = MenuState::Splash;
-                m_configManager->setValue("first_run", firstRun + 1);
+                m_configManager->setValue(SettingId::FirstRun, firstRun + 1);
             }
 
             // TODO: Add menu entries here.
             m_menuEntries.push_back({"Overlay",
                                      MenuEntryType::Choice,
-                                     SettingOverlayType,
+                                     SettingId::OverlayType,
                                      0,
                                      (int)OverlayType::MaxValue - (m_configManager->isExperimentalMode() ? 1 : 2),
                                      [](int value) {
                                          std::string labels[] = {"Off", "FPS", "Detailed"};
                                          return labels[value];
                                      }});
-            m_configManager->setEnumDefault(SettingOverlayType, OverlayType::None);
             m_menuEntries.push_back({"", MenuEntryType::Separator, BUTTON_OR_SEPARATOR});
             m_menuEntries.push_back({"Upscaling",
                                      MenuEntryType::Choice,
-                                     SettingScalingType,
+                                     SettingId::ScalingType,
                                      0,
                                      (int)ScalingType::MaxValue - 1,
-                                     [](int value) {
+                                     [&](int value) {
                                          std::string labels[] = {"Off", "NIS", "FSR"};
+                                         // Turning off the upscaler only skips it when another stage writes the
+                                         // runtime texture.
+                                         if (value == (int)ScalingType::None && m_stats.isUpscalingBypassIgnored) {
+                                             return labels[value] + " (still upscaling until restart)";
+                                         }
                                          return labels[value];
                                      }});
             m_upscalingGroup.start = m_menuEntries.size();
             m_originalScalingType = getCurrentScalingType();
-            m_menuEntries.push_back({"Factor", MenuEntryType::Slider, SettingScaling, 100, 200, [&](int value) {
+            m_menuEntries.push_back({"Factor", MenuEntryType::Slider, SettingId::Scaling, 100, 200, [&](int value) {
                                          // We don't even use value, the utility function below will query it.
                                          const auto& resolution =
                                              GetScaledDimensions(m_displayWidth, m_displayHeight, value, 2);
+                                         // The applications that do not query the view configuration again keep
+                                         // rendering at the resolution of their swapchains. The applied factor is
+                                         // rounded from the resolutions.
+                                         if (m_stats.appliedScaling &&
+                                             std::abs((int)m_stats.appliedScaling - value) > 1) {
+                                             return fmt::format("{}% ({}x{}, applied {}%)",
+                                                                value,
+                                                                resolution.first,
+                                                                resolution.second,
+                                                                m_stats.appliedScaling);
+                                         }
                                          return fmt::format("{}% ({}x{})", value, resolution.first, resolution.second);
                                      }});
             m_originalScalingValue = getCurrentScaling();
-            m_menuEntries.push_back({"Sharpness", MenuEntryType::Slider, SettingSharpness, 0, 100, [](int value) {
+            m_originalSharpnessValue = m_configManager->getValue(SettingId::Sharpness);
+            m_menuEntries.push_back({"Sharpness", MenuEntryType::Slider, SettingId::Sharpness, 0, 100, [](int value) {
                                          return fmt::format("{}%", value);
                                      }});
             m_upscalingGroup.end = m_menuEntries.size();
             m_menuEntries.push_back({"", MenuEntryType::Separator, BUTTON_OR_SEPARATOR});
 
             // The unit for ICD is tenth of millimeters.
-            m_menuEntries.push_back({"ICD (World Scale)", MenuEntryType::Slider, SettingICD, 1, 10000, [](int value) {
-                                         return fmt::format("{}mm", value / 10.0f);
-                                     }});
+            m_menuEntries.push_back(
+                {"ICD (World Scale)", MenuEntryType::Slider, SettingId::ICD, 1, 10000, [](int value) {
+                     return fmt::format("{}mm", value / 10.0f);
+                 }});
             m_menuEntries.push_back({"FOV",
                                      MenuEntryType::Slider,
-                                     SettingFOV,
+                                     SettingId::FOV,
                                      50,
                                      150,
                                      [](int value) { return fmt::format("{}%", value); },
                                      m_configManager->isExperimentalMode()});
             m_menuEntries.push_back({"Prediction dampening",
                                      MenuEntryType::Slider,
-                                     SettingPredictionDampen,
+                                     SettingId::PredictionDampen,
                                      0,
                                      200,
                                      [&](int value) {
@@ -150,7 +167,7 @@ namespace {
 
             m_menuEntries.push_back({"Hand Tracking",
                                      MenuEntryType::Choice,
-                                     SettingHandTrackingEnabled,
+                                     SettingId::HandTrackingEnabled,
                                      0,
                                      (int)HandTrackingEnabled::MaxValue - 1,
                                      [](int value) {
@@ -163,7 +180,7 @@ namespace {
             m_menuEntries.push_back(
                 {"Hand Visibility",
                  MenuEntryType::Slider,
-                 SettingHandVisibilityAndSkinTone,
+                 SettingId::HandVisibilityAndSkinTone,
                  0,
                  4,
                  [](int value) {
@@ -177,28 +194,42 @@ namespace {
                 m_menuEntries.push_back({"", MenuEntryType::Separator, BUTTON_OR_SEPARATOR});
             }
 
+            for (size_t i = 0; i < (size_t)Channel::MaxValue; i++) {
+                m_menuEntries.push_back({fmt::format("Log {}", ChannelNames[i]),
+                                         MenuEntryType::Choice,
+                                         (SettingId)((size_t)SettingId::LogResolution + i),
+                                         0,
+                                         (int)Verbosity::MaxValue - 1,
+                                         [](int value) {
+                                             std::string labels[] = {"Off", "Info", "Verbose"};
+                                             return labels[value];
+                                         },
+                                         m_configManager->isExperimentalMode()});
+            }
+            if (m_configManager->isExperimentalMode()) {
+                m_menuEntries.push_back({"", MenuEntryType::Separator, BUTTON_OR_SEPARATOR});
+            }
+
             m_menuEntries.push_back({"Font size",
                                      MenuEntryType::Choice,
-                                     SettingMenuFontSize,
+                                     SettingId::MenuFontSize,
                                      0,
                                      (int)MenuFontSize::MaxValue - 1,
                                      [](int value) {
                                          std::string labels[] = {"Small", "Medium", "Large"};
                                          return labels[value];
                                      }});
-            m_configManager->setEnumDefault(SettingMenuFontSize, MenuFontSize::Medium);
             m_menuEntries.push_back({"Menu timeout",
                                      MenuEntryType::Choice,
-                                     SettingMenuTimeout,
+                                     SettingId::MenuTimeout,
                                      0,
                                      (int)MenuTimeout::MaxValue - 1,
                                      [](int value) {
                                          std::string labels[] = {"Short", "Medium", "Long"};
                                          return labels[value];
                                      }});
-            m_configManager->setEnumDefault(SettingMenuTimeout, MenuTimeout::Medium);
             m_menuEntries.push_back(
-                {"Menu eye offset", MenuEntryType::Slider, SettingOverlayEyeOffset, -500, 500, [](int value) {
+                {"Menu eye offset", MenuEntryType::Slider, SettingId::OverlayEyeOffset, -500, 500, [](int value) {
                      return fmt::format("{}px", value);
                  }});
             m_menuEntries.push_back({"Restore defaults", MenuEntryType::RestoreDefaultsButton, BUTTON_OR_SEPARATOR});
@@ -250,22 +281,22 @@ namespace {
                     break;
 
                 default:
-                    const int value = m_configManager->peekValue(menuEntry.configName);
+                    const int value = m_configManager->peekValue(menuEntry.configId);
                     const int newValue =
                         std::clamp(value + (moveLeft ? -1 : 1), menuEntry.minValue, menuEntry.maxValue);
 
                     // When changing the upscaling, people might immediately exit VR to test the change. Bypass the
                     // commit delay.
                     const bool noCommitDelay =
-                        menuEntry.configName == SettingScalingType || menuEntry.configName == SettingScaling;
+                        menuEntry.configId == SettingId::ScalingType || menuEntry.configId == SettingId::Scaling;
 
-                    m_configManager->setValue(menuEntry.configName, newValue, noCommitDelay);
+                    m_configManager->setValue(menuEntry.configId, newValue, noCommitDelay);
 
                     // When changing some settings, display the warning that the session must be restarted.
                     const bool wasRestartNeeded = std::exchange(m_needRestart, checkNeedRestartCondition());
 
                     // When changing the font size or displaying the restart banner, force re-alignment/re-size.
-                    if (menuEntry.configName == SettingMenuFontSize || wasRestartNeeded != m_needRestart) {
+                    if (menuEntry.configId == SettingId::MenuFontSize || wasRestartNeeded != m_needRestart) {
                         m_menuEntriesTitleWidth = 0.0f;
                         m_menuEntriesRight = m_menuEntriesBottom = 0.0f;
                     }
@@ -323,14 +354,16 @@ namespace {
             const auto offset =
                 projectPoint(poseRight, fovRight, rightImageInfo) - projectPoint(poseLeft, fovLeft, leftImageInfo);
 
-            m_configManager->setDefault(SettingOverlayEyeOffset, (int)offset.x);
+            m_configManager->setDefault(SettingId::OverlayEyeOffset, (int)offset.x);
         }
 
-        void render(uint32_t eye, const XrPosef& pose, std::shared_ptr<ITexture> renderTarget) const override {
+        void render(uint32_t eye, const XrPosef& pose, const std::shared_ptr<ITexture>& renderTarget) const override {
             assert(eye == 0 || eye == 1);
 
+            const auto& settings = m_configManager->getSnapshot();
+
             const float leftEyeOffset = 0.0f;
-            const float rightEyeOffset = (float)m_configManager->getValue(SettingOverlayEyeOffset);
+            const float rightEyeOffset = (float)settings.getValue(SettingId::OverlayEyeOffset);
             const float eyeOffset = eye ? rightEyeOffset : leftEyeOffset;
 
             const float leftAlign = (renderTarget->getInfo().width / 4.0f) + eyeOffset;
@@ -342,11 +375,11 @@ namespace {
                 renderTarget->getInfo().height * 0.015f,
                 renderTarget->getInfo().height * 0.02f,
             };
-            const float fontSize = fontSizes[m_configManager->getValue(SettingMenuFontSize)];
+            const float fontSize = fontSizes[settings.getValue(SettingId::MenuFontSize)];
 
             const double timeouts[(int)MenuTimeout::MaxValue] = {3.0, 10.0, 60.0};
             const double timeout =
-                m_state == MenuState::Splash ? 10.0 : timeouts[m_configManager->getValue(SettingMenuTimeout)];
+                m_state == MenuState::Splash ? 10.0 : timeouts[settings.getValue(SettingId::MenuTimeout)];
 
             const auto now = std::chrono::steady_clock::now();
             const auto duration = std::chrono::duration<double>(now - m_lastInput).count();
@@ -435,7 +468,9 @@ namespace {
                         left += menuEntriesTitleWidth;
                     }
 
-                    const int value = m_configManager->peekValue(menuEntry.configName);
+                    // Buttons and separators have no value.
+                    const int value =
+                        menuEntry.configId != SettingId::MaxValue ? settings.getValue(menuEntry.configId) : 0;
 
                     // Display the current value.
                     switch (menuEntry.type) {
@@ -521,7 +556,7 @@ namespace {
                 m_menuEntriesBottom = top + fontSize * 0.2f;
             }
 
-            auto overlayType = m_configManager->getEnumValue<OverlayType>(SettingOverlayType);
+            auto overlayType = settings.getEnumValue<OverlayType>(SettingId::OverlayType);
             if (overlayType != OverlayType::None) {
                 float top = topAlign;
 
@@ -532,24 +567,59 @@ namespace {
 
                 // Advanced displasy.
                 if (overlayType == OverlayType::Advanced) {
-                    m_device->drawString(fmt::format("app CPU: {}", m_stats.appCpuTimeUs), OVERLAY_COMMON);
-                    top += 1.05f * fontSize;
-                    m_device->drawString(fmt::format("app GPU: {}", m_stats.appGpuTimeUs), OVERLAY_COMMON);
-                    top += 1.05f * fontSize;
+                    // Timings as 50th percentile/95th percentile/99th percentile/maximum, since the spikes would vanish
+                    // in an average.
+                    const auto drawPercentiles = [&](const char* label, const FrameTimePercentiles& percentiles) {
+                        m_device->drawString(fmt::format("{}: {}/{}/{}/{}",
+                                                         label,
+                                                         percentiles.p50,
+                                                         percentiles.p95,
+                                                         percentiles.p99,
+                                                         percentiles.max),
+                                             OVERLAY_COMMON);
+                        top += 1.05f * fontSize;
+                    };
+                    const auto drawLatency = [&](const char* label, LatencyMetric metric) {
+                        drawPercentiles(label, m_stats.latency[(size_t)metric]);
+                    };
 
-                    m_device->drawString(fmt::format("lay CPU: {}", m_stats.endFrameCpuTimeUs), OVERLAY_COMMON);
-                    top += 1.05f * fontSize;
+                    drawLatency("app CPU", LatencyMetric::AppCpu);
+                    drawLatency("app GPU", LatencyMetric::AppGpu);
 
-                    m_device->drawString(fmt::format("pre GPU: {}", m_stats.preProcessorGpuTimeUs), OVERLAY_COMMON);
+                    drawLatency("lay CPU", LatencyMetric::EndFrameCpu);
+                    m_device->drawString(fmt::format("lay ALC: {}", m_stats.endFrameAllocations), OVERLAY_COMMON);
                     top += 1.05f * fontSize;
-                    m_device->drawString(fmt::format("scl GPU: {}", m_stats.upscalerGpuTimeUs), OVERLAY_COMMON);
+
+                    drawLatency("pre GPU", LatencyMetric::PreProcessorGpu);
+                    drawLatency("scl GPU", LatencyMetric::UpscalerGpu);
+                    drawLatency("pst GPU", LatencyMetric::PostProcessorGpu);
+
+                    // The breakdown of the stages, as average CPU/GPU times.
+                    for (uint32_t i = 0; i < m_stats.numScopes; i++) {
+                        const auto& scope = m_stats.scopes[i];
+                        if (scope.depth > 0) {
+                            m_device->drawString(
+                                fmt::format("{}: {}/{}", scope.path, scope.cpuTimeUs, scope.gpuTimeUs),
+                                OVERLAY_COMMON);
+                            top += 1.05f * fontSize;
+                        }
+                    }
+                    m_device->drawString(fmt::format("sav MEM: {} MB", m_stats.memorySavedMB), OVERLAY_COMMON);
                     top += 1.05f * fontSize;
-                    m_device->drawString(fmt::format("pst GPU: {}", m_stats.postProcessorGpuTimeUs), OVERLAY_COMMON);
+                    m_device->drawString(fmt::format("gpu LAT: {}", m_stats.lateGpuResults), OVERLAY_COMMON);
                     top += 1.05f * fontSize;
 
-                    m_device->drawString(fmt::format("ovl CPU: {}", m_stats.overlayCpuTimeUs), OVERLAY_COMMON);
-                    top += 1.05f * fontSize;
-                    m_device->drawString(fmt::format("ovl GPU: {}", m_stats.overlayGpuTimeUs), OVERLAY_COMMON);
+                    drawLatency("ovl CPU", LatencyMetric::OverlayCpu);
+                    drawLatency("ovl GPU", LatencyMetric::OverlayGpu);
+                    drawLatency("prd TIM", LatencyMetric::Prediction);
+
+                    // Frame pacing.
+                    drawPercentiles("wai CPU", m_stats.pacing.waitFrameUs);
+                    drawPercentiles("w2b CPU", m_stats.pacing.waitToBeginUs);
+                    drawPercentiles("b2e CPU", m_stats.pacing.beginToEndUs);
+                    drawPercentiles("end CPU", m_stats.pacing.endFrameUs);
+                    drawPercentiles("dsp PER", m_stats.pacing.displayPeriodUs);
+                    m_device->drawString(fmt::format("mis FRM: {}", m_stats.pacing.missedFrames), OVERLAY_COMMON);
                     top += 1.05f * fontSize;
                 }
 #undef OVERLAY_COMMON
@@ -562,16 +632,16 @@ namespace {
 
       private:
         ScalingType getCurrentScalingType() const {
-            return m_configManager->getEnumValue<ScalingType>(SettingScalingType);
+            return m_configManager->getEnumValue<ScalingType>(SettingId::ScalingType);
         }
 
-        bool isHandTrackingEnabled() const {
-            return m_isHandTrackingSupported && m_configManager->getEnumValue<HandTrackingEnabled>(
-                                                    SettingHandTrackingEnabled) != HandTrackingEnabled::Off;
+        uint32_t getCurrentScaling() const {
+            return m_configManager->getValue(SettingId::Scaling);
         }
 
-        uint32_t getCurrentScaling() const {
-            return m_configManager->getValue(SettingScaling);
+        bool isHandTrackingEnabled() const {
+            return m_isHandTrackingSupported && m_configManager->getEnumValue<HandTrackingEnabled>(
+                                                    SettingId::HandTrackingEnabled) != HandTrackingEnabled::Off;
         }
 
         bool checkNeedRestartCondition() const {
@@ -580,8 +650,17 @@ namespace {
                 return true;
             }
 
+            // A higher upscaling factor is rendered inside the swapchains that the application created, but a lower one
+            // needs larger swapchains, which the application only creates with the session.
             if (m_originalScalingType != ScalingType::None) {
-                return m_originalScalingValue != getCurrentScaling();
+                if (getCurrentScaling() < m_originalScalingValue) {
+                    return true;
+                }
+
+                // Without scaling nor sharpening, the upscaler is removed from the chains when the swapchains are
+                // created.
+                return m_originalScalingValue == 100 && m_originalSharpnessValue == 0 &&
+                       (m_configManager->getValue(SettingId::Sharpness) != 0 || getCurrentScaling() != 100);
             }
 
             return false;
@@ -606,6 +685,7 @@ namespace {
         MenuGroup m_handTrackingGroup;
 
         uint32_t m_originalScalingValue{0};
+        int m_originalSharpnessValue{0};
         ScalingType m_originalScalingType{ScalingType::None};
         bool m_originalHandTrackingEnabled{false};
         bool m_needRestart{false};
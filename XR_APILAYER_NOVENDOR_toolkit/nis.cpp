@@ -55,6 +55,9 @@ namespace {
                     uint32_t outputHeight)
             : m_configManager(configManager), m_device(graphicsDevice), m_outputWidth(outputWidth),
               m_outputHeight(outputHeight) {
+            m_sharpness = m_configManager->getSnapshot().getValue(SettingId::Sharpness);
+            m_noSharpening = m_sharpness == 0;
+
             // Identify the GPU architecture in order to infer the best settings for the shader.
             NISGPUArchitecture gpuArch = NISGPUArchitecture::NVIDIA_Generic;
             std::string lowercaseDeviceName = m_device->getDeviceName();
@@ -74,67 +77,76 @@ namespace {
             m_blockHeight = opt.GetOptimalBlockHeight();
             m_threadGroupSize = opt.GetOptimalThreadGroupSize();
 
-            // The upscaling factor is only read upon initialization of the session. It cannot be changed after.
-            std::tie(m_inputWidth, m_inputHeight) = utilities::GetScaledDimensions(
-                m_outputWidth, m_outputHeight, m_configManager->getValue(SettingScaling), 2);
-
-            if (m_inputWidth != m_outputWidth || m_inputHeight != m_outputHeight) {
-                initializeScaler();
-            } else {
-                initializeSharpen();
-            }
+            // Both variants are created upfront, since each frame may either scale or only sharpen its region.
+            initializeScaler();
+            initializeSharpen();
 
+            // Each view has its own constants, since they are both uploaded within the same frame.
             // TODO: Consider making immutable and create a new buffer in update(). For now, our D3D12 implementation
             // does not do heap descriptor recycling.
-            m_configBuffer = m_device->createBuffer(sizeof(NISConfig), "NIS Configuration CB");
-            update();
+            for (uint32_t i = 0; i < ViewCount; i++) {
+                m_views[i].configBuffer =
+                    m_device->createBuffer(sizeof(NISConfig), fmt::format("NIS Configuration {} CB", i));
+                m_views[i].scaleScope = m_device->registerProfilingScope(fmt::format("Scale eye{}", i));
+                m_views[i].sharpenScope = m_device->registerProfilingScope(fmt::format("Sharpen eye{}", i));
+            }
+            m_scope = m_device->registerProfilingScope("NIS");
         }
 
-        void update() override {
-            if (m_configManager->hasChanged(SettingSharpness)) {
-                const float sharpness = m_configManager->getValue(SettingSharpness) / 100.0f;
-
-                NISConfig config;
-                if (!m_isSharpenOnly) {
-                    NVScalerUpdateConfig(config,
-                                         sharpness,
-                                         0,
-                                         0,
-                                         m_inputWidth,
-                                         m_inputHeight,
-                                         m_inputWidth,
-                                         m_inputHeight,
-                                         0,
-                                         0,
-                                         m_outputWidth,
-                                         m_outputHeight,
-                                         m_outputWidth,
-                                         m_outputHeight,
-                                         NISHDRMode::None);
-                } else {
-                    NVSharpenUpdateConfig(config,
-                                          sharpness,
-                                          0,
-                                          0,
-                                          m_inputWidth,
-                                          m_inputHeight,
-                                          m_inputWidth,
-                                          m_inputHeight,
-                                          0,
-                                          0,
-                                          NISHDRMode::None);
-                }
+        StageRequirements getRequirements() const override {
+            StageRequirements requirements;
+            requirements.outputWidth = m_outputWidth;
+            requirements.outputHeight = m_outputHeight;
+            requirements.outputUsage = XR_SWAPCHAIN_USAGE_UNORDERED_ACCESS_BIT;
+            return requirements;
+        }
+
+        bool isIdentity() const override {
+            // Without any scaling, the only effect is the sharpening.
+            return m_noSharpening;
+        }
 
-                m_configBuffer->uploadData(&config, sizeof(config));
+        void update(const SettingsSnapshot& settings) override {
+            // The constants are uploaded with the next frame, once the input resolution is known.
+            const int sharpness = settings.getValue(SettingId::Sharpness);
+            if (sharpness != m_sharpness) {
+                m_sharpness = sharpness;
+                m_noSharpening = m_sharpness == 0;
+                for (auto& view : m_views) {
+                    view.needConfigUpdate = true;
+                }
             }
         }
 
-        void upscale(std::shared_ptr<ITexture> input, std::shared_ptr<ITexture> output, int32_t slice = -1) override {
-            m_device->setShader(!input->isArray() ? m_shader : m_shaderVPRT);
-            m_device->setShaderInput(0, m_configBuffer);
+        void upscale(const std::shared_ptr<ITexture>& input,
+                     const std::shared_ptr<ITexture>& output,
+                     const ViewRegion& region,
+                     const std::shared_ptr<IShaderBuffer>& visibilityMask,
+                     int32_t slice = -1) override {
+            auto& view = m_views[region.view];
+            if (view.needConfigUpdate || memcmp(&region.input, &view.input, sizeof(XrRect2Di)) ||
+                memcmp(&region.output, &view.output, sizeof(XrRect2Di)) ||
+                input->getInfo().width != view.inputTextureWidth ||
+                input->getInfo().height != view.inputTextureHeight) {
+                view.input = region.input;
+                view.output = region.output;
+                view.inputTextureWidth = input->getInfo().width;
+                view.inputTextureHeight = input->getInfo().height;
+                view.isSharpenOnly = region.input.extent.width == region.output.extent.width &&
+                                     region.input.extent.height == region.output.extent.height;
+                updateConfig(view, output->getInfo());
+            }
+
+            const auto& shaders = view.isSharpenOnly ? m_sharpenShaders : m_scalerShaders;
+
+            ScopedProfiling scope(*m_device, m_scope);
+            ScopedProfiling passScope(*m_device, view.isSharpenOnly ? view.sharpenScope : view.scaleScope);
+            m_device->setShader(!input->isArray() ? shaders[0] : shaders[1]);
+            m_device->setShaderInput(0, view.configBuffer);
+            m_device->setShaderInput(1, visibilityMask);
             m_device->setShaderInput(0, input, slice);
             m_device->setShaderOutput(0, output, slice);
-            if (!m_isSharpenOnly) {
+            if (!view.isSharpenOnly) {
                 m_device->setShaderInput(1, m_coefScale);
                 m_device->setShaderInput(2, m_coefUSM);
             }
@@ -143,6 +155,57 @@ namespace {
         }
 
       private:
+        // The regions processed for a view, and the constants derived from them.
+        struct ViewState {
+            XrRect2Di input{};
+            XrRect2Di output{};
+            uint32_t inputTextureWidth{0};
+            uint32_t inputTextureHeight{0};
+            bool isSharpenOnly{false};
+            bool needConfigUpdate{true};
+            std::shared_ptr<IShaderBuffer> configBuffer;
+            ProfilingScopeId scaleScope;
+            ProfilingScopeId sharpenScope;
+        };
+
+        void updateConfig(ViewState& view, const XrSwapchainCreateInfo& outputInfo) {
+            const float sharpness = m_sharpness / 100.0f;
+
+            NISConfig config;
+            if (!view.isSharpenOnly) {
+                NVScalerUpdateConfig(config,
+                                     sharpness,
+                                     view.input.offset.x,
+                                     view.input.offset.y,
+                                     view.input.extent.width,
+                                     view.input.extent.height,
+                                     view.inputTextureWidth,
+                                     view.inputTextureHeight,
+                                     view.output.offset.x,
+                                     view.output.offset.y,
+                                     view.output.extent.width,
+                                     view.output.extent.height,
+                                     outputInfo.width,
+                                     outputInfo.height,
+                                     NISHDRMode::None);
+            } else {
+                NVSharpenUpdateConfig(config,
+                                      sharpness,
+                                      view.input.offset.x,
+                                      view.input.offset.y,
+                                      view.input.extent.width,
+                                      view.input.extent.height,
+                                      view.inputTextureWidth,
+                                      view.inputTextureHeight,
+                                      view.output.offset.x,
+                                      view.output.offset.y,
+                                      NISHDRMode::None);
+            }
+
+            view.configBuffer->uploadData(&config, sizeof(config));
+            view.needConfigUpdate = false;
+        }
+
         void initializeScaler() {
             const auto shadersDir = std::filesystem::path(dllHome) / std::filesystem::path("shaders");
             const auto shaderPath = shadersDir / std::filesystem::path("NIS.hlsl");
@@ -159,13 +222,15 @@ namespace {
                 (unsigned int)std::ceil(m_outputHeight / float(m_blockHeight)),
                 1};
 
-            m_shader = m_device->createComputeShader(
+            m_scalerShaders[0] = m_device->createComputeShader(
                 shaderPath.string(), "main", "NISScaler CS", threadGroups, defines.get(), shadersDir.string());
 
             defines.add("VPRT", true);
-            m_shaderVPRT = m_device->createComputeShader(
+            m_scalerShaders[1] = m_device->createComputeShader(
                 shaderPath.string(), "main", "NISScaler VPRT CS", threadGroups, defines.get(), shadersDir.string());
 
+            ScopedStartupTimer startupTimer("NIS coefficients upload");
+
             const int rowPitch = kFilterSize * 4;
             const int rowPitchAligned = Align(rowPitch, m_device->getTextureAlignmentConstraint());
             const int coefSize = rowPitchAligned * kPhaseCount;
@@ -191,8 +256,6 @@ namespace {
                 m_coefUSM = m_device->createTexture(
                     info, "NIS USM Coefficients TEX2D", rowPitch, coefSize, (void*)m_coefAligned.data());
             }
-
-            m_isSharpenOnly = false;
         }
 
         void initializeSharpen() {
@@ -211,15 +274,12 @@ namespace {
                 (unsigned int)std::ceil(m_outputHeight / float(m_blockHeight)),
                 1};
 
-            m_shader = m_device->createComputeShader(
+            m_sharpenShaders[0] = m_device->createComputeShader(
                 shaderPath.string(), "main", "NISSharpen CS", threadGroups, defines.get(), shadersDir.string());
 
             defines.add("VPRT", true);
-            m_shaderVPRT = m_device->createComputeShader(
+            m_sharpenShaders[1] = m_device->createComputeShader(
                 shaderPath.string(), "main", "NISSharpen VPRT CS", threadGroups, defines.get(), shadersDir.string());
-
-            // Sharpen does not use the coefficient inputs.
-            m_isSharpenOnly = true;
         }
 
         // Taken directly from /NVIDIAImageScaling/samples/DX12/src/NVScaler.cpp.
@@ -243,12 +303,16 @@ namespace {
         uint32_t m_blockWidth;
         uint32_t m_blockHeight;
         uint32_t m_threadGroupSize;
-        uint32_t m_inputWidth;
-        uint32_t m_inputHeight;
-        std::shared_ptr<IComputeShader> m_shader;
-        std::shared_ptr<IComputeShader> m_shaderVPRT;
-        bool m_isSharpenOnly{false};
-        std::shared_ptr<IShaderBuffer> m_configBuffer;
+
+        ViewState m_views[ViewCount];
+        ProfilingScopeId m_scope;
+        int m_sharpness{0};
+        bool m_noSharpening{false};
+
+        // The regular and VPRT variants of each shader. Sharpen does not use the coefficient inputs.
+        // The thread groups cover the resolution of one view.
+        std::shared_ptr<IComputeShader> m_scalerShaders[2];
+        std::shared_ptr<IComputeShader> m_sharpenShaders[2];
         std::shared_ptr<ITexture> m_coefScale;
         std::shared_ptr<ITexture> m_coefUSM;
     };
@@ -0,0 +1,317 @@
+// MIT License
+//
+// Copyright(c) 2021-2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "factories.h"
+#include "interfaces.h"
+#include "log.h"
+
+namespace {
+
+    using namespace toolkit;
+    using namespace toolkit::log;
+    using namespace toolkit::utilities;
+
+    // Enough for a few seconds at 120Hz without reallocating.
+    constexpr size_t InitialFrameCapacity = 500;
+
+    // The frames between xrWaitFrame() and xrEndFrame(). Applications pipelining their frames have at most 2 in flight.
+    constexpr size_t MaxInflightFrames = 4;
+
+    // The rows of the recording, one per statistics window. The writer drains them periodically.
+    constexpr size_t RowRingCapacity = 64;
+    constexpr auto DrainPeriod = std::chrono::milliseconds(500);
+
+    // The durations measured for one frame, in microseconds.
+    struct FrameRecord {
+        uint64_t waitFrameUs;
+        uint64_t waitToBeginUs;
+        uint64_t beginToEndUs;
+        uint64_t endFrameUs;
+        uint64_t displayPeriodUs;
+    };
+
+    class FrameAnalyzer : public IFrameAnalyzer {
+        using clock = std::chrono::steady_clock;
+
+        // A frame being measured, identified by the display time returned to the application.
+        struct InflightFrame {
+            XrTime frameTime{0};
+            bool begun{false};
+            clock::time_point waitFrameEnd;
+            clock::time_point beginFrame;
+            clock::time_point endFrameStart;
+            FrameRecord record{};
+        };
+
+        // One row of the recording.
+        struct RecordRow {
+            std::time_t time;
+            size_t frames;
+            FramePacingStatistics stats;
+        };
+
+      public:
+        FrameAnalyzer(const std::optional<std::string>& recordFile) {
+            m_frames.reserve(InitialFrameCapacity);
+            m_windowFrames.reserve(InitialFrameCapacity);
+            m_scratch.reserve(InitialFrameCapacity);
+
+            if (recordFile) {
+                m_recordStream.open(recordFile.value());
+                if (m_recordStream.is_open()) {
+                    Log("Recording frame pacing to %s\n", recordFile.value().c_str());
+                    m_recordStream << "time,frames,missed";
+                    for (const auto name : {"wait", "wait_to_begin", "begin_to_end", "end_frame", "display_period"}) {
+                        m_recordStream << "," << name << "_p50," << name << "_p99," << name << "_max";
+                    }
+                    m_recordStream << "\n";
+
+                    m_writer = std::thread([this]() {
+                        while (!m_stop) {
+                            drain();
+                            std::this_thread::sleep_for(DrainPeriod);
+                        }
+                        drain();
+                    });
+                } else {
+                    Log("Failed to open %s\n", recordFile.value().c_str());
+                }
+            }
+        }
+
+        ~FrameAnalyzer() override {
+            m_stop = true;
+            if (m_writer.joinable()) {
+                m_writer.join();
+            }
+        }
+
+        void onWaitFrameStart() override {
+            const auto now = clock::now();
+
+            std::unique_lock lock(m_mutex);
+            m_waitFrameStart = now;
+        }
+
+        void onWaitFrameEnd(XrTime frameTime, XrTime predictedDisplayTime, XrDuration predictedDisplayPeriod) override {
+            const auto now = clock::now();
+
+            std::unique_lock lock(m_mutex);
+
+            // Reuse the slot of a frame that was never submitted if needed.
+            InflightFrame* frame = &m_inflight[0];
+            for (auto& slot : m_inflight) {
+                if (!slot.frameTime) {
+                    frame = &slot;
+                    break;
+                }
+                if (slot.waitFrameEnd < frame->waitFrameEnd) {
+                    frame = &slot;
+                }
+            }
+            *frame = {};
+            frame->frameTime = frameTime;
+            frame->waitFrameEnd = now;
+            frame->record.waitFrameUs = elapsedUs(m_waitFrameStart, now);
+            frame->record.displayPeriodUs = predictedDisplayPeriod / 1000;
+            m_lastWaitedFrame = frame;
+
+            // A display time advancing by more than one period means that frames were missed.
+            if (m_lastPredictedDisplayTime && predictedDisplayPeriod > 0) {
+                const XrDuration delta = predictedDisplayTime - m_lastPredictedDisplayTime;
+                const int64_t periods = (delta + predictedDisplayPeriod / 2) / predictedDisplayPeriod;
+                if (periods > 1) {
+                    m_missedFrames += (uint32_t)(periods - 1);
+                    m_totalMissedFrames += (uint32_t)(periods - 1);
+                }
+            }
+            m_lastPredictedDisplayTime = predictedDisplayTime;
+        }
+
+        void onBeginFrame() override {
+            const auto now = clock::now();
+
+            // xrBeginFrame() always begins the frame from the last xrWaitFrame().
+            std::unique_lock lock(m_mutex);
+            InflightFrame* frame = std::exchange(m_lastWaitedFrame, nullptr);
+            if (frame) {
+                frame->begun = true;
+                frame->beginFrame = now;
+                frame->record.waitToBeginUs = elapsedUs(frame->waitFrameEnd, now);
+            }
+        }
+
+        void onEndFrameStart(XrTime frameTime) override {
+            const auto now = clock::now();
+
+            std::unique_lock lock(m_mutex);
+            InflightFrame* frame = findFrame(frameTime);
+            if (frame) {
+                frame->endFrameStart = now;
+                frame->record.beginToEndUs = elapsedUs(frame->beginFrame, now);
+            }
+        }
+
+        void onEndFrameEnd(XrTime frameTime) override {
+            const auto now = clock::now();
+
+            std::unique_lock lock(m_mutex);
+            InflightFrame* frame = findFrame(frameTime);
+            if (frame) {
+                frame->record.endFrameUs = elapsedUs(frame->endFrameStart, now);
+                m_frames.push_back(frame->record);
+
+                frame->frameTime = 0;
+                if (m_lastWaitedFrame == frame) {
+                    m_lastWaitedFrame = nullptr;
+                }
+            }
+        }
+
+        FramePacingStatistics computeStatistics() override {
+            // Start a new window, and compute the statistics outside of the lock.
+            FramePacingStatistics stats;
+            {
+                std::unique_lock lock(m_mutex);
+                m_windowFrames.clear();
+                std::swap(m_frames, m_windowFrames);
+                stats.missedFrames = std::exchange(m_missedFrames, 0);
+            }
+
+            stats.waitFrameUs = computePercentiles(&FrameRecord::waitFrameUs);
+            stats.waitToBeginUs = computePercentiles(&FrameRecord::waitToBeginUs);
+            stats.beginToEndUs = computePercentiles(&FrameRecord::beginToEndUs);
+            stats.endFrameUs = computePercentiles(&FrameRecord::endFrameUs);
+            stats.displayPeriodUs = computePercentiles(&FrameRecord::displayPeriodUs);
+
+            // The row is written by the writer thread. There is a single producer and a single consumer.
+            if (m_writer.joinable()) {
+                const uint64_t writeIndex = m_writeIndex.load(std::memory_order_relaxed);
+                if (writeIndex - m_readIndex.load(std::memory_order_acquire) < RowRingCapacity) {
+                    m_rows[writeIndex % RowRingCapacity] = {std::time(nullptr), m_windowFrames.size(), stats};
+                    m_writeIndex.store(writeIndex + 1, std::memory_order_release);
+                }
+            }
+
+            return stats;
+        }
+
+        uint32_t getTotalMissedFrames() const override {
+            return m_totalMissedFrames;
+        }
+
+      private:
+        static uint64_t elapsedUs(clock::time_point start, clock::time_point end) {
+            return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        }
+
+        InflightFrame* findFrame(XrTime frameTime) {
+            for (auto& slot : m_inflight) {
+                if (slot.frameTime && slot.frameTime == frameTime && slot.begun) {
+                    return &slot;
+                }
+            }
+            return nullptr;
+        }
+
+        FrameTimePercentiles computePercentiles(uint64_t FrameRecord::*field) {
+            FrameTimePercentiles percentiles;
+            if (m_windowFrames.empty()) {
+                return percentiles;
+            }
+
+            m_scratch.clear();
+            for (const auto& frame : m_windowFrames) {
+                m_scratch.push_back(frame.*field);
+            }
+
+            // Partial sorts are enough to find each rank.
+            auto rank = [&](size_t percent) {
+                const auto nth = m_scratch.begin() + (m_scratch.size() - 1) * percent / 100;
+                std::nth_element(m_scratch.begin(), nth, m_scratch.end());
+                return *nth;
+            };
+            percentiles.p50 = rank(50);
+            percentiles.p95 = rank(95);
+            percentiles.p99 = rank(99);
+            percentiles.max = *std::max_element(m_scratch.begin(), m_scratch.end());
+
+            return percentiles;
+        }
+
+        void drain() {
+            uint64_t readIndex = m_readIndex.load(std::memory_order_relaxed);
+            const uint64_t writeIndex = m_writeIndex.load(std::memory_order_acquire);
+            if (readIndex == writeIndex) {
+                return;
+            }
+
+            for (; readIndex != writeIndex; readIndex++) {
+                const RecordRow row = m_rows[readIndex % RowRingCapacity];
+                m_readIndex.store(readIndex + 1, std::memory_order_release);
+
+                m_recordStream << row.time << "," << row.frames << "," << row.stats.missedFrames;
+                for (const auto& percentiles : {row.stats.waitFrameUs,
+                                                row.stats.waitToBeginUs,
+                                                row.stats.beginToEndUs,
+                                                row.stats.endFrameUs,
+                                                row.stats.displayPeriodUs}) {
+                    m_recordStream << "," << percentiles.p50 << "," << percentiles.p99 << "," << percentiles.max;
+                }
+                m_recordStream << "\n";
+            }
+            m_recordStream.flush();
+        }
+
+        // xrWaitFrame() may be called from a different thread than xrBeginFrame() and xrEndFrame().
+        std::mutex m_mutex;
+        clock::time_point m_waitFrameStart;
+        XrTime m_lastPredictedDisplayTime{0};
+        InflightFrame m_inflight[MaxInflightFrames];
+        InflightFrame* m_lastWaitedFrame{nullptr};
+        std::vector<FrameRecord> m_frames;
+        uint32_t m_missedFrames{0};
+        std::atomic<uint32_t> m_totalMissedFrames{0};
+
+        // Only accessed by computeStatistics().
+        std::vector<FrameRecord> m_windowFrames;
+        std::vector<uint64_t> m_scratch;
+
+        std::ofstream m_recordStream;
+        RecordRow m_rows[RowRingCapacity];
+        std::atomic<uint64_t> m_writeIndex{0};
+        std::atomic<uint64_t> m_readIndex{0};
+        std::atomic<bool> m_stop{false};
+        std::thread m_writer;
+    };
+
+} // namespace
+
+namespace toolkit::utilities {
+
+    std::shared_ptr<IFrameAnalyzer> CreateFrameAnalyzer(const std::optional<std::string>& recordFile) {
+        return std::make_shared<FrameAnalyzer>(recordFile);
+    }
+
+} // namespace toolkit::utilities
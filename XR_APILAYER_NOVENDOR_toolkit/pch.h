@@ -25,8 +25,11 @@
 #define Align(value, pad_to) (((value) + (pad_to)-1) & ~((pad_to)-1))
 
 // Standard library.
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <cstdarg>
 #include <ctime>
 #include <deque>
@@ -38,13 +41,17 @@
 #include <string>
 #include <memory>
 #include <map>
+#include <mutex>
 #include <optional>
 #include <set>
 #include <thread>
+#include <utility>
 #include <vector>
 
 using namespace std::chrono_literals;
 
+#ifndef TOOLKIT_HEADLESS
+
 // Windows header files.
 #define WIN32_LEAN_AND_MEAN             // Exclude rarely-used stuff from Windows headers
 #include <windows.h>
@@ -81,5 +88,13 @@ using Microsoft::WRL::ComPtr;
 // FW1FontWrapper.
 #include "FW1FontWrapper.h"
 
+#else
+
+// The headless builds (the tests) only compile the platform-independent parts of the layer, against stand-ins for the
+// few Windows, Direct3D and OpenXR definitions that they need.
+#include "headless.h"
+
+#endif
+
 // FMT formatter.
 #include <fmt/core.h>
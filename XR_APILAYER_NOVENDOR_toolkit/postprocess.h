@@ -23,7 +23,12 @@
 #ifndef _POST_PROCESS_H_
 #define _POST_PROCESS_H_
 
-#define POST_PROCESS_CONFIG
+// The rectangle of the source texture to process (in normalized coordinates).
+#define POST_PROCESS_CONFIG                                                                                            \
+    float SourceOffsetX;                                                                                               \
+    float SourceOffsetY;                                                                                               \
+    float SourceScaleX;                                                                                                \
+    float SourceScaleY;
 
 #ifdef _WINDOWS
 __declspec(align(256))
@@ -21,6 +21,7 @@
 // SOFTWARE.
 
 #include "postprocess.h"
+#include "visibilitymask.h"
 
 cbuffer config : register(b0) {
     POST_PROCESS_CONFIG;
@@ -37,5 +38,12 @@ Texture2DArray sourceTexture : register(t0);
 
 // For now, our shader only does a copy, effectively allowing Direct3D to convert between color formats.
 float4 main(in float4 position : SV_POSITION, in float2 texcoord : TEXCOORD0) : SV_TARGET {
-    return SAMPLE_TEXTURE(sourceTexture, texcoord);
+    // Skip the pixels that are hidden by the lenses.
+    if (!IsRegionVisible(texcoord, texcoord)) {
+        return float4(0, 0, 0, 1);
+    }
+
+    // The quad covers the output viewport, sample the corresponding rectangle of the source.
+    const float2 sourceTexcoord = float2(SourceOffsetX, SourceOffsetY) + texcoord * float2(SourceScaleX, SourceScaleY);
+    return SAMPLE_TEXTURE(sourceTexture, sourceTexcoord);
 }
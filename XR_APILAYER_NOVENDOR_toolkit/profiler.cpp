@@ -0,0 +1,189 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pch.h"
+
+#include "factories.h"
+#include "interfaces.h"
+#include "log.h"
+
+namespace {
+
+    using namespace toolkit;
+    using namespace toolkit::graphics;
+    using namespace toolkit::log;
+
+    struct Measurement {
+        std::shared_ptr<utilities::ICpuTimer> cpuTimer;
+        std::shared_ptr<IGpuTimer> gpuTimer;
+    };
+
+    struct Scope {
+        ProfilingScopeId id;
+        std::string path;
+        uint32_t depth{0};
+
+        // The scopes entered from this one, as indices into the scopes.
+        std::vector<size_t> children;
+
+        // The measurements of each frame in-flight, reused from one frame to the next.
+        std::vector<Measurement> measurements[GpuTimerLatency + 1];
+        uint32_t numUsed[GpuTimerLatency + 1]{};
+    };
+
+    class Profiler : public IProfiler {
+      public:
+        Profiler(IDevice& device) : m_device(device) {
+        }
+
+        ProfilingScopeId registerScope(const std::string& name) override {
+            const auto it = std::find(m_names.cbegin(), m_names.cend(), name);
+            if (it != m_names.cend()) {
+                return (ProfilingScopeId)(it - m_names.cbegin());
+            }
+
+            m_names.push_back(name);
+            return (ProfilingScopeId)(m_names.size() - 1);
+        }
+
+        void pushScope(ProfilingScopeId id) override {
+            assert(id < m_names.size());
+
+            // A scope only has a handful of children, and a linear search is cheaper than any lookup by path.
+            const auto& children = m_stack.empty() ? m_roots : m_scopes[m_stack.back().first].children;
+            const auto it = std::find_if(
+                children.cbegin(), children.cend(), [&](size_t child) { return m_scopes[child].id == id; });
+
+            size_t index;
+            if (it != children.cend()) {
+                index = *it;
+            } else {
+                index = addScope(id);
+            }
+
+            auto& scope = m_scopes[index];
+            auto& measurements = scope.measurements[m_frameIndex];
+            auto& numUsed = scope.numUsed[m_frameIndex];
+            if (numUsed == measurements.size()) {
+                measurements.push_back({utilities::CreateCpuTimer(), m_device.createTimer()});
+            }
+            m_stack.push_back({index, numUsed});
+
+            const auto& measurement = measurements[numUsed++];
+            measurement.cpuTimer->start();
+            measurement.gpuTimer->start();
+        }
+
+        void popScope() override {
+            assert(!m_stack.empty());
+
+            const auto [index, slot] = m_stack.back();
+            m_stack.pop_back();
+
+            const auto& measurement = m_scopes[index].measurements[m_frameIndex][slot];
+            measurement.gpuTimer->stop();
+            measurement.cpuTimer->stop();
+        }
+
+        const std::vector<ProfilingResult>& nextFrame() override {
+            assert(m_stack.empty());
+
+            // The oldest frame in-flight is the next one to be recorded.
+            m_frameIndex = (m_frameIndex + 1) % (GpuTimerLatency + 1);
+
+            m_results.resize(m_scopes.size());
+            for (size_t i = 0; i < m_scopes.size(); i++) {
+                auto& scope = m_scopes[i];
+                auto& result = m_results[i];
+                if (result.path.empty()) {
+                    result.path = scope.path;
+                    result.depth = scope.depth;
+                }
+
+                result.count = std::exchange(scope.numUsed[m_frameIndex], 0);
+                result.cpuTimeUs = result.gpuTimeUs = 0;
+                result.numLateGpuResults = 0;
+                result.cpuSpans.clear();
+                result.gpuSpans.clear();
+                for (uint32_t j = 0; j < result.count; j++) {
+                    const auto& measurement = scope.measurements[m_frameIndex][j];
+                    result.cpuTimeUs += measurement.cpuTimer->query();
+                    const auto gpuTimeUs = measurement.gpuTimer->query();
+                    if (gpuTimeUs) {
+                        result.gpuTimeUs += gpuTimeUs.value();
+                    } else {
+                        result.numLateGpuResults++;
+                    }
+
+                    uint64_t startUs, endUs;
+                    if (measurement.cpuTimer->consumeTimestamps(startUs, endUs)) {
+                        result.cpuSpans.push_back({startUs, endUs});
+                    }
+                    if (measurement.gpuTimer->consumeTimestamps(startUs, endUs)) {
+                        result.gpuSpans.push_back({startUs, endUs});
+                    }
+                }
+            }
+
+            return m_results;
+        }
+
+      private:
+        size_t addScope(ProfilingScopeId id) {
+            const size_t index = m_scopes.size();
+            if (m_stack.empty()) {
+                m_scopes.push_back({id, m_names[id], 0 /* depth */, {}, {}, {}});
+                m_roots.push_back(index);
+            } else {
+                const size_t parent = m_stack.back().first;
+                m_scopes.push_back(
+                    {id, m_scopes[parent].path + "/" + m_names[id], (uint32_t)m_stack.size(), {}, {}, {}});
+                m_scopes[parent].children.push_back(index);
+            }
+            return index;
+        }
+
+        IDevice& m_device;
+
+        std::vector<std::string> m_names;
+
+        // The scopes in the order they were first entered, which lists the children after their parent.
+        std::vector<Scope> m_scopes;
+        std::vector<size_t> m_roots;
+
+        // The scopes being measured, and which of their measurements is used.
+        std::vector<std::pair<size_t, uint32_t>> m_stack;
+
+        uint32_t m_frameIndex{0};
+        std::vector<ProfilingResult> m_results;
+    };
+
+} // namespace
+
+namespace toolkit::graphics {
+
+    std::shared_ptr<IProfiler> CreateProfiler(IDevice& device) {
+        return std::make_shared<Profiler>(device);
+    }
+
+} // namespace toolkit::graphics
@@ -36,6 +36,15 @@ namespace toolkit::utilities::shader {
                               const D3D_SHADER_MACRO* defines = nullptr,
                               ID3DInclude* includes = nullptr,
                               const std::string& target = "cs_5_0") {
+        RecordEvent("Shader compilation");
+
+        // Each permutation is timed separately.
+        std::string permutation = fileName.substr(fileName.find_last_of("\\/") + 1) + ":" + entryPoint;
+        for (const D3D_SHADER_MACRO* define = defines; define && define->Name; define++) {
+            permutation += fmt::format(" {}={}", define->Name, define->Definition ? define->Definition : "");
+        }
+        ScopedStartupTimer startupTimer("Shader compilation " + permutation);
+
         ComPtr<ID3DBlob> cdErrorBlob;
         const HRESULT hr = D3DCompileFromFile(std::wstring(fileName.begin(), fileName.end()).c_str(),
                                               defines,
@@ -0,0 +1,121 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "interfaces.h"
+
+namespace toolkit::utilities {
+
+    // The registry of the swapchains that we are processing. Applications only create a handful of swapchains, so the
+    // states are stored contiguously in a fixed number of slots, and the handles are searched linearly, which beats
+    // walking a tree. A slot is handed out when the swapchain is created and is kept until it is destroyed, so the
+    // states never move. Lookups do not modify the registry, so they may run concurrently from several threads (eg:
+    // xrEndFrame() and xrAcquireSwapchainImage()). The callers that look up the same swapchains repeatedly can keep
+    // the slot as a hint, which skips the search.
+    template <typename State, uint32_t Capacity = 64>
+    class SwapchainRegistry {
+      public:
+        static constexpr uint32_t InvalidSlot = ~0u;
+
+        State* find(XrSwapchain swapchain) const {
+            const uint32_t slot = findSlot(swapchain);
+            return slot != InvalidSlot ? &m_states[slot] : nullptr;
+        }
+
+        // Look up a swapchain, starting with the slot where it was last found. The hint is updated with the slot of
+        // the swapchain.
+        State* find(XrSwapchain swapchain, uint32_t& slotHint) const {
+            if (slotHint >= m_usedSlots || m_handles[slotHint] != swapchain || swapchain == XR_NULL_HANDLE) {
+                slotHint = findSlot(swapchain);
+                if (slotHint == InvalidSlot) {
+                    return nullptr;
+                }
+            }
+            return &m_states[slotHint];
+        }
+
+        // Return the slot of the swapchain.
+        uint32_t insert_or_assign(XrSwapchain swapchain, State&& state) {
+            uint32_t slot = findSlot(swapchain);
+            if (slot == InvalidSlot) {
+                // Reuse the slot of a destroyed swapchain if possible.
+                slot = std::find(m_handles, m_handles + m_usedSlots, XR_NULL_HANDLE) - m_handles;
+                if (slot == m_usedSlots) {
+                    if (m_usedSlots == Capacity) {
+                        throw new std::runtime_error("Too many swapchains");
+                    }
+                    m_usedSlots++;
+                }
+                m_size++;
+            }
+
+            // The handle is published last, so that a lookup never finds the swapchain with the previous state.
+            m_states[slot] = std::move(state);
+            m_handles[slot] = swapchain;
+            return slot;
+        }
+
+        void erase(XrSwapchain swapchain) {
+            const uint32_t slot = findSlot(swapchain);
+            if (slot != InvalidSlot) {
+                m_handles[slot] = XR_NULL_HANDLE;
+                m_states[slot] = State{};
+                m_size--;
+
+                while (m_usedSlots && m_handles[m_usedSlots - 1] == XR_NULL_HANDLE) {
+                    m_usedSlots--;
+                }
+            }
+        }
+
+        void clear() {
+            for (uint32_t slot = 0; slot < m_usedSlots; slot++) {
+                m_handles[slot] = XR_NULL_HANDLE;
+                m_states[slot] = State{};
+            }
+            m_usedSlots = 0;
+            m_size = 0;
+        }
+
+        size_t size() const {
+            return m_size;
+        }
+
+      private:
+        uint32_t findSlot(XrSwapchain swapchain) const {
+            if (swapchain == XR_NULL_HANDLE) {
+                return InvalidSlot;
+            }
+            const auto it = std::find(m_handles, m_handles + m_usedSlots, swapchain);
+            return it != m_handles + m_usedSlots ? (uint32_t)(it - m_handles) : InvalidSlot;
+        }
+
+        XrSwapchain m_handles[Capacity]{};
+        mutable State m_states[Capacity];
+
+        // The slots past this one are all free.
+        uint32_t m_usedSlots{0};
+        size_t m_size{0};
+    };
+
+} // namespace toolkit::utilities
@@ -0,0 +1,123 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pch.h"
+
+#include "factories.h"
+#include "interfaces.h"
+#include "log.h"
+#include "telemetry.h"
+
+namespace {
+
+    using namespace toolkit;
+    using namespace toolkit::log;
+    using namespace toolkit::utilities;
+    using namespace toolkit::telemetry;
+
+    static_assert((size_t)Timing::MaxValue == (size_t)LatencyMetric::MaxValue);
+    static_assert((RecordCount & (RecordCount - 1)) == 0);
+
+    class TelemetryPublisher : public ITelemetryPublisher {
+      public:
+        TelemetryPublisher(const std::string& applicationName, uint32_t displayWidth, uint32_t displayHeight) {
+            m_mapping = CreateFileMappingW(
+                INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, (DWORD)sizeof(Layout), MappingName);
+            if (!m_mapping) {
+                Log("Failed to create the telemetry mapping: %d\n", GetLastError());
+                return;
+            }
+            if (GetLastError() == ERROR_ALREADY_EXISTS) {
+                // Another application is publishing, or a monitoring tool still holds the mapping of a previous
+                // session. Either way, we would write over records that are still being read.
+                Log("The telemetry mapping already exists, not publishing telemetry\n");
+                CloseHandle(m_mapping);
+                m_mapping = nullptr;
+                return;
+            }
+            m_layout = reinterpret_cast<Layout*>(MapViewOfFile(m_mapping, FILE_MAP_WRITE, 0, 0, sizeof(Layout)));
+            if (!m_layout) {
+                Log("Failed to map the telemetry: %d\n", GetLastError());
+                return;
+            }
+
+            // The mapping is new and zero-filled, so there are no records yet.
+            auto& header = m_layout->header;
+            header.magic = Magic;
+            header.version = Version;
+            header.recordCount = RecordCount;
+            header.processId = GetCurrentProcessId();
+            strncpy_s(header.application, sizeof(header.application), applicationName.c_str(), _TRUNCATE);
+            header.displayWidth = displayWidth;
+            header.displayHeight = displayHeight;
+            std::atomic_thread_fence(std::memory_order_release);
+
+            Log("Publishing telemetry\n");
+        }
+
+        ~TelemetryPublisher() override {
+            if (m_layout) {
+                UnmapViewOfFile(m_layout);
+            }
+            if (m_mapping) {
+                CloseHandle(m_mapping);
+            }
+        }
+
+        void publish(const FrameLogRecord& record,
+                     uint32_t renderWidth,
+                     uint32_t renderHeight,
+                     uint32_t missedFrames) override {
+            if (!m_layout) {
+                return;
+            }
+
+            FrameData data{};
+            data.frameIndex = record.frameIndex;
+            data.displayTime = record.displayTime;
+            std::copy(std::begin(record.latencyUs), std::end(record.latencyUs), data.timingsUs);
+            data.renderWidth = renderWidth;
+            data.renderHeight = renderHeight;
+            data.upscaler = record.scalingType;
+            data.scaling = record.scaling;
+            data.sharpness = record.sharpness;
+            data.missedFrames = missedFrames;
+
+            PublishRecord(*m_layout, data);
+        }
+
+      private:
+        HANDLE m_mapping{nullptr};
+        Layout* m_layout{nullptr};
+    };
+
+} // namespace
+
+namespace toolkit::utilities {
+
+    std::shared_ptr<ITelemetryPublisher>
+    CreateTelemetryPublisher(const std::string& applicationName, uint32_t displayWidth, uint32_t displayHeight) {
+        return std::make_shared<TelemetryPublisher>(applicationName, displayWidth, displayHeight);
+    }
+
+} // namespace toolkit::utilities
@@ -0,0 +1,282 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+// The live telemetry published by the layer in shared memory, for external monitoring tools. This header only depends
+// on the platform SDK and the standard library, so that these tools can include it along with TelemetryReader.
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace toolkit::telemetry {
+
+#ifdef _WIN32
+    // The name of the file mapping. Only one application publishes at a time.
+    constexpr wchar_t MappingName[] = L"Local\\XR_APILAYER_NOVENDOR_toolkit_telemetry";
+#else
+    // The file backing the mapping, for tools that read a file-backed copy of the mapping (eg: under Wine).
+    constexpr char MappingName[] = "/dev/shm/XR_APILAYER_NOVENDOR_toolkit_telemetry";
+#endif
+
+    constexpr uint32_t Magic = 0x4b545258; // "XRTK"
+
+    // Must be incremented whenever the layout below changes.
+    constexpr uint32_t Version = 1;
+
+    // Enough for a few seconds at 120Hz. Must be a power of two.
+    constexpr uint32_t RecordCount = 512;
+
+    // The timings of a frame, in the order of the LatencyMetric enum of the layer.
+    enum class Timing : uint32_t {
+        AppCpu = 0,
+        AppGpu,
+        EndFrameCpu,
+        PreProcessorGpu,
+        UpscalerGpu,
+        PostProcessorGpu,
+        OverlayCpu,
+        OverlayGpu,
+        Prediction,
+        MaxValue
+    };
+
+    // The measurements of one frame.
+    struct FrameData {
+        uint64_t frameIndex;
+        int64_t displayTime;
+        uint64_t timingsUs[(size_t)Timing::MaxValue];
+
+        // The resolution rendered by the application for the first view.
+        uint32_t renderWidth;
+        uint32_t renderHeight;
+
+        // The upscaler (0: none, 1: NIS, 2: FSR), the upscaling factor and the sharpness, in percent.
+        uint32_t upscaler;
+        uint32_t scaling;
+        uint32_t sharpness;
+
+        // The frames missed since the application started publishing.
+        uint32_t missedFrames;
+    };
+
+    struct FrameRecord {
+        // Odd while the record is being written, then 2 * (index + 1) once the record with this index is complete.
+        std::atomic<uint64_t> sequence;
+        FrameData data;
+    };
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t recordCount;
+        uint32_t processId;
+        char application[64];
+        uint32_t displayWidth;
+        uint32_t displayHeight;
+
+        // The number of records published. The record with index N is stored at records[N % recordCount].
+        std::atomic<uint64_t> writeCount;
+    };
+
+    struct Layout {
+        Header header;
+        FrameRecord records[RecordCount];
+    };
+
+    // The counters are shared between processes, so they must not rely on a lock.
+    static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+    // Publish the next record. There must be a single writer, and it never waits for the readers: they validate the
+    // sequence before and after copying the record instead.
+    inline void PublishRecord(Layout& layout, const FrameData& data) {
+        const uint64_t index = layout.header.writeCount.load(std::memory_order_relaxed);
+        auto& record = layout.records[index % RecordCount];
+
+        record.sequence.store(2 * index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        record.data = data;
+        record.sequence.store(2 * (index + 1), std::memory_order_release);
+
+        layout.header.writeCount.store(index + 1, std::memory_order_release);
+    }
+
+    // The few platform calls needed to map the telemetry for reading.
+    namespace platform {
+
+#ifdef _WIN32
+        using Path = const wchar_t*;
+
+        struct Mapping {
+            HANDLE handle{nullptr};
+            const void* view{nullptr};
+        };
+
+        inline bool MapForReading(Path name, size_t size, Mapping& mapping) {
+            mapping.handle = OpenFileMappingW(FILE_MAP_READ, FALSE, name);
+            if (!mapping.handle) {
+                return false;
+            }
+            mapping.view = MapViewOfFile(mapping.handle, FILE_MAP_READ, 0, 0, size);
+            return mapping.view != nullptr;
+        }
+
+        inline void Unmap(Mapping& mapping) {
+            if (mapping.view) {
+                UnmapViewOfFile(mapping.view);
+                mapping.view = nullptr;
+            }
+            if (mapping.handle) {
+                CloseHandle(mapping.handle);
+                mapping.handle = nullptr;
+            }
+        }
+#else
+        using Path = const char*;
+
+        struct Mapping {
+            const void* view{nullptr};
+            size_t size{0};
+        };
+
+        inline bool MapForReading(Path name, size_t size, Mapping& mapping) {
+            const int fd = ::open(name, O_RDONLY);
+            if (fd < 0) {
+                return false;
+            }
+
+            // The mapping outlives the descriptor.
+            struct stat info;
+            void* view = MAP_FAILED;
+            if (!fstat(fd, &info) && (size_t)info.st_size >= size) {
+                view = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            }
+            ::close(fd);
+            if (view == MAP_FAILED) {
+                return false;
+            }
+
+            mapping.view = view;
+            mapping.size = size;
+            return true;
+        }
+
+        inline void Unmap(Mapping& mapping) {
+            if (mapping.view) {
+                munmap(const_cast<void*>(mapping.view), mapping.size);
+                mapping.view = nullptr;
+            }
+        }
+#endif
+
+    } // namespace platform
+
+    // Read the records as they are published, from another process.
+    class TelemetryReader {
+      public:
+        ~TelemetryReader() {
+            close();
+        }
+
+        // Returns false when no application is publishing. Each application publishes into its own mapping, and
+        // cannot publish while a reader still has the mapping of a previous application open: close the reader once
+        // the application is gone (see Header::processId).
+        bool open(platform::Path name = MappingName) {
+            close();
+
+            if (!platform::MapForReading(name, sizeof(Layout), m_mapping)) {
+                close();
+                return false;
+            }
+            m_layout = reinterpret_cast<const Layout*>(m_mapping.view);
+            if (m_layout->header.magic != Magic || m_layout->header.version != Version ||
+                m_layout->header.recordCount != RecordCount) {
+                close();
+                return false;
+            }
+
+            m_nextIndex = m_layout->header.writeCount.load(std::memory_order_acquire);
+            return true;
+        }
+
+        void close() {
+            platform::Unmap(m_mapping);
+            m_layout = nullptr;
+        }
+
+        const Header* getHeader() const {
+            return m_layout ? &m_layout->header : nullptr;
+        }
+
+        // Copy the records published since the last call, oldest first, and return how many were copied. The records
+        // that were overwritten before being read are added to lostRecords.
+        size_t read(FrameData* records, size_t capacity, uint64_t& lostRecords) {
+            if (!m_layout) {
+                return 0;
+            }
+
+            const uint64_t writeCount = m_layout->header.writeCount.load(std::memory_order_acquire);
+            if (writeCount - m_nextIndex > RecordCount) {
+                lostRecords += writeCount - m_nextIndex - RecordCount;
+                m_nextIndex = writeCount - RecordCount;
+            }
+
+            size_t count = 0;
+            for (; m_nextIndex < writeCount && count < capacity; m_nextIndex++) {
+                const FrameRecord& record = m_layout->records[m_nextIndex % RecordCount];
+                const uint64_t expectedSequence = 2 * (m_nextIndex + 1);
+
+                // The writer never waits, so the record might be overwritten while we copy it.
+                if (record.sequence.load(std::memory_order_acquire) != expectedSequence) {
+                    lostRecords++;
+                    continue;
+                }
+                memcpy(&records[count], &record.data, sizeof(FrameData));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (record.sequence.load(std::memory_order_relaxed) != expectedSequence) {
+                    lostRecords++;
+                    continue;
+                }
+                count++;
+            }
+
+            return count;
+        }
+
+      private:
+        platform::Mapping m_mapping;
+        const Layout* m_layout{nullptr};
+        uint64_t m_nextIndex{0};
+    };
+
+} // namespace toolkit::telemetry
@@ -0,0 +1,164 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pch.h"
+
+#include "factories.h"
+#include "interfaces.h"
+#include "log.h"
+
+namespace {
+
+    using namespace toolkit;
+    using namespace toolkit::log;
+    using namespace toolkit::utilities;
+
+    // Enough for a few seconds at 120Hz without reallocating.
+    constexpr size_t InitialEventCapacity = 10000;
+
+    // The GPU events are shown as a separate thread.
+    constexpr DWORD GpuThreadId = 0;
+
+    struct TraceEvent {
+        const char* name;
+        DWORD threadId;
+        uint64_t startUs;
+        uint64_t endUs;
+    };
+
+    class TraceRecorder : public ITraceRecorder {
+        using clock = std::chrono::steady_clock;
+
+      public:
+        ~TraceRecorder() override {
+            if (m_writer.joinable()) {
+                m_writer.join();
+            }
+        }
+
+        void startCapture(const std::string& path, uint32_t durationSeconds) override {
+            std::unique_lock lock(m_eventsLock);
+            if (m_isCapturing) {
+                return;
+            }
+
+            Log("Capturing a trace for %u seconds\n", durationSeconds);
+            m_path = path;
+            m_events.clear();
+            m_events.reserve(InitialEventCapacity);
+            m_captureEnd = clock::now() + std::chrono::seconds(durationSeconds);
+            m_isCapturing = true;
+        }
+
+        bool isCapturing() const override {
+            return m_isCapturing;
+        }
+
+        void addCpuEvent(const char* name, uint64_t startUs, uint64_t endUs) override {
+            addEvent(name, GetCurrentThreadId(), startUs, endUs);
+        }
+
+        void addGpuEvent(const char* name, uint64_t startUs, uint64_t endUs) override {
+            addEvent(name, GpuThreadId, startUs, endUs);
+        }
+
+        void update() override {
+            if (!m_isCapturing || clock::now() < m_captureEnd) {
+                return;
+            }
+
+            std::vector<TraceEvent> events;
+            {
+                std::unique_lock lock(m_eventsLock);
+                m_isCapturing = false;
+                events = std::move(m_events);
+            }
+
+            // Write the file in the background, to avoid a stutter at the end of the capture.
+            if (m_writer.joinable()) {
+                m_writer.join();
+            }
+            m_writer = std::thread([path = m_path, events = std::move(events)]() { writeTrace(path, events); });
+        }
+
+      private:
+        void addEvent(const char* name, DWORD threadId, uint64_t startUs, uint64_t endUs) {
+            if (!m_isCapturing) {
+                return;
+            }
+
+            // xrWaitFrame() might be called from another thread.
+            std::unique_lock lock(m_eventsLock);
+            if (m_isCapturing) {
+                auto it = m_names.find(name);
+                if (it == m_names.cend()) {
+                    it = m_names.emplace(name).first;
+                }
+                m_events.push_back({it->c_str(), threadId, startUs, endUs});
+            }
+        }
+
+        // Write the events in the Chrome trace event format, which is understood by chrome://tracing and Perfetto.
+        static void writeTrace(const std::string& path, const std::vector<TraceEvent>& events) {
+            std::ofstream stream(path);
+            if (!stream.is_open()) {
+                Log("Failed to open %s\n", path.c_str());
+                return;
+            }
+
+            const DWORD processId = GetCurrentProcessId();
+            stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+            stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << processId << ",\"tid\":" << GpuThreadId
+                   << ",\"args\":{\"name\":\"GPU\"}}";
+            for (const auto& event : events) {
+                stream << ",\n{\"name\":\"" << event.name << "\",\"cat\":\""
+                       << (event.threadId == GpuThreadId ? "GPU" : "CPU") << "\",\"ph\":\"X\",\"ts\":" << event.startUs
+                       << ",\"dur\":" << (event.endUs > event.startUs ? event.endUs - event.startUs : 0)
+                       << ",\"pid\":" << processId << ",\"tid\":" << event.threadId << "}";
+            }
+            stream << "\n]}\n";
+
+            Log("Trace with %u events written to %s\n", (uint32_t)events.size(), path.c_str());
+        }
+
+        std::mutex m_eventsLock;
+        std::vector<TraceEvent> m_events;
+        std::atomic<bool> m_isCapturing{false};
+
+        // The callers might not keep the names alive until the trace is written, so we keep a copy of each.
+        std::set<std::string, std::less<>> m_names;
+
+        std::string m_path;
+        clock::time_point m_captureEnd;
+        std::thread m_writer;
+    };
+
+} // namespace
+
+namespace toolkit::utilities {
+
+    std::shared_ptr<ITraceRecorder> CreateTraceRecorder() {
+        return std::make_shared<TraceRecorder>();
+    }
+
+} // namespace toolkit::utilities
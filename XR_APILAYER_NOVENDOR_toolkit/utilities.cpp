@@ -39,7 +39,9 @@ namespace {
         }
 
         void stop() override {
-            m_duration = clock::now() - m_timeStart;
+            m_timeStop = clock::now();
+            m_duration = m_timeStop - m_timeStart;
+            m_hasTimestamps = true;
         }
 
         uint64_t query(bool reset) const override {
@@ -51,9 +53,22 @@ namespace {
             return duration.count();
         }
 
+        bool consumeTimestamps(uint64_t& startUs, uint64_t& endUs) override {
+            if (!std::exchange(m_hasTimestamps, false)) {
+                return false;
+            }
+
+            // The Windows implementation of the clock is based on QueryPerformanceCounter().
+            startUs = std::chrono::duration_cast<std::chrono::microseconds>(m_timeStart.time_since_epoch()).count();
+            endUs = std::chrono::duration_cast<std::chrono::microseconds>(m_timeStop.time_since_epoch()).count();
+            return true;
+        }
+
       private:
         clock::time_point m_timeStart;
+        clock::time_point m_timeStop;
         mutable clock::duration m_duration{0};
+        bool m_hasTimestamps{false};
     };
 
 } // namespace
@@ -0,0 +1,139 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pch.h"
+
+#include "factories.h"
+#include "interfaces.h"
+
+namespace {
+
+    struct Point {
+        float x;
+        float y;
+    };
+
+    // Whether a triangle overlaps a box, using the separating axis theorem. The axes of the box are already covered by
+    // only testing the tiles within the bounding box of the triangle.
+    bool TriangleOverlapsBox(const Point (&triangle)[3], float left, float top, float right, float bottom) {
+        for (uint32_t i = 0; i < 3; i++) {
+            const Point& a = triangle[i];
+            const Point& b = triangle[(i + 1) % 3];
+            const Point& c = triangle[(i + 2) % 3];
+
+            // The normal of the edge, pointing inside the triangle.
+            float nx = a.y - b.y;
+            float ny = b.x - a.x;
+            if (nx * (c.x - a.x) + ny * (c.y - a.y) < 0.0f) {
+                nx = -nx;
+                ny = -ny;
+            }
+
+            // The edge separates the box from the triangle if the corner furthest inside is still outside.
+            const float cornerX = nx > 0.0f ? right : left;
+            const float cornerY = ny > 0.0f ? bottom : top;
+            if (nx * (cornerX - a.x) + ny * (cornerY - a.y) < 0.0f) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+} // namespace
+
+namespace toolkit::utilities {
+
+    uint32_t BuildVisibilityMask(const std::vector<XrVector2f>& vertices,
+                                 const std::vector<uint32_t>& indices,
+                                 const XrFovf& fov,
+                                 uint32_t tilesX,
+                                 uint32_t tilesY,
+                                 uint32_t* visibleTiles,
+                                 std::vector<uint8_t>& scratch) {
+        // The caller keeps the scratch storage from one call to the next, so it is only allocated once.
+        auto& tiles = scratch;
+        tiles.assign(tilesX * tilesY, indices.empty() ? 1 : 0);
+
+        // The vertices are on the plane at 1 meter from the eye, so their coordinates are the tangents of the angles.
+        const float tanLeft = std::tan(fov.angleLeft);
+        const float tanRight = std::tan(fov.angleRight);
+        const float tanUp = std::tan(fov.angleUp);
+        const float tanDown = std::tan(fov.angleDown);
+        const auto toTile = [&](const XrVector2f& vertex) {
+            return Point{(vertex.x - tanLeft) / (tanRight - tanLeft) * tilesX,
+                         (tanUp - vertex.y) / (tanUp - tanDown) * tilesY};
+        };
+
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            if (indices[i] >= vertices.size() || indices[i + 1] >= vertices.size() ||
+                indices[i + 2] >= vertices.size()) {
+                continue;
+            }
+
+            const Point triangle[3] = {
+                toTile(vertices[indices[i]]), toTile(vertices[indices[i + 1]]), toTile(vertices[indices[i + 2]])};
+
+            const float minX = std::min({triangle[0].x, triangle[1].x, triangle[2].x});
+            const float maxX = std::max({triangle[0].x, triangle[1].x, triangle[2].x});
+            const float minY = std::min({triangle[0].y, triangle[1].y, triangle[2].y});
+            const float maxY = std::max({triangle[0].y, triangle[1].y, triangle[2].y});
+
+            const int32_t x0 = std::max((int32_t)std::floor(minX), 0);
+            const int32_t x1 = std::min((int32_t)std::ceil(maxX), (int32_t)tilesX);
+            const int32_t y0 = std::max((int32_t)std::floor(minY), 0);
+            const int32_t y1 = std::min((int32_t)std::ceil(maxY), (int32_t)tilesY);
+            for (int32_t y = y0; y < y1; y++) {
+                for (int32_t x = x0; x < x1; x++) {
+                    uint8_t& tile = tiles[y * tilesX + x];
+                    if (!tile && TriangleOverlapsBox(triangle, (float)x, (float)y, x + 1.0f, y + 1.0f)) {
+                        tile = 1;
+                    }
+                }
+            }
+        }
+
+        // Grow the visible area by one tile, since the filters read the neighbors of the visible pixels.
+        uint32_t visibleCount = 0;
+        memset(visibleTiles, 0, ((tilesX * tilesY + 31) / 32) * sizeof(uint32_t));
+        for (uint32_t y = 0; y < tilesY; y++) {
+            for (uint32_t x = 0; x < tilesX; x++) {
+                bool isVisible = false;
+                for (uint32_t j = y ? y - 1 : 0; j <= std::min(y + 1, tilesY - 1) && !isVisible; j++) {
+                    for (uint32_t i = x ? x - 1 : 0; i <= std::min(x + 1, tilesX - 1) && !isVisible; i++) {
+                        isVisible = tiles[j * tilesX + i];
+                    }
+                }
+
+                if (isVisible) {
+                    const uint32_t index = y * tilesX + x;
+                    visibleTiles[index / 32] |= 1u << (index % 32);
+                    visibleCount++;
+                }
+            }
+        }
+
+        return visibleCount;
+    }
+
+} // namespace toolkit::utilities
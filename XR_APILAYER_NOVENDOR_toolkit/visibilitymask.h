@@ -0,0 +1,74 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef _VISIBILITY_MASK_H_
+#define _VISIBILITY_MASK_H_
+
+// The visibility mask divides the view into a grid of tiles (in normalized coordinates), with one bit per tile that is
+// set when any pixel of the tile might be visible through the lenses.
+#define VISIBILITY_MASK_MAX_WORDS 4096
+
+#ifdef _WINDOWS
+__declspec(align(256))
+struct VisibilityMaskConfig {
+    uint32_t tilesX;
+    uint32_t tilesY;
+    uint32_t enabled;
+    uint32_t padding;
+    uint32_t visibleTiles[VISIBILITY_MASK_MAX_WORDS];
+};
+#else
+cbuffer visibilityMask : register(b1) {
+    uint visibilityMaskTilesX;
+    uint visibilityMaskTilesY;
+    uint visibilityMaskEnabled;
+    uint visibilityMaskPadding;
+    uint4 visibilityMaskTiles[VISIBILITY_MASK_MAX_WORDS / 4];
+};
+
+bool IsTileVisible(uint2 tile) {
+    const uint index = tile.y * visibilityMaskTilesX + tile.x;
+    return (visibilityMaskTiles[index / 128][(index / 32) % 4] >> (index % 32)) & 1;
+}
+
+// Whether any pixel of a region (in normalized coordinates) might be visible.
+bool IsRegionVisible(float2 topLeft, float2 bottomRight) {
+    if (!visibilityMaskEnabled) {
+        return true;
+    }
+
+    const uint2 tilesCount = uint2(visibilityMaskTilesX, visibilityMaskTilesY);
+    const uint2 first = min(uint2(saturate(topLeft) * tilesCount), tilesCount - 1);
+    const uint2 last = max(min(uint2(ceil(saturate(bottomRight) * tilesCount)), tilesCount) - 1, first);
+    for (uint y = first.y; y <= last.y; y++) {
+        for (uint x = first.x; x <= last.x; x++) {
+            if (IsTileVisible(uint2(x, y))) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+#endif
+
+#endif // _VISIBILITY_MASK_H_
@@ -0,0 +1,98 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "factories.h"
+
+#include "test.h"
+
+namespace {
+
+    using namespace toolkit::utilities;
+
+    TEST(CountsEachAllocation) {
+        const uint64_t before = GetAllocationCount();
+        auto value = std::make_unique<int>(42);
+        CHECK_EQ(GetAllocationCount() - before, 1u);
+
+        std::vector<int> values;
+        values.reserve(16);
+        CHECK_EQ(GetAllocationCount() - before, 2u);
+
+        // Reusing the storage does not allocate.
+        values.clear();
+        values.reserve(16);
+        values.push_back(*value);
+        CHECK_EQ(GetAllocationCount() - before, 2u);
+    }
+
+    TEST(CountsArrayAndNothrowAllocations) {
+        const uint64_t before = GetAllocationCount();
+        auto values = std::make_unique<int[]>(8);
+        auto value = std::unique_ptr<int>(new (std::nothrow) int(0));
+        CHECK(value != nullptr);
+        CHECK_EQ(GetAllocationCount() - before, 2u);
+    }
+
+    TEST(CountsAlignedAllocations) {
+        struct alignas(64) CacheLine {
+            uint8_t bytes[64];
+        };
+
+        const uint64_t before = GetAllocationCount();
+        auto line = std::make_unique<CacheLine>();
+        auto lines = std::make_unique<CacheLine[]>(4);
+        CHECK_EQ(reinterpret_cast<uintptr_t>(line.get()) % alignof(CacheLine), 0u);
+        CHECK_EQ(reinterpret_cast<uintptr_t>(lines.get()) % alignof(CacheLine), 0u);
+        CHECK_EQ(GetAllocationCount() - before, 2u);
+    }
+
+    TEST(CountsStringsAndFormatting) {
+        const uint64_t before = GetAllocationCount();
+        const std::string name = fmt::format("{} is longer than the small string buffer", "This string");
+        CHECK(!name.empty());
+        CHECK(GetAllocationCount() - before >= 1u);
+    }
+
+    TEST(IgnoresOtherThreads) {
+        const uint64_t before = GetAllocationCount();
+        uint64_t otherThreadCount = 0;
+        std::thread thread([&otherThreadCount] {
+            const uint64_t threadBefore = GetAllocationCount();
+            std::vector<std::unique_ptr<int>> values;
+            for (int i = 0; i < 10; i++) {
+                values.push_back(std::make_unique<int>(i));
+            }
+            otherThreadCount = GetAllocationCount() - threadBefore;
+        });
+        const uint64_t afterStart = GetAllocationCount();
+        thread.join();
+
+        CHECK(otherThreadCount >= 10u);
+        CHECK_EQ(GetAllocationCount(), afterStart);
+        CHECK(afterStart >= before);
+    }
+
+} // namespace
+
+TEST_MAIN()
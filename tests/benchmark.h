@@ -0,0 +1,59 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+
+// A minimal benchmark harness. The benchmarks are built along with the tests, but they are not run by ctest since their
+// results depend on the machine.
+namespace benchmark {
+
+    // Stores a value where the compiler cannot see it, so that the computation of the value is not optimized away.
+    inline volatile uintptr_t sink;
+
+    template <typename T>
+    void Consume(T value) {
+        sink = (uintptr_t)value;
+    }
+
+    // The average time of one call to the function, in nanoseconds. The best of a few rounds is kept, to filter out
+    // the preemptions and the frequency changes.
+    template <typename Function>
+    double Measure(Function&& function, uint32_t iterations = 1000000, uint32_t rounds = 5) {
+        double best = std::numeric_limits<double>::max();
+        for (uint32_t round = 0; round < rounds; round++) {
+            const auto start = std::chrono::steady_clock::now();
+            for (uint32_t i = 0; i < iterations; i++) {
+                function(i);
+            }
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, std::chrono::duration<double, std::nano>(elapsed).count() / iterations);
+        }
+        return best;
+    }
+
+} // namespace benchmark
@@ -0,0 +1,467 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "factories.h"
+#include "interfaces.h"
+
+#include "mock_device.h"
+#include "test.h"
+
+namespace {
+
+    using namespace toolkit::graphics;
+    using namespace test;
+
+    // The stages that were run, with their input and output textures.
+    struct Execution {
+        std::string stage;
+        std::string input;
+        std::string output;
+        ViewRegion region;
+    };
+    std::vector<Execution> executions;
+
+    void RecordExecution(const std::string& stage,
+                         const std::shared_ptr<ITexture>& input,
+                         const std::shared_ptr<ITexture>& output,
+                         const ViewRegion& region) {
+        executions.push_back({stage,
+                              static_cast<MockTexture*>(input.get())->name,
+                              static_cast<MockTexture*>(output.get())->name,
+                              region});
+    }
+
+    struct MockUpscaler : IUpscaler {
+        MockUpscaler(uint32_t outputWidth, uint32_t outputHeight) {
+            requirements.outputWidth = outputWidth;
+            requirements.outputHeight = outputHeight;
+            requirements.outputUsage = XR_SWAPCHAIN_USAGE_UNORDERED_ACCESS_BIT;
+        }
+
+        StageRequirements getRequirements() const override {
+            return requirements;
+        }
+        bool isIdentity() const override {
+            return identity;
+        }
+        void update(const toolkit::config::SettingsSnapshot& settings) override {
+        }
+        void upscale(const std::shared_ptr<ITexture>& input,
+                     const std::shared_ptr<ITexture>& output,
+                     const ViewRegion& region,
+                     const std::shared_ptr<IShaderBuffer>& visibilityMask,
+                     int32_t slice) override {
+            CHECK(visibilityMask != nullptr);
+            RecordExecution("upscaler", input, output, region);
+        }
+
+        StageRequirements requirements;
+        bool identity{false};
+    };
+
+    struct MockProcessor : IImageProcessor {
+        MockProcessor(const std::string& name, bool identity = false) : name(name), identity(identity) {
+        }
+
+        StageRequirements getRequirements() const override {
+            return {};
+        }
+        bool isIdentity() const override {
+            return identity;
+        }
+        void update(const toolkit::config::SettingsSnapshot& settings) override {
+            sharpness = settings.getValue(toolkit::config::SettingId::Sharpness);
+        }
+        void process(const std::shared_ptr<ITexture>& input,
+                     const std::shared_ptr<ITexture>& output,
+                     const ViewRegion& region,
+                     const std::shared_ptr<IShaderBuffer>& visibilityMask,
+                     int32_t slice) override {
+            CHECK(visibilityMask != nullptr);
+            RecordExecution(name, input, output, region);
+        }
+
+        const std::string name;
+        const bool identity;
+        int sharpness{-1};
+    };
+
+    // A double-wide swapchain (2 views of 1000x900).
+    XrSwapchainCreateInfo MakeAppInfo(int64_t format = DXGI_FORMAT_R8G8B8A8_UNORM) {
+        XrSwapchainCreateInfo info{};
+        info.format = format;
+        info.usageFlags = XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT | XR_SWAPCHAIN_USAGE_SAMPLED_BIT;
+        info.width = 2000;
+        info.height = 900;
+        info.arraySize = 1;
+        info.sampleCount = 1;
+        return info;
+    }
+
+    constexpr XrExtent2Di ViewResolution{1000, 900};
+
+    // The images of a swapchain, like the layer keeps them.
+    struct Images {
+        ChainLayout layout;
+        std::vector<std::vector<std::shared_ptr<ITexture>>> chains;
+    };
+
+    Images CreateImages(IProcessingChain& chain, const XrSwapchainCreateInfo& appInfo, uint32_t count) {
+        Images images;
+        images.layout = chain.getLayout(appInfo, ViewResolution);
+        const auto runtimeInfo = chain.getRuntimeSwapchainInfo(appInfo, ViewResolution, images.layout);
+        std::vector<std::shared_ptr<ITexture>> runtimeTextures;
+        for (uint32_t i = 0; i < count; i++) {
+            runtimeTextures.push_back(std::make_shared<MockTexture>(runtimeInfo, "runtime"));
+        }
+        images.chains = chain.createSwapchainImages(appInfo, ViewResolution, images.layout, runtimeTextures);
+        return images;
+    }
+
+    std::string NameOf(const std::shared_ptr<ITexture>& texture) {
+        return static_cast<MockTexture*>(texture.get())->name;
+    }
+
+    // The right view of the double-wide swapchain, upscaled by 2.
+    ViewRegion RightView() {
+        ViewRegion region;
+        region.view = 1;
+        region.input = {{1000, 0}, {1000, 900}};
+        region.output = {{2000, 0}, {2000, 1800}};
+        return region;
+    }
+
+} // namespace
+
+TEST(StagesRunInPipelineOrder) {
+    auto device = std::make_shared<MockDevice>();
+    auto chain = CreateProcessingChain(device);
+
+    // The order of registration does not matter.
+    chain->addStage(StageType::PostProcessing, std::make_shared<MockProcessor>("post"));
+    chain->addStage(StageType::Upscaling, std::make_shared<MockUpscaler>(2000, 1800));
+    chain->addStage(StageType::PreProcessing, std::make_shared<MockProcessor>("pre"));
+
+    const auto images = CreateImages(*chain, MakeAppInfo(), 1);
+    CHECK_EQ(images.chains.size(), 1u);
+    const auto& textures = images.chains[0];
+    CHECK_EQ(textures.size(), 4u);
+
+    executions.clear();
+    device->profilingScopes.clear();
+    chain->process(textures, images.layout, -1, RightView(), nullptr);
+
+    CHECK_EQ(executions.size(), 3u);
+    CHECK(executions[0].stage == "pre" && executions[1].stage == "upscaler" && executions[2].stage == "post");
+
+    // Each stage reads the output of the previous one, and the last one writes the runtime texture.
+    CHECK(executions[0].input == NameOf(textures[0]) && executions[0].output == NameOf(textures[1]));
+    CHECK(executions[1].input == NameOf(textures[1]) && executions[1].output == NameOf(textures[2]));
+    CHECK(executions[2].input == NameOf(textures[2]) && executions[2].output == "runtime");
+
+    // The regions follow the resolution of each texture.
+    CHECK_EQ(executions[0].region.output.extent.width, 1000);
+    CHECK_EQ(executions[1].region.input.offset.x, 1000);
+    CHECK_EQ(executions[1].region.output.offset.x, 2000);
+    CHECK_EQ(executions[1].region.output.extent.width, 2000);
+    CHECK_EQ(executions[2].region.input.extent.height, 1800);
+
+    CHECK_EQ(device->profilingScopes.size(), 3u);
+    CHECK(device->profilingScopes[0] == StageNames[(size_t)StageType::PreProcessing]);
+    CHECK(device->profilingScopes[1] == StageNames[(size_t)StageType::Upscaling]);
+    CHECK(device->profilingScopes[2] == StageNames[(size_t)StageType::PostProcessing]);
+}
+
+TEST(TexturesAreSizedForEachStage) {
+    auto device = std::make_shared<MockDevice>();
+    auto chain = CreateProcessingChain(device);
+    chain->addStage(StageType::Upscaling, std::make_shared<MockUpscaler>(2000, 1800));
+    chain->addStage(StageType::PostProcessing, std::make_shared<MockProcessor>("post"));
+
+    const auto appInfo = MakeAppInfo(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB);
+    const auto runtimeInfo =
+        chain->getRuntimeSwapchainInfo(appInfo, ViewResolution, chain->getLayout(appInfo, ViewResolution));
+    CHECK_EQ(runtimeInfo.width, 4000u);
+    CHECK_EQ(runtimeInfo.height, 1800u);
+    CHECK_EQ(runtimeInfo.format, (int64_t)DXGI_FORMAT_R8G8B8A8_UNORM_SRGB);
+    CHECK(runtimeInfo.usageFlags & XR_SWAPCHAIN_USAGE_SAMPLED_BIT);
+    CHECK(!(runtimeInfo.usageFlags & XR_SWAPCHAIN_USAGE_UNORDERED_ACCESS_BIT));
+
+    const auto images = CreateImages(*chain, appInfo, 1);
+    const auto& textures = images.chains[0];
+    CHECK_EQ(textures.size(), 3u);
+
+    // The application texture is read by the upscaler.
+    CHECK_EQ(textures[0]->getInfo().width, 2000u);
+    CHECK(textures[0]->getInfo().usageFlags & XR_SWAPCHAIN_USAGE_SAMPLED_BIT);
+
+    // The upscaler writes an unordered access view, which cannot have an sRGB format.
+    const auto& intermediate = textures[1]->getInfo();
+    CHECK_EQ(intermediate.width, 4000u);
+    CHECK_EQ(intermediate.height, 1800u);
+    CHECK(intermediate.usageFlags & XR_SWAPCHAIN_USAGE_UNORDERED_ACCESS_BIT);
+    CHECK(intermediate.usageFlags & XR_SWAPCHAIN_USAGE_SAMPLED_BIT);
+    CHECK_EQ(intermediate.format, (int64_t)DXGI_FORMAT_R10G10B10A2_UNORM);
+}
+
+TEST(IdentityStagesAreRemoved) {
+    auto device = std::make_shared<MockDevice>();
+    auto chain = CreateProcessingChain(device);
+    chain->addStage(StageType::PreProcessing, std::make_shared<MockProcessor>("pre", true));
+    chain->addStage(StageType::Upscaling, std::make_shared<MockUpscaler>(2000, 1800));
+    chain->addStage(StageType::PostProcessing, std::make_shared<MockProcessor>("post", true));
+
+    // Both processors leave the image untouched: the application renders straight into the upscaler's input.
+    const auto images = CreateImages(*chain, MakeAppInfo(), 1);
+    CHECK_EQ(images.chains[0].size(), 2u);
+
+    executions.clear();
+    chain->process(images.chains[0], images.layout, -1, RightView(), nullptr);
+    CHECK_EQ(executions.size(), 1u);
+    CHECK(executions[0].stage == "upscaler" && executions[0].output == "runtime");
+}
+
+TEST(IdentityStageIsKeptForSRGBConversion) {
+    auto device = std::make_shared<MockDevice>();
+    auto chain = CreateProcessingChain(device);
+    chain->addStage(StageType::Upscaling, std::make_shared<MockUpscaler>(2000, 1800));
+    chain->addStage(StageType::PostProcessing, std::make_shared<MockProcessor>("post", true));
+
+    // The upscaler cannot write the sRGB runtime texture, so the last identity stage does the copy.
+    const auto images = CreateImages(*chain, MakeAppInfo(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB), 1);
+    CHECK_EQ(images.chains[0].size(), 3u);
+
+    executions.clear();
+    chain->process(images.chains[0], images.layout, -1, RightView(), nullptr);
+    CHECK_EQ(executions.size(), 2u);
+    CHECK(executions.back().stage == "post" && executions.back().output == "runtime");
+}
+
+TEST(IdentityUpscalerAtViewResolutionIsRemoved) {
+    auto device = std::make_shared<MockDevice>();
+    auto chain = CreateProcessingChain(device);
+    auto upscaler = std::make_shared<MockUpscaler>(1000, 900);
+    upscaler->identity = true;
+    chain->addStage(StageType::Upscaling, upscaler);
+
+    // The application renders straight into the runtime texture.
+    const auto images = CreateImages(*chain, MakeAppInfo(), 1);
+    CHECK_EQ(images.chains[0].size(), 1u);
+    CHECK(!chain->isLastStage(StageType::Upscaling));
+
+    // The layout of the swapchain does not change once the upscaler sharpens the image.
+    upscaler->identity = false;
+    executions.clear();
+    chain->process(images.chains[0], images.layout, -1, RightView(), nullptr);
+    CHECK_EQ(executions.size(), 0u);
+}
+
+TEST(IdentityUpscalerIsSkippedAtSameResolution) {
+    auto device = std::make_shared<MockDevice>();
+    auto chain = CreateProcessingChain(device);
+    auto upscaler = std::make_shared<MockUpscaler>(1000, 900);
+    chain->addStage(StageType::Upscaling, upscaler);
+    chain->addStage(StageType::PostProcessing, std::make_shared<MockProcessor>("post"));
+
+    const auto images = CreateImages(*chain, MakeAppInfo(), 1);
+    CHECK_EQ(images.chains[0].size(), 3u);
+
+    // The upscaler has nothing to do, so the post-processor reads the application texture directly.
+    upscaler->identity = true;
+    ViewRegion region;
+    region.input = {{0, 0}, {1000, 900}};
+    region.output = {{0, 0}, {1000, 900}};
+    executions.clear();
+    chain->process(images.chains[0], images.layout, -1, region, nullptr);
+    CHECK_EQ(executions.size(), 1u);
+    CHECK(executions[0].stage == "post" && executions[0].input == NameOf(images.chains[0][0]));
+}
+
+TEST(BypassedStageIsSkipped) {
+    auto device = std::make_shared<MockDevice>();
+    auto chain = CreateProcessingChain(device);
+    chain->addStage(StageType::PreProcessing, std::make_shared<MockProcessor>("pre"));
+    chain->addStage(StageType::Upscaling, std::make_shared<MockUpscaler>(2000, 1800));
+    chain->addStage(StageType::PostProcessing, std::make_shared<MockProcessor>("post"));
+
+    const auto images = CreateImages(*chain, MakeAppInfo(), 1);
+
+    chain->setBypass(StageType::PreProcessing, true);
+    executions.clear();
+    chain->process(images.chains[0], images.layout, -1, RightView(), nullptr);
+    CHECK_EQ(executions.size(), 2u);
+    CHECK(executions[0].stage == "upscaler" && executions[0].input == NameOf(images.chains[0][0]));
+
+    // The last stage always runs, since it writes the runtime texture.
+    CHECK(chain->isLastStage(StageType::PostProcessing));
+    CHECK(!chain->isLastStage(StageType::Upscaling));
+    chain->setBypass(StageType::PreProcessing, false);
+    chain->setBypass(StageType::PostProcessing, true);
+    executions.clear();
+    chain->process(images.chains[0], images.layout, -1, RightView(), nullptr);
+    CHECK_EQ(executions.size(), 3u);
+}
+
+TEST(IntermediatesAreSharedBetweenImages) {
+    auto device = std::make_shared<MockDevice>();
+    auto chain = CreateProcessingChain(device);
+    chain->addStage(StageType::PreProcessing, std::make_shared<MockProcessor>("pre"));
+    chain->addStage(StageType::Upscaling, std::make_shared<MockUpscaler>(2000, 1800));
+    chain->addStage(StageType::PostProcessing, std::make_shared<MockProcessor>("post"));
+
+    {
+        auto images = CreateImages(*chain, MakeAppInfo(), 3);
+        CHECK_EQ(images.chains.size(), 3u);
+
+        // One application texture per image, plus one set of intermediates.
+        CHECK_EQ(device->numTexturesCreated, 3u + 2u);
+        for (size_t i = 1; i < images.chains.size(); i++) {
+            CHECK(images.chains[i][0] != images.chains[0][0]);
+            CHECK(images.chains[i][1] == images.chains[0][1]);
+            CHECK(images.chains[i][2] == images.chains[0][2]);
+            CHECK(images.chains[i][3] != images.chains[0][3]);
+        }
+
+        // 2 sets of 2000x900 and 4000x1800 intermediates at 4 bytes per pixel were not allocated.
+        CHECK_EQ(chain->getMemorySaved(), 2ull * (2000 * 900 + 4000 * 1800) * 4);
+    }
+
+    // The savings are gone with the textures.
+    CHECK_EQ(chain->getMemorySaved(), 0ull);
+}
+
+TEST(NoStageRendersIntoRuntimeTexture) {
+    auto device = std::make_shared<MockDevice>();
+    auto chain = CreateProcessingChain(device);
+
+    const auto images = CreateImages(*chain, MakeAppInfo(), 2);
+    CHECK_EQ(device->numTexturesCreated, 0u);
+    CHECK_EQ(images.chains[0].size(), 1u);
+    CHECK(NameOf(images.chains[0][0]) == "runtime");
+}
+
+TEST(UpdatePassesTheSnapshotToTheStages) {
+    auto device = std::make_shared<MockDevice>();
+    auto chain = CreateProcessingChain(device);
+    auto pre = std::make_shared<MockProcessor>("pre");
+    auto post = std::make_shared<MockProcessor>("post");
+    chain->addStage(StageType::PreProcessing, pre);
+    chain->addStage(StageType::PostProcessing, post);
+
+    toolkit::config::SettingsSnapshot settings;
+    settings.values[(size_t)toolkit::config::SettingId::Sharpness] = 40;
+    chain->update(settings);
+
+    CHECK_EQ(pre->sharpness, 40);
+    CHECK_EQ(post->sharpness, 40);
+}
+
+TEST(AtlasViewRegionsDoNotOverlap) {
+    // Two 900x900 views packed side by side in a 2000x900 atlas, upscaled by 1.5.
+    const auto appInfo = MakeAppInfo();
+    auto runtimeInfo = appInfo;
+    runtimeInfo.width = 3000;
+    runtimeInfo.height = 1350;
+
+    const auto left = GetViewRegion(0, {{0, 0}, {900, 900}}, appInfo, runtimeInfo);
+    const auto right = GetViewRegion(1, {{1000, 0}, {900, 900}}, appInfo, runtimeInfo);
+    CHECK_EQ(left.view, 0u);
+    CHECK_EQ(right.view, 1u);
+
+    // Each rectangle is scaled, not stretched to the edge of the atlas.
+    CHECK_EQ(left.output.offset.x, 0);
+    CHECK_EQ(left.output.extent.width, 1350);
+    CHECK_EQ(left.output.extent.height, 1350);
+    CHECK_EQ(right.output.offset.x, 1500);
+    CHECK_EQ(right.output.extent.width, 1350);
+    CHECK(left.output.offset.x + left.output.extent.width <= right.output.offset.x);
+    CHECK(right.output.offset.x + right.output.extent.width <= (int32_t)runtimeInfo.width);
+
+    // Adjacent views stay adjacent, even when the scaling rounds.
+    runtimeInfo.width = 2999;
+    const auto first = GetViewRegion(0, {{0, 0}, {1000, 900}}, appInfo, runtimeInfo);
+    const auto second = GetViewRegion(1, {{1000, 0}, {1000, 900}}, appInfo, runtimeInfo);
+    CHECK_EQ(first.output.offset.x + first.output.extent.width, second.output.offset.x);
+    CHECK_EQ(second.output.offset.x + second.output.extent.width, 2999);
+
+    // Without scaling, the rectangle is unchanged.
+    const auto same = GetViewRegion(1, {{1000, 0}, {900, 900}}, appInfo, appInfo);
+    CHECK_EQ(same.output.offset.x, 1000);
+    CHECK_EQ(same.output.extent.width, 900);
+}
+
+TEST(SmallerRenderResolutionIsUpscaledToTheView) {
+    // The double-wide swapchain was created at 1000x900 per view, and the factor was then raised so that the
+    // application renders 500x450 per view.
+    const auto appInfo = MakeAppInfo();
+    auto runtimeInfo = appInfo;
+    runtimeInfo.width = 4000;
+    runtimeInfo.height = 1800;
+
+    const auto left = GetViewRegion(0, {{0, 0}, {500, 450}}, appInfo, runtimeInfo, ViewResolution, {500, 450});
+    const auto right = GetViewRegion(1, {{1000, 0}, {500, 450}}, appInfo, runtimeInfo, ViewResolution, {500, 450});
+    CHECK_EQ(left.input.extent.width, 500);
+    CHECK_EQ(left.output.offset.x, 0);
+    CHECK_EQ(left.output.extent.width, 2000);
+    CHECK_EQ(left.output.extent.height, 1800);
+    CHECK_EQ(right.output.offset.x, 2000);
+    CHECK_EQ(right.output.extent.width, 2000);
+
+    // An application that keeps rendering the whole swapchain is not stretched past its view.
+    const auto whole = GetViewRegion(1, {{1000, 0}, {1000, 900}}, appInfo, runtimeInfo, ViewResolution, {500, 450});
+    CHECK_EQ(whole.output.offset.x, 2000);
+    CHECK_EQ(whole.output.extent.width, 2000);
+
+    // A lower factor than the swapchain was created for cannot be rendered, and the rectangle is only scaled.
+    const auto larger = GetViewRegion(0, {{0, 0}, {1000, 900}}, appInfo, runtimeInfo, ViewResolution, {1500, 1350});
+    CHECK_EQ(larger.output.extent.width, 2000);
+    CHECK_EQ(larger.output.extent.height, 1800);
+}
+
+TEST(UpscalerScalesTheRectangleAtSameResolution) {
+    auto device = std::make_shared<MockDevice>();
+    auto chain = CreateProcessingChain(device);
+    chain->addStage(StageType::Upscaling, std::make_shared<MockUpscaler>(1000, 900));
+    chain->addStage(StageType::PostProcessing, std::make_shared<MockProcessor>("post"));
+
+    // The swapchain was created without scaling, and the application now renders at 150%.
+    const auto images = CreateImages(*chain, MakeAppInfo(), 1);
+    const auto& appInfo = images.chains[0].front()->getInfo();
+    const auto& runtimeInfo = images.chains[0].back()->getInfo();
+    CHECK_EQ(runtimeInfo.width, appInfo.width);
+    const auto region = GetViewRegion(1, {{1000, 0}, {666, 600}}, appInfo, runtimeInfo, ViewResolution, {666, 600});
+
+    executions.clear();
+    chain->process(images.chains[0], images.layout, -1, region, nullptr);
+    CHECK_EQ(executions.size(), 2u);
+    CHECK(executions[0].stage == "upscaler");
+    CHECK_EQ(executions[0].region.input.extent.width, 666);
+    CHECK_EQ(executions[0].region.output.offset.x, 1000);
+    CHECK_EQ(executions[0].region.output.extent.width, 1000);
+    CHECK_EQ(executions[0].region.output.extent.height, 900);
+    CHECK_EQ(executions[1].region.input.extent.width, 1000);
+    CHECK_EQ(executions[1].region.output.extent.width, 1000);
+}
+
+TEST_MAIN()
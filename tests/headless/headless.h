@@ -0,0 +1,795 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+// Stand-ins for the platform definitions used by the platform-independent parts of the layer, so that they can be
+// built and tested on any OS. Only what the tests compile is declared here.
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+// Windows.
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef unsigned int UINT;
+typedef unsigned long DWORD;
+typedef long LONG;
+typedef long long LONGLONG;
+typedef long HRESULT;
+typedef void* HANDLE;
+
+typedef union _LARGE_INTEGER {
+    struct {
+        DWORD LowPart;
+        LONG HighPart;
+    };
+    LONGLONG QuadPart;
+} LARGE_INTEGER;
+
+#define __declspec(x)
+
+#define VK_CONTROL 0x11
+#define VK_F11 0x7A
+#define VK_F12 0x7B
+
+#define _TRUNCATE ((size_t)-1)
+
+inline BOOL QueryPerformanceCounter(LARGE_INTEGER* count) {
+    count->QuadPart =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    return 1;
+}
+
+// There is no keyboard in the headless builds.
+inline short GetAsyncKeyState(int) {
+    return 0;
+}
+
+inline DWORD GetCurrentProcessId() {
+    return 1;
+}
+
+inline DWORD GetCurrentThreadId() {
+    return (DWORD)std::hash<std::thread::id>{}(std::this_thread::get_id());
+}
+
+template <size_t size>
+int strcpy_s(char (&dest)[size], const char* src) {
+    strncpy(dest, src, size - 1);
+    dest[size - 1] = '\0';
+    return 0;
+}
+
+inline int strncpy_s(char* dest, size_t destSize, const char* src, size_t count) {
+    const size_t length = std::min(std::min(strlen(src), count), destSize - 1);
+    memcpy(dest, src, length);
+    dest[length] = '\0';
+    return 0;
+}
+
+// Direct3D. The graphics objects are only ever handled through pointers outside of d3d11.cpp and d3d12.cpp.
+struct ID3D11Device;
+struct ID3D11DeviceContext;
+struct ID3D11Texture2D;
+struct ID3D11Buffer;
+struct ID3D11PixelShader;
+struct ID3D11ComputeShader;
+struct ID3D11ShaderResourceView;
+struct ID3D11UnorderedAccessView;
+struct ID3D11RenderTargetView;
+struct ID3D11DepthStencilView;
+struct ID3D12Device;
+struct ID3D12CommandQueue;
+struct ID3D12GraphicsCommandList;
+struct ID3D12Resource;
+struct ID3D12RootSignature;
+struct ID3D12PipelineState;
+struct D3D12_CPU_DESCRIPTOR_HANDLE;
+
+struct D3D_SHADER_MACRO {
+    const char* Name;
+    const char* Definition;
+};
+
+enum DXGI_FORMAT {
+    DXGI_FORMAT_UNKNOWN = 0,
+    DXGI_FORMAT_R32G32B32A32_TYPELESS = 1,
+    DXGI_FORMAT_R32G32B32A32_FLOAT = 2,
+    DXGI_FORMAT_R16G16B16A16_TYPELESS = 9,
+    DXGI_FORMAT_R16G16B16A16_FLOAT = 10,
+    DXGI_FORMAT_R16G16B16A16_UNORM = 11,
+    DXGI_FORMAT_R10G10B10A2_UNORM = 24,
+    DXGI_FORMAT_R8G8B8A8_UNORM = 28,
+    DXGI_FORMAT_R8G8B8A8_UNORM_SRGB = 29,
+};
+
+// OpenXR.
+#define XR_TRUE 1
+#define XR_FALSE 0
+#define XR_NULL_PATH 0
+#define XR_NULL_HANDLE nullptr
+#define XR_NULL_SYSTEM_ID 0
+#define XR_MAX_PATH_LENGTH 256
+#define XR_MAX_APPLICATION_NAME_SIZE 128
+#define XR_MAX_EXTENSION_NAME_SIZE 128
+#define XR_MAX_ENGINE_NAME_SIZE 128
+#define XR_MAX_RUNTIME_NAME_SIZE 128
+#define XR_MAX_SYSTEM_NAME_SIZE 256
+
+#define XR_SUCCEEDED(result) ((result) >= 0)
+#define XR_FAILED(result) ((result) < 0)
+
+#define XR_MAKE_VERSION(major, minor, patch)                                                                           \
+    ((((major)&0xffffULL) << 48) | (((minor)&0xffffULL) << 32) | ((patch)&0xffffffffULL))
+#define XR_VERSION_MAJOR(version) (uint16_t)(((uint64_t)(version) >> 48) & 0xffffULL)
+#define XR_VERSION_MINOR(version) (uint16_t)(((uint64_t)(version) >> 32) & 0xffffULL)
+#define XR_VERSION_PATCH(version) (uint32_t)((uint64_t)(version)&0xffffffffULL)
+
+typedef uint32_t XrBool32;
+typedef uint64_t XrFlags64;
+typedef int64_t XrTime;
+typedef int64_t XrDuration;
+typedef uint64_t XrPath;
+typedef uint64_t XrSystemId;
+typedef uint64_t XrVersion;
+typedef int32_t XrResult;
+typedef int32_t XrStructureType;
+
+static const XrResult XR_SUCCESS = 0;
+static const XrResult XR_ERROR_RUNTIME_FAILURE = -2;
+static const XrResult XR_ERROR_INITIALIZATION_FAILED = -6;
+static const XrResult XR_ERROR_FUNCTION_UNSUPPORTED = -7;
+
+static const XrStructureType XR_TYPE_EXTENSION_PROPERTIES = 2;
+static const XrStructureType XR_TYPE_INSTANCE_CREATE_INFO = 3;
+static const XrStructureType XR_TYPE_SYSTEM_GET_INFO = 4;
+static const XrStructureType XR_TYPE_SYSTEM_PROPERTIES = 5;
+static const XrStructureType XR_TYPE_VIEW_LOCATE_INFO = 6;
+static const XrStructureType XR_TYPE_VIEW = 7;
+static const XrStructureType XR_TYPE_SESSION_CREATE_INFO = 8;
+static const XrStructureType XR_TYPE_VIEW_STATE = 11;
+static const XrStructureType XR_TYPE_FRAME_END_INFO = 12;
+static const XrStructureType XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED = 18;
+static const XrStructureType XR_TYPE_ACTION_STATE_BOOLEAN = 23;
+static const XrStructureType XR_TYPE_ACTION_STATE_FLOAT = 24;
+static const XrStructureType XR_TYPE_ACTION_STATE_POSE = 27;
+static const XrStructureType XR_TYPE_INSTANCE_PROPERTIES = 32;
+static const XrStructureType XR_TYPE_COMPOSITION_LAYER_PROJECTION = 35;
+static const XrStructureType XR_TYPE_VIEW_CONFIGURATION_VIEW = 41;
+static const XrStructureType XR_TYPE_SPACE_LOCATION = 42;
+static const XrStructureType XR_TYPE_EVENT_DATA_INTERACTION_PROFILE_CHANGED = 52;
+static const XrStructureType XR_TYPE_INTERACTION_PROFILE_STATE = 53;
+static const XrStructureType XR_TYPE_ACTION_STATE_GET_INFO = 58;
+static const XrStructureType XR_TYPE_ACTIONS_SYNC_INFO = 61;
+static const XrStructureType XR_TYPE_GRAPHICS_BINDING_D3D11_KHR = 1000027000;
+static const XrStructureType XR_TYPE_SWAPCHAIN_IMAGE_D3D11_KHR = 1000027001;
+static const XrStructureType XR_TYPE_GRAPHICS_BINDING_D3D12_KHR = 1000028000;
+static const XrStructureType XR_TYPE_SWAPCHAIN_IMAGE_D3D12_KHR = 1000028001;
+static const XrStructureType XR_TYPE_VISIBILITY_MASK_KHR = 1000031000;
+static const XrStructureType XR_TYPE_EVENT_DATA_VISIBILITY_MASK_CHANGED_KHR = 1000031001;
+static const XrStructureType XR_TYPE_SYSTEM_HAND_TRACKING_PROPERTIES_EXT = 1000051000;
+
+enum XrFormFactor {
+    XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY = 1,
+    XR_FORM_FACTOR_HANDHELD_DISPLAY = 2,
+};
+
+enum XrViewConfigurationType {
+    XR_VIEW_CONFIGURATION_TYPE_PRIMARY_MONO = 1,
+    XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO = 2,
+};
+
+enum XrEnvironmentBlendMode {
+    XR_ENVIRONMENT_BLEND_MODE_OPAQUE = 1,
+};
+
+enum XrReferenceSpaceType {
+    XR_REFERENCE_SPACE_TYPE_VIEW = 1,
+    XR_REFERENCE_SPACE_TYPE_LOCAL = 2,
+    XR_REFERENCE_SPACE_TYPE_STAGE = 3,
+};
+
+enum XrActionType {
+    XR_ACTION_TYPE_BOOLEAN_INPUT = 1,
+    XR_ACTION_TYPE_FLOAT_INPUT = 2,
+    XR_ACTION_TYPE_POSE_INPUT = 4,
+};
+
+enum XrVisibilityMaskTypeKHR {
+    XR_VISIBILITY_MASK_TYPE_HIDDEN_TRIANGLE_MESH_KHR = 1,
+    XR_VISIBILITY_MASK_TYPE_VISIBLE_TRIANGLE_MESH_KHR = 2,
+    XR_VISIBILITY_MASK_TYPE_LINE_LOOP_KHR = 3,
+};
+
+typedef struct XrInstance_T* XrInstance;
+typedef struct XrSession_T* XrSession;
+typedef struct XrSpace_T* XrSpace;
+typedef struct XrAction_T* XrAction;
+typedef struct XrActionSet_T* XrActionSet;
+typedef struct XrSwapchain_T* XrSwapchain;
+
+typedef XrFlags64 XrInstanceCreateFlags;
+typedef XrFlags64 XrSessionCreateFlags;
+typedef XrFlags64 XrSpaceLocationFlags;
+typedef XrFlags64 XrViewStateFlags;
+typedef XrFlags64 XrCompositionLayerFlags;
+typedef XrFlags64 XrSwapchainCreateFlags;
+typedef XrFlags64 XrSwapchainUsageFlags;
+static const XrSwapchainUsageFlags XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT = 0x00000001;
+static const XrSwapchainUsageFlags XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT = 0x00000002;
+static const XrSwapchainUsageFlags XR_SWAPCHAIN_USAGE_UNORDERED_ACCESS_BIT = 0x00000004;
+static const XrSwapchainUsageFlags XR_SWAPCHAIN_USAGE_TRANSFER_SRC_BIT = 0x00000008;
+static const XrSwapchainUsageFlags XR_SWAPCHAIN_USAGE_TRANSFER_DST_BIT = 0x00000010;
+static const XrSwapchainUsageFlags XR_SWAPCHAIN_USAGE_SAMPLED_BIT = 0x00000020;
+
+struct XrSwapchainCreateInfo {
+    XrStructureType type;
+    const void* next;
+    XrSwapchainCreateFlags createFlags;
+    XrSwapchainUsageFlags usageFlags;
+    int64_t format;
+    uint32_t sampleCount;
+    uint32_t width;
+    uint32_t height;
+    uint32_t faceCount;
+    uint32_t arraySize;
+    uint32_t mipCount;
+};
+
+struct XrVector2f {
+    float x;
+    float y;
+};
+
+struct XrVector3f {
+    float x;
+    float y;
+    float z;
+};
+
+struct XrQuaternionf {
+    float x;
+    float y;
+    float z;
+    float w;
+};
+
+struct XrPosef {
+    XrQuaternionf orientation;
+    XrVector3f position;
+};
+
+struct XrFovf {
+    float angleLeft;
+    float angleRight;
+    float angleUp;
+    float angleDown;
+};
+
+struct XrColor4f {
+    float r;
+    float g;
+    float b;
+    float a;
+};
+
+struct XrOffset2Di {
+    int32_t x;
+    int32_t y;
+};
+
+struct XrExtent2Di {
+    int32_t width;
+    int32_t height;
+};
+
+struct XrRect2Di {
+    XrOffset2Di offset;
+    XrExtent2Di extent;
+};
+
+struct XrBaseInStructure {
+    XrStructureType type;
+    const struct XrBaseInStructure* next;
+};
+
+struct XrApplicationInfo {
+    char applicationName[XR_MAX_APPLICATION_NAME_SIZE];
+    uint32_t applicationVersion;
+    char engineName[XR_MAX_ENGINE_NAME_SIZE];
+    uint32_t engineVersion;
+    XrVersion apiVersion;
+};
+
+struct XrInstanceCreateInfo {
+    XrStructureType type;
+    const void* next;
+    XrInstanceCreateFlags createFlags;
+    XrApplicationInfo applicationInfo;
+    uint32_t enabledApiLayerCount;
+    const char* const* enabledApiLayerNames;
+    uint32_t enabledExtensionCount;
+    const char* const* enabledExtensionNames;
+};
+
+struct XrExtensionProperties {
+    XrStructureType type;
+    void* next;
+    char extensionName[XR_MAX_EXTENSION_NAME_SIZE];
+    uint32_t extensionVersion;
+};
+
+struct XrInstanceProperties {
+    XrStructureType type;
+    void* next;
+    XrVersion runtimeVersion;
+    char runtimeName[XR_MAX_RUNTIME_NAME_SIZE];
+};
+
+struct XrSystemGetInfo {
+    XrStructureType type;
+    const void* next;
+    XrFormFactor formFactor;
+};
+
+struct XrSystemProperties {
+    XrStructureType type;
+    void* next;
+    XrSystemId systemId;
+    uint32_t vendorId;
+    char systemName[XR_MAX_SYSTEM_NAME_SIZE];
+};
+
+struct XrSystemHandTrackingPropertiesEXT {
+    XrStructureType type;
+    void* next;
+    XrBool32 supportsHandTracking;
+};
+
+struct XrViewConfigurationView {
+    XrStructureType type;
+    void* next;
+    uint32_t recommendedImageRectWidth;
+    uint32_t maxImageRectWidth;
+    uint32_t recommendedImageRectHeight;
+    uint32_t maxImageRectHeight;
+    uint32_t recommendedSwapchainSampleCount;
+    uint32_t maxSwapchainSampleCount;
+};
+
+struct XrSessionCreateInfo {
+    XrStructureType type;
+    const void* next;
+    XrSessionCreateFlags createFlags;
+    XrSystemId systemId;
+};
+
+struct XrGraphicsBindingD3D11KHR {
+    XrStructureType type;
+    const void* next;
+    ID3D11Device* device;
+};
+
+struct XrGraphicsBindingD3D12KHR {
+    XrStructureType type;
+    const void* next;
+    ID3D12Device* device;
+    ID3D12CommandQueue* queue;
+};
+
+struct XrSwapchainImageBaseHeader {
+    XrStructureType type;
+    void* next;
+};
+
+struct XrSwapchainImageD3D11KHR {
+    XrStructureType type;
+    void* next;
+    ID3D11Texture2D* texture;
+};
+
+struct XrSwapchainImageD3D12KHR {
+    XrStructureType type;
+    void* next;
+    ID3D12Resource* texture;
+};
+
+struct XrSwapchainImageAcquireInfo {
+    XrStructureType type;
+    const void* next;
+};
+
+struct XrSwapchainSubImage {
+    XrSwapchain swapchain;
+    XrRect2Di imageRect;
+    uint32_t imageArrayIndex;
+};
+
+struct XrReferenceSpaceCreateInfo {
+    XrStructureType type;
+    const void* next;
+    XrReferenceSpaceType referenceSpaceType;
+    XrPosef poseInReferenceSpace;
+};
+
+struct XrActionSpaceCreateInfo {
+    XrStructureType type;
+    const void* next;
+    XrAction action;
+    XrPath subactionPath;
+    XrPosef poseInActionSpace;
+};
+
+struct XrSpaceLocation {
+    XrStructureType type;
+    void* next;
+    XrSpaceLocationFlags locationFlags;
+    XrPosef pose;
+};
+
+struct XrActionCreateInfo {
+    XrStructureType type;
+    const void* next;
+    char actionName[64];
+    XrActionType actionType;
+    uint32_t countSubactionPaths;
+    const XrPath* subactionPaths;
+    char localizedActionName[128];
+};
+
+struct XrActionSuggestedBinding {
+    XrAction action;
+    XrPath binding;
+};
+
+struct XrInteractionProfileSuggestedBinding {
+    XrStructureType type;
+    const void* next;
+    XrPath interactionProfile;
+    uint32_t countSuggestedBindings;
+    const XrActionSuggestedBinding* suggestedBindings;
+};
+
+struct XrInteractionProfileState {
+    XrStructureType type;
+    void* next;
+    XrPath interactionProfile;
+};
+
+struct XrActiveActionSet {
+    XrActionSet actionSet;
+    XrPath subactionPath;
+};
+
+struct XrActionsSyncInfo {
+    XrStructureType type;
+    const void* next;
+    uint32_t countActiveActionSets;
+    const XrActiveActionSet* activeActionSets;
+};
+
+struct XrActionStateGetInfo {
+    XrStructureType type;
+    const void* next;
+    XrAction action;
+    XrPath subactionPath;
+};
+
+struct XrActionStateBoolean {
+    XrStructureType type;
+    void* next;
+    XrBool32 currentState;
+    XrBool32 changedSinceLastSync;
+    XrTime lastChangeTime;
+    XrBool32 isActive;
+};
+
+struct XrActionStateFloat {
+    XrStructureType type;
+    void* next;
+    float currentState;
+    XrBool32 changedSinceLastSync;
+    XrTime lastChangeTime;
+    XrBool32 isActive;
+};
+
+struct XrActionStatePose {
+    XrStructureType type;
+    void* next;
+    XrBool32 isActive;
+};
+
+struct XrFrameWaitInfo {
+    XrStructureType type;
+    const void* next;
+};
+
+struct XrFrameState {
+    XrStructureType type;
+    void* next;
+    XrTime predictedDisplayTime;
+    XrDuration predictedDisplayPeriod;
+    XrBool32 shouldRender;
+};
+
+struct XrFrameBeginInfo {
+    XrStructureType type;
+    const void* next;
+};
+
+struct XrCompositionLayerBaseHeader {
+    XrStructureType type;
+    const void* next;
+    XrCompositionLayerFlags layerFlags;
+    XrSpace space;
+};
+
+struct XrCompositionLayerProjectionView {
+    XrStructureType type;
+    const void* next;
+    XrPosef pose;
+    XrFovf fov;
+    XrSwapchainSubImage subImage;
+};
+
+struct XrCompositionLayerProjection {
+    XrStructureType type;
+    const void* next;
+    XrCompositionLayerFlags layerFlags;
+    XrSpace space;
+    uint32_t viewCount;
+    const XrCompositionLayerProjectionView* views;
+};
+
+struct XrFrameEndInfo {
+    XrStructureType type;
+    const void* next;
+    XrTime displayTime;
+    XrEnvironmentBlendMode environmentBlendMode;
+    uint32_t layerCount;
+    const XrCompositionLayerBaseHeader* const* layers;
+};
+
+struct XrViewLocateInfo {
+    XrStructureType type;
+    const void* next;
+    XrViewConfigurationType viewConfigurationType;
+    XrTime displayTime;
+    XrSpace space;
+};
+
+struct XrViewState {
+    XrStructureType type;
+    void* next;
+    XrViewStateFlags viewStateFlags;
+};
+
+struct XrView {
+    XrStructureType type;
+    void* next;
+    XrPosef pose;
+    XrFovf fov;
+};
+
+struct XrEventDataBuffer {
+    XrStructureType type;
+    const void* next;
+    uint8_t varying[4000];
+};
+
+struct XrEventDataInteractionProfileChanged {
+    XrStructureType type;
+    const void* next;
+    XrSession session;
+};
+
+struct XrEventDataVisibilityMaskChangedKHR {
+    XrStructureType type;
+    const void* next;
+    XrSession session;
+    XrViewConfigurationType viewConfigurationType;
+    uint32_t viewIndex;
+};
+
+struct XrVisibilityMaskKHR {
+    XrStructureType type;
+    void* next;
+    uint32_t vertexCapacityInput;
+    uint32_t vertexCountOutput;
+    XrVector2f* vertices;
+    uint32_t indexCapacityInput;
+    uint32_t indexCountOutput;
+    uint32_t* indices;
+};
+
+// The entry points, as resolved through xrGetInstanceProcAddr().
+typedef void (*PFN_xrVoidFunction)(void);
+typedef XrResult (*PFN_xrGetInstanceProcAddr)(XrInstance instance, const char* name, PFN_xrVoidFunction* function);
+typedef XrResult (*PFN_xrEnumerateInstanceExtensionProperties)(const char* layerName,
+                                                                uint32_t propertyCapacityInput,
+                                                                uint32_t* propertyCountOutput,
+                                                                XrExtensionProperties* properties);
+typedef XrResult (*PFN_xrDestroyInstance)(XrInstance instance);
+typedef XrResult (*PFN_xrGetInstanceProperties)(XrInstance instance, XrInstanceProperties* instanceProperties);
+typedef XrResult (*PFN_xrPollEvent)(XrInstance instance, XrEventDataBuffer* eventData);
+typedef XrResult (*PFN_xrGetSystem)(XrInstance instance, const XrSystemGetInfo* getInfo, XrSystemId* systemId);
+typedef XrResult (*PFN_xrGetSystemProperties)(XrInstance instance,
+                                              XrSystemId systemId,
+                                              XrSystemProperties* properties);
+typedef XrResult (*PFN_xrCreateSession)(XrInstance instance,
+                                        const XrSessionCreateInfo* createInfo,
+                                        XrSession* session);
+typedef XrResult (*PFN_xrDestroySession)(XrSession session);
+typedef XrResult (*PFN_xrCreateReferenceSpace)(XrSession session,
+                                               const XrReferenceSpaceCreateInfo* createInfo,
+                                               XrSpace* space);
+typedef XrResult (*PFN_xrCreateActionSpace)(XrSession session,
+                                            const XrActionSpaceCreateInfo* createInfo,
+                                            XrSpace* space);
+typedef XrResult (*PFN_xrLocateSpace)(XrSpace space, XrSpace baseSpace, XrTime time, XrSpaceLocation* location);
+typedef XrResult (*PFN_xrDestroySpace)(XrSpace space);
+typedef XrResult (*PFN_xrEnumerateViewConfigurationViews)(XrInstance instance,
+                                                          XrSystemId systemId,
+                                                          XrViewConfigurationType viewConfigurationType,
+                                                          uint32_t viewCapacityInput,
+                                                          uint32_t* viewCountOutput,
+                                                          XrViewConfigurationView* views);
+typedef XrResult (*PFN_xrCreateSwapchain)(XrSession session,
+                                          const XrSwapchainCreateInfo* createInfo,
+                                          XrSwapchain* swapchain);
+typedef XrResult (*PFN_xrDestroySwapchain)(XrSwapchain swapchain);
+typedef XrResult (*PFN_xrEnumerateSwapchainImages)(XrSwapchain swapchain,
+                                                   uint32_t imageCapacityInput,
+                                                   uint32_t* imageCountOutput,
+                                                   XrSwapchainImageBaseHeader* images);
+typedef XrResult (*PFN_xrAcquireSwapchainImage)(XrSwapchain swapchain,
+                                                const XrSwapchainImageAcquireInfo* acquireInfo,
+                                                uint32_t* index);
+typedef XrResult (*PFN_xrWaitFrame)(XrSession session, const XrFrameWaitInfo* frameWaitInfo, XrFrameState* frameState);
+typedef XrResult (*PFN_xrBeginFrame)(XrSession session, const XrFrameBeginInfo* frameBeginInfo);
+typedef XrResult (*PFN_xrEndFrame)(XrSession session, const XrFrameEndInfo* frameEndInfo);
+typedef XrResult (*PFN_xrLocateViews)(XrSession session,
+                                      const XrViewLocateInfo* viewLocateInfo,
+                                      XrViewState* viewState,
+                                      uint32_t viewCapacityInput,
+                                      uint32_t* viewCountOutput,
+                                      XrView* views);
+typedef XrResult (*PFN_xrStringToPath)(XrInstance instance, const char* pathString, XrPath* path);
+typedef XrResult (*PFN_xrPathToString)(XrInstance instance,
+                                       XrPath path,
+                                       uint32_t bufferCapacityInput,
+                                       uint32_t* bufferCountOutput,
+                                       char* buffer);
+typedef XrResult (*PFN_xrCreateAction)(XrActionSet actionSet, const XrActionCreateInfo* createInfo, XrAction* action);
+typedef XrResult (*PFN_xrDestroyAction)(XrAction action);
+typedef XrResult (*PFN_xrSuggestInteractionProfileBindings)(
+    XrInstance instance, const XrInteractionProfileSuggestedBinding* suggestedBindings);
+typedef XrResult (*PFN_xrGetCurrentInteractionProfile)(XrSession session,
+                                                       XrPath topLevelUserPath,
+                                                       XrInteractionProfileState* interactionProfile);
+typedef XrResult (*PFN_xrGetActionStateBoolean)(XrSession session,
+                                                const XrActionStateGetInfo* getInfo,
+                                                XrActionStateBoolean* state);
+typedef XrResult (*PFN_xrGetActionStateFloat)(XrSession session,
+                                              const XrActionStateGetInfo* getInfo,
+                                              XrActionStateFloat* state);
+typedef XrResult (*PFN_xrGetActionStatePose)(XrSession session,
+                                             const XrActionStateGetInfo* getInfo,
+                                             XrActionStatePose* state);
+typedef XrResult (*PFN_xrSyncActions)(XrSession session, const XrActionsSyncInfo* syncInfo);
+typedef XrResult (*PFN_xrConvertWin32PerformanceCounterToTimeKHR)(XrInstance instance,
+                                                                  const LARGE_INTEGER* performanceCounter,
+                                                                  XrTime* time);
+typedef XrResult (*PFN_xrGetVisibilityMaskKHR)(XrSession session,
+                                               XrViewConfigurationType viewConfigurationType,
+                                               uint32_t viewIndex,
+                                               XrVisibilityMaskTypeKHR visibilityMaskType,
+                                               XrVisibilityMaskKHR* visibilityMask);
+
+// OpenXR loader interfaces.
+#define XR_API_LAYER_NEXT_INFO_STRUCT_VERSION 1
+#define XR_API_LAYER_CREATE_INFO_STRUCT_VERSION 1
+#define XR_API_LAYER_MAX_SETTINGS_PATH_SIZE 512
+#define XR_MAX_API_LAYER_NAME_SIZE 256
+
+enum XrLoaderInterfaceStructs {
+    XR_LOADER_INTERFACE_STRUCT_UNINTIALIZED = 0,
+    XR_LOADER_INTERFACE_STRUCT_LOADER_INFO,
+    XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST,
+    XR_LOADER_INTERFACE_STRUCT_RUNTIME_REQUEST,
+    XR_LOADER_INTERFACE_STRUCT_API_LAYER_CREATE_INFO,
+    XR_LOADER_INTERFACE_STRUCT_API_LAYER_NEXT_INFO,
+};
+
+typedef XrResult (*PFN_xrCreateApiLayerInstance)(const XrInstanceCreateInfo* info,
+                                                 const struct XrApiLayerCreateInfo* apiLayerInfo,
+                                                 XrInstance* instance);
+
+struct XrApiLayerNextInfo {
+    XrLoaderInterfaceStructs structType;
+    uint32_t structVersion;
+    size_t structSize;
+    char layerName[XR_MAX_API_LAYER_NAME_SIZE];
+    PFN_xrGetInstanceProcAddr nextGetInstanceProcAddr;
+    PFN_xrCreateApiLayerInstance nextCreateApiLayerInstance;
+    struct XrApiLayerNextInfo* next;
+};
+
+struct XrApiLayerCreateInfo {
+    XrLoaderInterfaceStructs structType;
+    uint32_t structVersion;
+    size_t structSize;
+    void* loaderInstance;
+    char settings_file_location[XR_API_LAYER_MAX_SETTINGS_PATH_SIZE];
+    XrApiLayerNextInfo* nextInfo;
+};
+
+// OpenXR utilities (XrError.h and XrMath.h).
+#define CHECK_XRCMD(cmd) xr::detail::CheckXrResult(cmd, #cmd)
+
+namespace xr {
+    namespace detail {
+        inline XrResult CheckXrResult(XrResult result, const char* originator) {
+            if (XR_FAILED(result)) {
+                throw std::logic_error(std::string(originator) + " failed with " + std::to_string(result));
+            }
+            return result;
+        }
+    } // namespace detail
+
+    namespace math {
+        inline float Length(const XrVector3f& v) {
+            return std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+        }
+
+        inline XrVector3f Normalize(const XrVector3f& v) {
+            const float length = Length(v);
+            return {v.x / length, v.y / length, v.z / length};
+        }
+    } // namespace math
+} // namespace xr
+
+inline XrVector3f operator+(const XrVector3f& a, const XrVector3f& b) {
+    return {a.x + b.x, a.y + b.y, a.z + b.z};
+}
+
+inline XrVector3f operator-(const XrVector3f& a, const XrVector3f& b) {
+    return {a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+inline XrVector3f operator*(const XrVector3f& a, float s) {
+    return {a.x * s, a.y * s, a.z * s};
+}
+
+inline XrVector3f operator/(const XrVector3f& a, float s) {
+    return {a.x / s, a.y / s, a.z / s};
+}
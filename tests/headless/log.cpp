@@ -0,0 +1,76 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "log.h"
+
+// The log of the headless builds goes to the standard output, synchronously.
+namespace toolkit::log {
+
+    void Log(const char* fmt, ...) {
+        va_list va;
+        va_start(va, fmt);
+        vprintf(fmt, va);
+        va_end(va);
+    }
+
+    void DebugLog(const char* fmt, ...) {
+    }
+
+    void SetVerbosity(Channel channel, Verbosity verbosity) {
+    }
+
+    bool IsEnabled(Channel channel, Verbosity verbosity) {
+        return verbosity <= DefaultVerbosity;
+    }
+
+    void LogSite::log(const char* fmt, ...) {
+        va_list va;
+        va_start(va, fmt);
+        vprintf(fmt, va);
+        va_end(va);
+    }
+
+    void LogSite::flushCounts() {
+    }
+
+    void FlushLog() {
+        fflush(stdout);
+    }
+
+    void InstallCrashHandler() {
+    }
+
+    void RemoveCrashHandler() {
+    }
+
+    void RecordEvent(const char* name) {
+    }
+
+    void RecordStartupTime(const std::string& step, uint64_t durationUs) {
+    }
+
+    void LogStartupTimes() {
+    }
+
+} // namespace toolkit::log
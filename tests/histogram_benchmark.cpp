@@ -0,0 +1,95 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "factories.h"
+#include "interfaces.h"
+
+#include "benchmark.h"
+
+#include <random>
+
+// Measures the cost of recording a value in the latency histograms, which the layer does several times in each
+// xrEndFrame(), and of computing the percentiles once per second.
+
+namespace {
+
+    using namespace toolkit;
+    using namespace toolkit::utilities;
+
+    // Frame times around 11ms with a long tail, like in the layer.
+    std::vector<uint64_t> GenerateValues() {
+        std::mt19937 generator(42);
+        std::lognormal_distribution<double> distribution(std::log(11000.0), 0.3);
+        std::vector<uint64_t> values(4096);
+        for (auto& value : values) {
+            value = (uint64_t)distribution(generator);
+        }
+        return values;
+    }
+
+} // namespace
+
+int main() {
+    const auto values = GenerateValues();
+    const uint32_t mask = (uint32_t)values.size() - 1;
+
+    {
+        auto histogram = CreateLatencyHistogram(5);
+        const double ns = benchmark::Measure([&](uint32_t i) { histogram->record(values[i & mask]); });
+        printf("record, 1 thread: %.2f ns\n", ns);
+    }
+
+    {
+        // The GPU timings are recorded from the frame thread while another thread records too (the worst case for
+        // the atomic counters: both threads update the same buckets).
+        auto histogram = CreateLatencyHistogram(5);
+        std::atomic<bool> stop{false};
+        std::thread other([&] {
+            uint32_t i = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                histogram->record(values[i++ & mask]);
+            }
+        });
+        const double ns = benchmark::Measure([&](uint32_t i) { histogram->record(values[i & mask]); });
+        stop = true;
+        other.join();
+        printf("record, 2 threads: %.2f ns\n", ns);
+    }
+
+    for (const uint32_t windowCount : {1u, 5u}) {
+        // A second of frames at 90Hz, for each window.
+        auto histogram = CreateLatencyHistogram(windowCount);
+        const double ns = benchmark::Measure(
+            [&](uint32_t i) {
+                for (uint32_t j = 0; j < 90; j++) {
+                    histogram->record(values[(i * 90 + j) & mask]);
+                }
+                benchmark::Consume(histogram->computePercentiles().p99);
+            },
+            10000);
+        printf("90 records and computePercentiles(), %u window(s): %.2f us\n", windowCount, ns / 1000);
+    }
+
+    return 0;
+}
@@ -0,0 +1,177 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "factories.h"
+#include "interfaces.h"
+
+#include "test.h"
+
+#include <random>
+
+namespace {
+
+    using namespace toolkit;
+    using namespace toolkit::utilities;
+
+    // The values are clamped to 26 bits.
+    constexpr uint64_t MaxValue = (1ull << 26) - 1;
+
+    // The value stored for the bucket of a value. A larger value is recorded so the result is not clamped to the
+    // maximum.
+    uint64_t RoundTrip(ILatencyHistogram& histogram, uint64_t value) {
+        histogram.record(value);
+        histogram.record(MaxValue);
+        return histogram.computePercentiles().p50;
+    }
+
+    // The same ranks as the histogram.
+    uint64_t ExactPercentile(std::vector<uint64_t> values, size_t percent) {
+        const auto nth = values.begin() + (values.size() - 1) * percent / 100;
+        std::nth_element(values.begin(), nth, values.end());
+        return *nth;
+    }
+
+    // Each power of two is split into 32 buckets, so the middle of a bucket is within 1/64 of any of its values.
+    bool IsWithinBound(uint64_t actual, uint64_t expected) {
+        const uint64_t error = actual > expected ? actual - expected : expected - actual;
+        return error * 64 <= expected;
+    }
+
+} // namespace
+
+TEST(SmallValuesAreExact) {
+    auto histogram = CreateLatencyHistogram(1);
+    for (uint64_t value = 0; value < 64; value++) {
+        CHECK_EQ(RoundTrip(*histogram, value), value);
+    }
+}
+
+TEST(BucketRoundTripIsBounded) {
+    auto histogram = CreateLatencyHistogram(1);
+
+    uint64_t previous = 0;
+    for (uint64_t value = 64; value <= MaxValue; value += 1 + value / 200) {
+        const uint64_t bucketValue = RoundTrip(*histogram, value);
+        if (!IsWithinBound(bucketValue, value)) {
+            printf("%llu -> %llu\n", (unsigned long long)value, (unsigned long long)bucketValue);
+            CHECK(false);
+            break;
+        }
+
+        // The buckets are ordered.
+        CHECK(bucketValue >= previous);
+        previous = bucketValue;
+    }
+
+    // Both ends of a bucket map to the same value.
+    CHECK_EQ(RoundTrip(*histogram, 1024), RoundTrip(*histogram, 1055));
+    CHECK(RoundTrip(*histogram, 1055) != RoundTrip(*histogram, 1056));
+}
+
+TEST(PercentilesAreWithinBound) {
+    auto histogram = CreateLatencyHistogram(1);
+
+    // Frame times around 11ms with a long tail.
+    std::mt19937 generator(42);
+    std::lognormal_distribution<double> distribution(std::log(11000.0), 0.3);
+    std::vector<uint64_t> values;
+    for (int i = 0; i < 10000; i++) {
+        values.push_back((uint64_t)distribution(generator));
+        histogram->record(values.back());
+    }
+
+    const auto percentiles = histogram->computePercentiles();
+    CHECK(IsWithinBound(percentiles.p50, ExactPercentile(values, 50)));
+    CHECK(IsWithinBound(percentiles.p95, ExactPercentile(values, 95)));
+    CHECK(IsWithinBound(percentiles.p99, ExactPercentile(values, 99)));
+    CHECK_EQ(percentiles.max, *std::max_element(values.begin(), values.end()));
+}
+
+TEST(PercentilesDoNotExceedMax) {
+    auto histogram = CreateLatencyHistogram(1);
+    // The middle of the bucket is 1040.
+    histogram->record(1030);
+
+    const auto percentiles = histogram->computePercentiles();
+    CHECK_EQ(percentiles.p50, 1030ull);
+    CHECK_EQ(percentiles.p99, 1030ull);
+    CHECK_EQ(percentiles.max, 1030ull);
+}
+
+TEST(LargeValuesAreClamped) {
+    auto histogram = CreateLatencyHistogram(1);
+    histogram->record(MaxValue * 10);
+
+    const auto percentiles = histogram->computePercentiles();
+    CHECK_EQ(percentiles.max, MaxValue);
+    CHECK(IsWithinBound(percentiles.p50, MaxValue));
+}
+
+TEST(WindowIsReset) {
+    auto histogram = CreateLatencyHistogram(1);
+    histogram->record(5000);
+    histogram->computePercentiles();
+
+    const auto percentiles = histogram->computePercentiles();
+    CHECK_EQ(percentiles.p50, 0ull);
+    CHECK_EQ(percentiles.max, 0ull);
+}
+
+TEST(WindowsAreRolling) {
+    auto histogram = CreateLatencyHistogram(3);
+
+    // One slow frame among fast ones stays in the percentiles for 3 windows.
+    histogram->record(50000);
+    for (int i = 0; i < 9; i++) {
+        histogram->record(1000);
+    }
+    auto percentiles = histogram->computePercentiles();
+    CHECK_EQ(percentiles.max, 50000ull);
+    CHECK(IsWithinBound(percentiles.p50, 1000));
+
+    for (int window = 0; window < 2; window++) {
+        for (int i = 0; i < 10; i++) {
+            histogram->record(2000);
+        }
+        percentiles = histogram->computePercentiles();
+        CHECK_EQ(percentiles.max, 50000ull);
+    }
+    // The 30 values of the 3 windows: 9 at 1000, 20 at 2000 and 1 at 50000.
+    CHECK(IsWithinBound(percentiles.p50, 2000));
+
+    // The first window is dropped.
+    histogram->record(3000);
+    percentiles = histogram->computePercentiles();
+    CHECK_EQ(percentiles.max, 3000ull);
+    CHECK(IsWithinBound(percentiles.p50, 2000));
+
+    // Only empty windows.
+    for (int window = 0; window < 3; window++) {
+        percentiles = histogram->computePercentiles();
+    }
+    CHECK_EQ(percentiles.p50, 0ull);
+    CHECK_EQ(percentiles.max, 0ull);
+}
+
+TEST_MAIN()
@@ -0,0 +1,602 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "factories.h"
+#include "interfaces.h"
+#include "layer.h"
+#include "framework/dispatch.h"
+
+#include "benchmark.h"
+
+// Measures the CPU cost of the layer on the entry points that the applications call every frame. The layer is created
+// with xrCreateApiLayerInstance() and its entry points are resolved with xrGetInstanceProcAddr(), like the loader does,
+// on top of a mock runtime that returns canned views, poses and action states. The session has no graphics binding, so
+// the layer has no IDevice and xrEndFrame() only goes through the dispatch.
+//
+// Each entry point is measured through the layer and on the mock runtime directly. The results are written as JSON to
+// the file given on the command line (layer_benchmark.json by default), so that they can be compared between builds:
+//
+//   {"unit": "ns", "results": [{"name": "xrLocateViews", "layer": 12.3, "runtime": 2.1, "overhead": 10.2}, ...]}
+
+namespace {
+
+    using namespace toolkit;
+
+    // A runtime with one HMD, that answers each call with canned data.
+    namespace runtime {
+
+        const XrInstance Instance = reinterpret_cast<XrInstance>(0x1000);
+        const XrSystemId SystemId = 1;
+        const XrSession Session = reinterpret_cast<XrSession>(0x2000);
+        const XrSpace Space = reinterpret_cast<XrSpace>(0x3000);
+        const XrSpace ActionSpace = reinterpret_cast<XrSpace>(0x3001);
+        const XrActionSet ActionSet = reinterpret_cast<XrActionSet>(0x4000);
+        const XrAction Action = reinterpret_cast<XrAction>(0x5000);
+
+        constexpr uint32_t DisplayWidth = 2016;
+        constexpr uint32_t DisplayHeight = 2240;
+        constexpr XrDuration DisplayPeriod = 11111111;
+
+        XrTime g_displayTime = 0;
+
+        XrResult xrCreateApiLayerInstance(const XrInstanceCreateInfo* info,
+                                          const XrApiLayerCreateInfo* apiLayerInfo,
+                                          XrInstance* instance) {
+            *instance = Instance;
+            return XR_SUCCESS;
+        }
+
+        XrResult xrEnumerateInstanceExtensionProperties(const char* layerName,
+                                                        uint32_t propertyCapacityInput,
+                                                        uint32_t* propertyCountOutput,
+                                                        XrExtensionProperties* properties) {
+            *propertyCountOutput = 0;
+            return XR_SUCCESS;
+        }
+
+        XrResult xrDestroyInstance(XrInstance instance) {
+            return XR_SUCCESS;
+        }
+
+        XrResult xrGetInstanceProperties(XrInstance instance, XrInstanceProperties* instanceProperties) {
+            instanceProperties->runtimeVersion = XR_MAKE_VERSION(1, 0, 0);
+            strcpy_s(instanceProperties->runtimeName, "Mock Runtime");
+            return XR_SUCCESS;
+        }
+
+        XrResult xrGetSystem(XrInstance instance, const XrSystemGetInfo* getInfo, XrSystemId* systemId) {
+            *systemId = SystemId;
+            return XR_SUCCESS;
+        }
+
+        XrResult xrGetSystemProperties(XrInstance instance, XrSystemId systemId, XrSystemProperties* properties) {
+            properties->systemId = systemId;
+            strcpy_s(properties->systemName, "Mock HMD");
+            return XR_SUCCESS;
+        }
+
+        XrResult xrEnumerateViewConfigurationViews(XrInstance instance,
+                                                   XrSystemId systemId,
+                                                   XrViewConfigurationType viewConfigurationType,
+                                                   uint32_t viewCapacityInput,
+                                                   uint32_t* viewCountOutput,
+                                                   XrViewConfigurationView* views) {
+            *viewCountOutput = graphics::ViewCount;
+            if (views) {
+                for (uint32_t i = 0; i < std::min(viewCapacityInput, graphics::ViewCount); i++) {
+                    views[i].recommendedImageRectWidth = views[i].maxImageRectWidth = DisplayWidth;
+                    views[i].recommendedImageRectHeight = views[i].maxImageRectHeight = DisplayHeight;
+                    views[i].recommendedSwapchainSampleCount = views[i].maxSwapchainSampleCount = 1;
+                }
+            }
+            return XR_SUCCESS;
+        }
+
+        XrResult xrCreateSession(XrInstance instance, const XrSessionCreateInfo* createInfo, XrSession* session) {
+            *session = Session;
+            return XR_SUCCESS;
+        }
+
+        XrResult xrDestroySession(XrSession session) {
+            return XR_SUCCESS;
+        }
+
+        XrResult xrCreateReferenceSpace(XrSession session,
+                                        const XrReferenceSpaceCreateInfo* createInfo,
+                                        XrSpace* space) {
+            *space = Space;
+            return XR_SUCCESS;
+        }
+
+        XrResult xrEnumerateSwapchainImages(XrSwapchain swapchain,
+                                            uint32_t imageCapacityInput,
+                                            uint32_t* imageCountOutput,
+                                            XrSwapchainImageBaseHeader* images) {
+            *imageCountOutput = 0;
+            return XR_SUCCESS;
+        }
+
+        XrResult xrStringToPath(XrInstance instance, const char* pathString, XrPath* path) {
+            *path = 1;
+            return XR_SUCCESS;
+        }
+
+        XrResult xrPathToString(XrInstance instance,
+                                XrPath path,
+                                uint32_t bufferCapacityInput,
+                                uint32_t* bufferCountOutput,
+                                char* buffer) {
+            const char leftHand[] = "/user/hand/left";
+            *bufferCountOutput = sizeof(leftHand);
+            if (buffer) {
+                strncpy_s(buffer, bufferCapacityInput, leftHand, _TRUNCATE);
+            }
+            return XR_SUCCESS;
+        }
+
+        XrResult xrLocateViews(XrSession session,
+                               const XrViewLocateInfo* viewLocateInfo,
+                               XrViewState* viewState,
+                               uint32_t viewCapacityInput,
+                               uint32_t* viewCountOutput,
+                               XrView* views) {
+            // A 63mm IPD, and the FOV of a typical headset.
+            viewState->viewStateFlags = 0xf;
+            *viewCountOutput = graphics::ViewCount;
+            views[0].pose = {{0.0f, 0.0f, 0.0f, 1.0f}, {-0.0315f, 1.6f, 0.0f}};
+            views[0].fov = {-0.96f, 0.82f, 0.91f, -0.96f};
+            views[1].pose = {{0.0f, 0.0f, 0.0f, 1.0f}, {0.0315f, 1.6f, 0.0f}};
+            views[1].fov = {-0.82f, 0.96f, 0.91f, -0.96f};
+            return XR_SUCCESS;
+        }
+
+        XrResult xrLocateSpace(XrSpace space, XrSpace baseSpace, XrTime time, XrSpaceLocation* location) {
+            location->locationFlags = 0xf;
+            location->pose = {{0.0f, 0.0f, 0.0f, 1.0f}, {0.2f, 1.2f, -0.3f}};
+            return XR_SUCCESS;
+        }
+
+        XrResult xrSyncActions(XrSession session, const XrActionsSyncInfo* syncInfo) {
+            return XR_SUCCESS;
+        }
+
+        XrResult xrGetActionStateBoolean(XrSession session,
+                                         const XrActionStateGetInfo* getInfo,
+                                         XrActionStateBoolean* state) {
+            state->currentState = XR_TRUE;
+            state->isActive = XR_TRUE;
+            return XR_SUCCESS;
+        }
+
+        XrResult xrGetActionStateFloat(XrSession session,
+                                       const XrActionStateGetInfo* getInfo,
+                                       XrActionStateFloat* state) {
+            state->currentState = 0.5f;
+            state->isActive = XR_TRUE;
+            return XR_SUCCESS;
+        }
+
+        XrResult xrGetActionStatePose(XrSession session,
+                                      const XrActionStateGetInfo* getInfo,
+                                      XrActionStatePose* state) {
+            state->isActive = XR_TRUE;
+            return XR_SUCCESS;
+        }
+
+        XrResult xrWaitFrame(XrSession session, const XrFrameWaitInfo* frameWaitInfo, XrFrameState* frameState) {
+            g_displayTime += DisplayPeriod;
+            frameState->predictedDisplayTime = g_displayTime;
+            frameState->predictedDisplayPeriod = DisplayPeriod;
+            frameState->shouldRender = XR_TRUE;
+            return XR_SUCCESS;
+        }
+
+        XrResult xrBeginFrame(XrSession session, const XrFrameBeginInfo* frameBeginInfo) {
+            return XR_SUCCESS;
+        }
+
+        XrResult xrEndFrame(XrSession session, const XrFrameEndInfo* frameEndInfo) {
+            return XR_SUCCESS;
+        }
+
+        XrResult xrGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function) {
+#define RESOLVE(fn)                                                                                                    \
+    if (std::string_view(name) == #fn) {                                                                               \
+        *function = reinterpret_cast<PFN_xrVoidFunction>(fn);                                                          \
+        return XR_SUCCESS;                                                                                             \
+    }
+            RESOLVE(xrEnumerateInstanceExtensionProperties);
+            RESOLVE(xrDestroyInstance);
+            RESOLVE(xrGetInstanceProperties);
+            RESOLVE(xrGetSystem);
+            RESOLVE(xrGetSystemProperties);
+            RESOLVE(xrEnumerateViewConfigurationViews);
+            RESOLVE(xrCreateSession);
+            RESOLVE(xrDestroySession);
+            RESOLVE(xrCreateReferenceSpace);
+            RESOLVE(xrEnumerateSwapchainImages);
+            RESOLVE(xrStringToPath);
+            RESOLVE(xrPathToString);
+            RESOLVE(xrLocateViews);
+            RESOLVE(xrLocateSpace);
+            RESOLVE(xrSyncActions);
+            RESOLVE(xrGetActionStateBoolean);
+            RESOLVE(xrGetActionStateFloat);
+            RESOLVE(xrGetActionStatePose);
+            RESOLVE(xrWaitFrame);
+            RESOLVE(xrBeginFrame);
+            RESOLVE(xrEndFrame);
+#undef RESOLVE
+
+            *function = nullptr;
+            return XR_ERROR_FUNCTION_UNSUPPORTED;
+        }
+
+    } // namespace runtime
+
+    // The settings with their defaults, kept in memory instead of the registry.
+    class ConfigManager : public config::IConfigManager {
+      public:
+        ConfigManager() {
+            for (const auto& setting : config::SettingsTable) {
+                m_values[(size_t)setting.id] = setting.defaultValue;
+            }
+            takeSnapshot();
+        }
+
+        void tick() override {
+        }
+
+        void setDefault(config::SettingId id, int value) override {
+        }
+
+        int getValue(config::SettingId id) const override {
+            return m_values[(size_t)id];
+        }
+
+        int peekValue(config::SettingId id) const override {
+            return m_values[(size_t)id];
+        }
+
+        void setValue(config::SettingId id, int value, bool noCommitDelay) override {
+            m_values[(size_t)id] = value;
+        }
+
+        bool hasChanged(config::SettingId id) const override {
+            return false;
+        }
+
+        void resetToDefaults() override {
+        }
+
+        void hardReset() override {
+        }
+
+        bool isSafeMode() const override {
+            return false;
+        }
+
+        bool isExperimentalMode() const override {
+            return false;
+        }
+
+        void takeSnapshot() override {
+            for (size_t i = 0; i < (size_t)config::SettingId::MaxValue; i++) {
+                m_snapshot.values[i].store(m_values[i], std::memory_order_relaxed);
+            }
+        }
+
+        const config::SettingsSnapshot& getSnapshot() const override {
+            return m_snapshot;
+        }
+
+      private:
+        int m_values[(size_t)config::SettingId::MaxValue]{};
+        config::SettingsSnapshot m_snapshot;
+    };
+
+    std::shared_ptr<ConfigManager> g_configManager;
+
+    // The entry points of the layer, as the application sees them.
+    struct {
+        PFN_xrDestroyInstance xrDestroyInstance;
+        PFN_xrGetSystem xrGetSystem;
+        PFN_xrCreateSession xrCreateSession;
+        PFN_xrDestroySession xrDestroySession;
+        PFN_xrLocateViews xrLocateViews;
+        PFN_xrLocateSpace xrLocateSpace;
+        PFN_xrSyncActions xrSyncActions;
+        PFN_xrGetActionStateBoolean xrGetActionStateBoolean;
+        PFN_xrGetActionStateFloat xrGetActionStateFloat;
+        PFN_xrGetActionStatePose xrGetActionStatePose;
+        PFN_xrWaitFrame xrWaitFrame;
+        PFN_xrBeginFrame xrBeginFrame;
+        PFN_xrEndFrame xrEndFrame;
+    } g_layer;
+
+    template <typename Function>
+    void Resolve(const char* name, Function& function) {
+        CHECK_XRCMD(
+            toolkit::xrGetInstanceProcAddr(runtime::Instance, name, reinterpret_cast<PFN_xrVoidFunction*>(&function)));
+    }
+
+    void CreateLayer() {
+        XrApiLayerNextInfo nextInfo{XR_LOADER_INTERFACE_STRUCT_API_LAYER_NEXT_INFO,
+                                    XR_API_LAYER_NEXT_INFO_STRUCT_VERSION,
+                                    sizeof(XrApiLayerNextInfo)};
+        strcpy_s(nextInfo.layerName, LayerName.c_str());
+        nextInfo.nextGetInstanceProcAddr = runtime::xrGetInstanceProcAddr;
+        nextInfo.nextCreateApiLayerInstance = runtime::xrCreateApiLayerInstance;
+
+        XrApiLayerCreateInfo apiLayerInfo{XR_LOADER_INTERFACE_STRUCT_API_LAYER_CREATE_INFO,
+                                          XR_API_LAYER_CREATE_INFO_STRUCT_VERSION,
+                                          sizeof(XrApiLayerCreateInfo)};
+        apiLayerInfo.nextInfo = &nextInfo;
+
+        XrInstanceCreateInfo createInfo{XR_TYPE_INSTANCE_CREATE_INFO};
+        strcpy_s(createInfo.applicationInfo.applicationName, "layer_benchmark");
+        strcpy_s(createInfo.applicationInfo.engineName, "layer_benchmark");
+
+        XrInstance instance;
+        CHECK_XRCMD(toolkit::xrCreateApiLayerInstance(&createInfo, &apiLayerInfo, &instance));
+
+        Resolve("xrDestroyInstance", g_layer.xrDestroyInstance);
+        Resolve("xrGetSystem", g_layer.xrGetSystem);
+        Resolve("xrCreateSession", g_layer.xrCreateSession);
+        Resolve("xrDestroySession", g_layer.xrDestroySession);
+        Resolve("xrLocateViews", g_layer.xrLocateViews);
+        Resolve("xrLocateSpace", g_layer.xrLocateSpace);
+        Resolve("xrSyncActions", g_layer.xrSyncActions);
+        Resolve("xrGetActionStateBoolean", g_layer.xrGetActionStateBoolean);
+        Resolve("xrGetActionStateFloat", g_layer.xrGetActionStateFloat);
+        Resolve("xrGetActionStatePose", g_layer.xrGetActionStatePose);
+        Resolve("xrWaitFrame", g_layer.xrWaitFrame);
+        Resolve("xrBeginFrame", g_layer.xrBeginFrame);
+        Resolve("xrEndFrame", g_layer.xrEndFrame);
+
+        XrSystemGetInfo getInfo{XR_TYPE_SYSTEM_GET_INFO, nullptr, XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY};
+        XrSystemId systemId;
+        CHECK_XRCMD(g_layer.xrGetSystem(instance, &getInfo, &systemId));
+
+        // No graphics binding: the layer runs without an IDevice.
+        XrSessionCreateInfo sessionCreateInfo{XR_TYPE_SESSION_CREATE_INFO, nullptr, 0, systemId};
+        XrSession session;
+        CHECK_XRCMD(g_layer.xrCreateSession(instance, &sessionCreateInfo, &session));
+    }
+
+    void DestroyLayer() {
+        CHECK_XRCMD(g_layer.xrDestroySession(runtime::Session));
+        CHECK_XRCMD(g_layer.xrDestroyInstance(runtime::Instance));
+    }
+
+    struct Result {
+        const char* name;
+        double layerNs;
+        double runtimeNs;
+    };
+
+    // Measures an entry point through the layer and on the runtime.
+    template <typename Function, typename... Args>
+    Result Run(const char* name, Function layer, Function runtime, Args... args) {
+        Result result{name};
+        result.layerNs = benchmark::Measure([&](uint32_t i) { benchmark::Consume(layer(args...)); });
+        result.runtimeNs = benchmark::Measure([&](uint32_t i) { benchmark::Consume(runtime(args...)); });
+        return result;
+    }
+
+} // namespace
+
+// The parts of the layer that need Windows or a graphics device. Only the configuration is used without an IDevice.
+namespace toolkit {
+
+    namespace config {
+        std::shared_ptr<IConfigManager> CreateConfigManager(const std::string& appName) {
+            g_configManager = std::make_shared<ConfigManager>();
+            return g_configManager;
+        }
+    } // namespace config
+
+    namespace graphics {
+        std::shared_ptr<IDevice> WrapD3D11Device(ID3D11Device* device) {
+            throw new std::runtime_error("No D3D11 in the headless builds");
+        }
+
+        std::shared_ptr<ITexture> WrapD3D11Texture(std::shared_ptr<IDevice> device,
+                                                   const XrSwapchainCreateInfo& info,
+                                                   ID3D11Texture2D* texture,
+                                                   const std::optional<std::string>& debugName) {
+            throw new std::runtime_error("No D3D11 in the headless builds");
+        }
+
+        std::shared_ptr<IDevice> WrapD3D12Device(ID3D12Device* device, ID3D12CommandQueue* queue) {
+            throw new std::runtime_error("No D3D12 in the headless builds");
+        }
+
+        std::shared_ptr<ITexture> WrapD3D12Texture(std::shared_ptr<IDevice> device,
+                                                   const XrSwapchainCreateInfo& info,
+                                                   ID3D12Resource* texture,
+                                                   const std::optional<std::string>& debugName) {
+            throw new std::runtime_error("No D3D12 in the headless builds");
+        }
+
+        std::shared_ptr<IUpscaler> CreateNISUpscaler(std::shared_ptr<config::IConfigManager> configManager,
+                                                     std::shared_ptr<IDevice> graphicsDevice,
+                                                     uint32_t outputWidth,
+                                                     uint32_t outputHeight) {
+            throw new std::runtime_error("No NIS in the headless builds");
+        }
+
+        std::shared_ptr<IUpscaler> CreateFSRUpscaler(std::shared_ptr<config::IConfigManager> configManager,
+                                                     std::shared_ptr<IDevice> graphicsDevice,
+                                                     uint32_t outputWidth,
+                                                     uint32_t outputHeight) {
+            throw new std::runtime_error("No FSR in the headless builds");
+        }
+
+        std::shared_ptr<IImageProcessor> CreateImageProcessor(std::shared_ptr<config::IConfigManager> configManager,
+                                                              std::shared_ptr<IDevice> graphicsDevice,
+                                                              const std::string& shaderFile) {
+            throw new std::runtime_error("No image processor in the headless builds");
+        }
+    } // namespace graphics
+
+    namespace input {
+        std::shared_ptr<IHandTracker> CreateHandTracker(OpenXrApi& openXR,
+                                                        std::shared_ptr<config::IConfigManager> configManager) {
+            throw new std::runtime_error("No hand tracking in the headless builds");
+        }
+    } // namespace input
+
+    namespace menu {
+        std::shared_ptr<IMenuHandler> CreateMenuHandler(std::shared_ptr<config::IConfigManager> configManager,
+                                                        std::shared_ptr<graphics::IDevice> device,
+                                                        uint32_t displayWidth,
+                                                        uint32_t displayHeight,
+                                                        bool isHandTrackingSupported,
+                                                        bool isPredictionDampeningSupported) {
+            throw new std::runtime_error("No menu in the headless builds");
+        }
+    } // namespace menu
+
+    namespace utilities {
+        // The flight recorder also records the events, which headless/log.cpp ignores.
+        std::shared_ptr<IFlightRecorder> CreateFlightRecorder(const std::string& pathPrefix, uint32_t thresholdPercent) {
+            throw new std::runtime_error("No flight recorder in the headless builds");
+        }
+
+        std::shared_ptr<ITelemetryPublisher>
+        CreateTelemetryPublisher(const std::string& applicationName, uint32_t displayWidth, uint32_t displayHeight) {
+            throw new std::runtime_error("No telemetry in the headless builds");
+        }
+    } // namespace utilities
+
+} // namespace toolkit
+
+int main(int argc, char** argv) {
+    const std::string outputPath = argc > 1 ? argv[1] : "layer_benchmark.json";
+
+    CreateLayer();
+
+    XrViewLocateInfo viewLocateInfo{
+        XR_TYPE_VIEW_LOCATE_INFO, nullptr, XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO, 0, runtime::Space};
+    XrViewState viewState{XR_TYPE_VIEW_STATE};
+    uint32_t viewCount;
+    XrView views[graphics::ViewCount] = {{XR_TYPE_VIEW}, {XR_TYPE_VIEW}};
+
+    XrSpaceLocation location{XR_TYPE_SPACE_LOCATION};
+
+    const XrActiveActionSet activeActionSet{runtime::ActionSet, XR_NULL_PATH};
+    const XrActionsSyncInfo syncInfo{XR_TYPE_ACTIONS_SYNC_INFO, nullptr, 1, &activeActionSet};
+
+    const XrActionStateGetInfo getInfo{XR_TYPE_ACTION_STATE_GET_INFO, nullptr, runtime::Action, XR_NULL_PATH};
+    XrActionStateBoolean booleanState{XR_TYPE_ACTION_STATE_BOOLEAN};
+    XrActionStateFloat floatState{XR_TYPE_ACTION_STATE_FLOAT};
+    XrActionStatePose poseState{XR_TYPE_ACTION_STATE_POSE};
+
+    // The frame loop submits no layers.
+    XrFrameState frameState{};
+    const XrFrameEndInfo frameEndInfo{
+        XR_TYPE_FRAME_END_INFO, nullptr, 0, XR_ENVIRONMENT_BLEND_MODE_OPAQUE, 0, nullptr};
+
+    // The ICD is initialized from the IPD upon the first xrLocateViews(). Run a frame so that the layer is measured in
+    // its steady state.
+    CHECK_XRCMD(g_layer.xrWaitFrame(runtime::Session, nullptr, &frameState));
+    CHECK_XRCMD(g_layer.xrBeginFrame(runtime::Session, nullptr));
+    CHECK_XRCMD(g_layer.xrLocateViews(
+        runtime::Session, &viewLocateInfo, &viewState, graphics::ViewCount, &viewCount, views));
+    CHECK_XRCMD(g_layer.xrEndFrame(runtime::Session, &frameEndInfo));
+
+    // Without an IDevice, the layer does not refresh its configuration in xrEndFrame().
+    g_configManager->takeSnapshot();
+
+    const Result results[] = {
+        Run("xrLocateViews",
+            g_layer.xrLocateViews,
+            runtime::xrLocateViews,
+            runtime::Session,
+            &viewLocateInfo,
+            &viewState,
+            graphics::ViewCount,
+            &viewCount,
+            views),
+        Run("xrLocateSpace",
+            g_layer.xrLocateSpace,
+            runtime::xrLocateSpace,
+            runtime::ActionSpace,
+            runtime::Space,
+            frameState.predictedDisplayTime,
+            &location),
+        Run("xrSyncActions", g_layer.xrSyncActions, runtime::xrSyncActions, runtime::Session, &syncInfo),
+        Run("xrGetActionStateBoolean",
+            g_layer.xrGetActionStateBoolean,
+            runtime::xrGetActionStateBoolean,
+            runtime::Session,
+            &getInfo,
+            &booleanState),
+        Run("xrGetActionStateFloat",
+            g_layer.xrGetActionStateFloat,
+            runtime::xrGetActionStateFloat,
+            runtime::Session,
+            &getInfo,
+            &floatState),
+        Run("xrGetActionStatePose",
+            g_layer.xrGetActionStatePose,
+            runtime::xrGetActionStatePose,
+            runtime::Session,
+            &getInfo,
+            &poseState),
+        Run("xrEndFrame", g_layer.xrEndFrame, runtime::xrEndFrame, runtime::Session, &frameEndInfo),
+    };
+
+    DestroyLayer();
+
+    printf("%-24s %12s %12s %12s\n", "entry point", "layer (ns)", "runtime (ns)", "overhead (ns)");
+    for (const auto& result : results) {
+        printf("%-24s %12.2f %12.2f %12.2f\n",
+               result.name,
+               result.layerNs,
+               result.runtimeNs,
+               result.layerNs - result.runtimeNs);
+    }
+
+    std::ofstream output(outputPath, std::ios_base::trunc);
+    output << "{\"unit\": \"ns\", \"results\": [";
+    for (size_t i = 0; i < std::size(results); i++) {
+        const auto& result = results[i];
+        output << (i ? ", " : "")
+               << fmt::format("{{\"name\": \"{}\", \"layer\": {:.2f}, \"runtime\": {:.2f}, \"overhead\": {:.2f}}}",
+                              result.name,
+                              result.layerNs,
+                              result.runtimeNs,
+                              result.layerNs - result.runtimeNs);
+    }
+    output << "]}\n";
+    if (!output) {
+        fprintf(stderr, "Failed to write %s\n", outputPath.c_str());
+        return 1;
+    }
+    printf("Results written to %s\n", outputPath.c_str());
+
+    return 0;
+}
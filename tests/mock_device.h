@@ -0,0 +1,258 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "interfaces.h"
+
+// A graphics device that records what is asked of it, without any GPU.
+namespace test {
+
+    using namespace toolkit::graphics;
+
+    struct MockTexture : ITexture {
+        MockTexture(const XrSwapchainCreateInfo& info, const std::string& name) : info(info), name(name) {
+        }
+
+        Api getApi() const override {
+            return Api::D3D11;
+        }
+        std::shared_ptr<IDevice> getDevice() const override {
+            return {};
+        }
+        const XrSwapchainCreateInfo& getInfo() const override {
+            return info;
+        }
+        bool isArray() const override {
+            return info.arraySize > 1;
+        }
+        std::shared_ptr<IShaderInputTextureView> getShaderInputView() const override {
+            return {};
+        }
+        std::shared_ptr<IShaderInputTextureView> getShaderInputView(uint32_t slice) const override {
+            return {};
+        }
+        std::shared_ptr<IComputeShaderOutputView> getComputeShaderOutputView() const override {
+            return {};
+        }
+        std::shared_ptr<IComputeShaderOutputView> getComputeShaderOutputView(uint32_t slice) const override {
+            return {};
+        }
+        std::shared_ptr<IRenderTargetView> getRenderTargetView() const override {
+            return {};
+        }
+        std::shared_ptr<IRenderTargetView> getRenderTargetView(uint32_t slice) const override {
+            return {};
+        }
+        std::shared_ptr<IDepthStencilView> getDepthStencilView() const override {
+            return {};
+        }
+        std::shared_ptr<IDepthStencilView> getDepthStencilView(uint32_t slice) const override {
+            return {};
+        }
+        void saveToFile(const std::string& path) const override {
+        }
+        void* getNativePtr() const override {
+            return nullptr;
+        }
+
+        const XrSwapchainCreateInfo info;
+        const std::string name;
+    };
+
+    struct MockBuffer : IShaderBuffer {
+        Api getApi() const override {
+            return Api::D3D11;
+        }
+        std::shared_ptr<IDevice> getDevice() const override {
+            return {};
+        }
+        void uploadData(const void* buffer, size_t count) override {
+        }
+        void* getNativePtr() const override {
+            return nullptr;
+        }
+    };
+
+    struct MockDevice : IDevice {
+        Api getApi() const override {
+            return Api::D3D11;
+        }
+        const std::string& getDeviceName() const override {
+            return name;
+        }
+        int64_t getTextureFormat(TextureFormat format) const override {
+            switch (format) {
+            case TextureFormat::R32G32B32A32_FLOAT:
+                return DXGI_FORMAT_R32G32B32A32_FLOAT;
+            case TextureFormat::R16G16B16A16_UNORM:
+                return DXGI_FORMAT_R16G16B16A16_UNORM;
+            case TextureFormat::R10G10B10A2_UNORM:
+                return DXGI_FORMAT_R10G10B10A2_UNORM;
+            default:
+                return DXGI_FORMAT_R8G8B8A8_UNORM;
+            }
+        }
+        bool isTextureFormatSRGB(int64_t format) const override {
+            return format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+        }
+        void saveContext(bool clear) override {
+        }
+        void restoreContext() override {
+        }
+        void flushContext(bool blocking) override {
+        }
+        std::shared_ptr<ITexture> createTexture(const XrSwapchainCreateInfo& info,
+                                                const std::optional<std::string>& debugName,
+                                                uint32_t rowPitch,
+                                                uint32_t imageSize,
+                                                const void* initialData) override {
+            auto texture = std::make_shared<MockTexture>(info, debugName.value_or(""));
+            numTexturesCreated++;
+            return texture;
+        }
+        std::shared_ptr<IShaderBuffer> createBuffer(size_t size,
+                                                    const std::optional<std::string>& debugName,
+                                                    const void* initialData,
+                                                    bool immutable) override {
+            return std::make_shared<MockBuffer>();
+        }
+        std::shared_ptr<ISimpleMesh> createSimpleMesh(std::vector<SimpleMeshVertex>& vertices,
+                                                      std::vector<uint16_t>& indices,
+                                                      const std::optional<std::string>& debugName) override {
+            return {};
+        }
+        std::shared_ptr<IQuadShader> createQuadShader(const std::string& shaderPath,
+                                                      const std::string& entryPoint,
+                                                      const std::optional<std::string>& debugName,
+                                                      const D3D_SHADER_MACRO* defines,
+                                                      const std::string includePath) override {
+            return {};
+        }
+        std::shared_ptr<IComputeShader> createComputeShader(const std::string& shaderPath,
+                                                            const std::string& entryPoint,
+                                                            const std::optional<std::string>& debugName,
+                                                            const std::array<unsigned int, 3>& threadGroups,
+                                                            const D3D_SHADER_MACRO* defines,
+                                                            const std::string includePath) override {
+            return {};
+        }
+        std::shared_ptr<IGpuTimer> createTimer() override {
+            return {};
+        }
+        void calibrateTimers() override {
+        }
+        ProfilingScopeId registerProfilingScope(const std::string& name) override {
+            registeredScopes.push_back(name);
+            return (ProfilingScopeId)(registeredScopes.size() - 1);
+        }
+        void pushProfilingScope(ProfilingScopeId id) override {
+            profilingScopes.push_back(registeredScopes.at(id));
+        }
+        void popProfilingScope() override {
+        }
+        const std::vector<ProfilingResult>& collectProfilingResults() override {
+            return profilingResults;
+        }
+        void setShader(std::shared_ptr<IQuadShader> shader) override {
+        }
+        void setShader(std::shared_ptr<IComputeShader> shader) override {
+        }
+        void setShaderInput(uint32_t slot, std::shared_ptr<ITexture> input, int32_t slice) override {
+        }
+        void setShaderInput(uint32_t slot, std::shared_ptr<IShaderBuffer> input) override {
+        }
+        void setShaderOutput(uint32_t slot, std::shared_ptr<ITexture> output, int32_t slice) override {
+        }
+        void dispatchShader(bool doNotClear) const override {
+        }
+        void setViewport(const XrRect2Di& viewport) override {
+        }
+        void unsetRenderTargets() override {
+        }
+        void setRenderTargets(std::vector<std::shared_ptr<ITexture>> renderTargets,
+                              std::shared_ptr<ITexture> depthBuffer) override {
+        }
+        void setRenderTargets(std::vector<std::pair<std::shared_ptr<ITexture>, int32_t>> renderTargets,
+                              std::pair<std::shared_ptr<ITexture>, int32_t> depthBuffer) override {
+        }
+        void clearColor(float top, float left, float bottom, float right, XrColor4f& color) const override {
+        }
+        void clearDepth(float value) override {
+        }
+        void setViewProjection(const XrPosef& eyePose, const XrFovf& fov, float depthNear, float depthFar) override {
+        }
+        void draw(std::shared_ptr<ISimpleMesh> mesh, const XrPosef& pose, XrVector3f scaling) override {
+        }
+        float drawString(std::wstring string,
+                         TextStyle style,
+                         float size,
+                         float x,
+                         float y,
+                         uint32_t color,
+                         bool measure,
+                         bool alignRight) override {
+            return 0.0f;
+        }
+        float drawString(std::string string,
+                         TextStyle style,
+                         float size,
+                         float x,
+                         float y,
+                         uint32_t color,
+                         bool measure,
+                         bool alignRight) override {
+            return 0.0f;
+        }
+        float measureString(std::wstring string, TextStyle style, float size) const override {
+            return 0.0f;
+        }
+        float measureString(std::string string, TextStyle style, float size) const override {
+            return 0.0f;
+        }
+        void beginText() override {
+        }
+        void flushText() override {
+        }
+        void shutdown() override {
+        }
+        uint32_t getBufferAlignmentConstraint() const override {
+            return 16;
+        }
+        uint32_t getTextureAlignmentConstraint() const override {
+            return 16;
+        }
+        void* getNativePtr() const override {
+            return nullptr;
+        }
+        void* getContextPtr() const override {
+            return nullptr;
+        }
+
+        const std::string name{"Mock device"};
+        uint32_t numTexturesCreated{0};
+        std::vector<std::string> registeredScopes;
+        std::vector<std::string> profilingScopes;
+        std::vector<ProfilingResult> profilingResults;
+    };
+
+} // namespace test
@@ -0,0 +1,142 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "factories.h"
+#include "interfaces.h"
+
+#include "test.h"
+
+namespace {
+
+    using namespace toolkit::utilities;
+
+    constexpr XrDuration Period = 11'111'111;
+    constexpr auto Delay = std::chrono::milliseconds(30);
+    constexpr uint64_t DelayUs = 30'000;
+
+    void WaitFrame(IFrameAnalyzer& analyzer, XrTime displayTime) {
+        analyzer.onWaitFrameStart();
+        analyzer.onWaitFrameEnd(displayTime, displayTime, Period);
+    }
+
+    void EndFrame(IFrameAnalyzer& analyzer, XrTime displayTime) {
+        analyzer.onEndFrameStart(displayTime);
+        analyzer.onEndFrameEnd(displayTime);
+    }
+
+} // namespace
+
+TEST(PipelinedFramesAreMeasuredSeparately) {
+    auto analyzer = CreateFrameAnalyzer(std::nullopt);
+
+    // The application waits for the next frame before submitting the current one.
+    WaitFrame(*analyzer, 1 * Period);
+    analyzer->onBeginFrame();
+    WaitFrame(*analyzer, 2 * Period);
+    std::this_thread::sleep_for(Delay);
+    EndFrame(*analyzer, 1 * Period);
+    analyzer->onBeginFrame();
+    EndFrame(*analyzer, 2 * Period);
+
+    // The first frame was rendered during the delay, the second frame waited for it to begin.
+    const auto stats = analyzer->computeStatistics();
+    CHECK(stats.beginToEndUs.max >= DelayUs);
+    CHECK(stats.beginToEndUs.p50 < DelayUs);
+    CHECK(stats.waitToBeginUs.max >= DelayUs);
+    CHECK(stats.waitToBeginUs.p50 < DelayUs);
+    CHECK_EQ(stats.displayPeriodUs.max, (uint64_t)(Period / 1000));
+    CHECK_EQ(stats.missedFrames, 0u);
+}
+
+TEST(UnknownFramesAreIgnored) {
+    auto analyzer = CreateFrameAnalyzer(std::nullopt);
+
+    WaitFrame(*analyzer, 1 * Period);
+    analyzer->onBeginFrame();
+    std::this_thread::sleep_for(Delay);
+    EndFrame(*analyzer, 5 * Period);
+
+    // The frame is still in flight.
+    auto stats = analyzer->computeStatistics();
+    CHECK_EQ(stats.beginToEndUs.max, 0ull);
+
+    EndFrame(*analyzer, 1 * Period);
+    stats = analyzer->computeStatistics();
+    CHECK(stats.beginToEndUs.max >= DelayUs);
+}
+
+TEST(MissedFramesAreCounted) {
+    auto analyzer = CreateFrameAnalyzer(std::nullopt);
+
+    for (const auto frame : {1, 2, 5, 6}) {
+        WaitFrame(*analyzer, frame * Period);
+        analyzer->onBeginFrame();
+        EndFrame(*analyzer, frame * Period);
+    }
+
+    auto stats = analyzer->computeStatistics();
+    CHECK_EQ(stats.missedFrames, 2u);
+    CHECK_EQ(analyzer->getTotalMissedFrames(), 2u);
+
+    // The window is reset, but not the total.
+    WaitFrame(*analyzer, 9 * Period);
+    stats = analyzer->computeStatistics();
+    CHECK_EQ(stats.missedFrames, 2u);
+    CHECK_EQ(analyzer->getTotalMissedFrames(), 4u);
+}
+
+TEST(WaitFrameFromAnotherThread) {
+    auto analyzer = CreateFrameAnalyzer(std::nullopt);
+
+    constexpr int NumFrames = 200;
+    std::mutex mutex;
+    std::condition_variable cv;
+    int waited = 0;
+
+    std::thread waitThread([&] {
+        for (int i = 1; i <= NumFrames; i++) {
+            WaitFrame(*analyzer, i * Period);
+            std::unique_lock lock(mutex);
+            waited = i;
+            cv.notify_one();
+        }
+    });
+
+    for (int i = 1; i <= NumFrames; i++) {
+        {
+            std::unique_lock lock(mutex);
+            cv.wait(lock, [&] { return waited >= i; });
+        }
+        analyzer->onBeginFrame();
+        EndFrame(*analyzer, i * Period);
+        if (i % 50 == 0) {
+            analyzer->computeStatistics();
+        }
+    }
+    waitThread.join();
+
+    CHECK_EQ(analyzer->getTotalMissedFrames(), 0u);
+}
+
+TEST_MAIN()
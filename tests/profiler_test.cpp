@@ -0,0 +1,172 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "factories.h"
+#include "interfaces.h"
+
+#include "mock_device.h"
+#include "test.h"
+
+namespace {
+
+    using namespace toolkit::graphics;
+    using namespace test;
+
+    // Every measurement lasts 10us on the CPU and 20us on the GPU.
+    struct MockCpuTimer : toolkit::utilities::ICpuTimer {
+        void start() override {
+        }
+        void stop() override {
+        }
+        bool consumeTimestamps(uint64_t& startUs, uint64_t& endUs) override {
+            return false;
+        }
+        uint64_t query(bool reset) const override {
+            return 10;
+        }
+    };
+
+    struct MockGpuTimer : IGpuTimer {
+        Api getApi() const override {
+            return Api::D3D11;
+        }
+        std::shared_ptr<IDevice> getDevice() const override {
+            return nullptr;
+        }
+        void start() override {
+        }
+        void stop() override {
+        }
+        bool consumeTimestamps(uint64_t& startUs, uint64_t& endUs) override {
+            return false;
+        }
+        std::optional<uint64_t> query(bool reset) const override {
+            return 20;
+        }
+    };
+
+    struct TimedDevice : MockDevice {
+        std::shared_ptr<IGpuTimer> createTimer() override {
+            return std::make_shared<MockGpuTimer>();
+        }
+    };
+
+    // The results of a frame are only returned once all the frames in-flight have been started.
+    const std::vector<ProfilingResult>& NextRecordedFrame(IProfiler& profiler) {
+        profiler.nextFrame();
+        profiler.nextFrame();
+        return profiler.nextFrame();
+    }
+
+} // namespace
+
+namespace toolkit::utilities {
+
+    std::shared_ptr<ICpuTimer> CreateCpuTimer() {
+        return std::make_shared<MockCpuTimer>();
+    }
+
+} // namespace toolkit::utilities
+
+TEST(RegisteringTheSameNameReturnsTheSameId) {
+    TimedDevice device;
+    auto profiler = CreateProfiler(device);
+
+    const auto a = profiler->registerScope("A");
+    const auto b = profiler->registerScope("B");
+    CHECK(a != b);
+    CHECK_EQ(profiler->registerScope("A"), a);
+}
+
+TEST(NestedScopesAreListedAfterTheirParent) {
+    TimedDevice device;
+    auto profiler = CreateProfiler(device);
+    const auto upscaler = profiler->registerScope("Upscaler");
+    const auto fsr = profiler->registerScope("FSR");
+    const auto eye0 = profiler->registerScope("eye0");
+
+    profiler->pushScope(upscaler);
+    profiler->pushScope(fsr);
+    profiler->pushScope(eye0);
+    profiler->popScope();
+    profiler->popScope();
+    profiler->popScope();
+    profiler->pushScope(eye0);
+    profiler->popScope();
+
+    const auto& results = NextRecordedFrame(*profiler);
+    CHECK_EQ(results.size(), 4);
+    CHECK(results[0].path == "Upscaler");
+    CHECK_EQ(results[0].depth, 0);
+    CHECK(results[1].path == "Upscaler/FSR");
+    CHECK_EQ(results[1].depth, 1);
+    CHECK(results[2].path == "Upscaler/FSR/eye0");
+    CHECK_EQ(results[2].depth, 2);
+
+    // The same name under another parent is another scope.
+    CHECK(results[3].path == "eye0");
+    CHECK_EQ(results[3].depth, 0);
+}
+
+TEST(ScopesEnteredSeveralTimesAccumulate) {
+    TimedDevice device;
+    auto profiler = CreateProfiler(device);
+    const auto stage = profiler->registerScope("Stage");
+    const auto eye0 = profiler->registerScope("eye0");
+    const auto eye1 = profiler->registerScope("eye1");
+
+    for (const auto eye : {eye0, eye1}) {
+        profiler->pushScope(stage);
+        profiler->pushScope(eye);
+        profiler->popScope();
+        profiler->popScope();
+    }
+
+    const auto& results = NextRecordedFrame(*profiler);
+    CHECK_EQ(results.size(), 3);
+    CHECK_EQ(results[0].count, 2);
+    CHECK_EQ(results[0].cpuTimeUs, 20);
+    CHECK_EQ(results[0].gpuTimeUs, 40);
+    CHECK(results[1].path == "Stage/eye0");
+    CHECK_EQ(results[1].count, 1);
+    CHECK(results[2].path == "Stage/eye1");
+    CHECK_EQ(results[2].gpuTimeUs, 20);
+}
+
+TEST(ScopesNotEnteredDuringAFrameAreEmpty) {
+    TimedDevice device;
+    auto profiler = CreateProfiler(device);
+    const auto stage = profiler->registerScope("Stage");
+
+    profiler->pushScope(stage);
+    profiler->popScope();
+    CHECK_EQ(NextRecordedFrame(*profiler)[0].count, 1);
+
+    const auto& results = NextRecordedFrame(*profiler);
+    CHECK_EQ(results.size(), 1);
+    CHECK_EQ(results[0].count, 0);
+    CHECK_EQ(results[0].cpuTimeUs, 0);
+}
+
+TEST_MAIN()
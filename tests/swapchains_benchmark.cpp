@@ -0,0 +1,113 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "swapchains.h"
+
+#include "benchmark.h"
+
+#include <random>
+
+// Compares the lookups in the swapchain registry of the layer with the std::map it replaced, for the number of
+// swapchains that applications create (2 to 12). Each lookup reads the state it found. Two access patterns are measured:
+// - "frame": the left and right eye swapchains are looked up alternately, like xrEndFrame() does for a projection layer.
+//   The registry is also measured with a slot hint for each eye, like xrEndFrame() keeps.
+// - "random": any swapchain is looked up, like with quad layers or xrAcquireSwapchainImage() on each swapchain.
+
+namespace {
+
+    using namespace toolkit::utilities;
+
+    // The same size as the state kept by the layer.
+    struct State {
+        std::vector<int> images;
+        uint32_t acquiredImageIndex{0};
+    };
+
+    struct Result {
+        double registryNs;
+        double hintedNs;
+        double mapNs;
+    };
+
+    Result Run(const std::vector<XrSwapchain>& handles, const std::vector<uint32_t>& pattern) {
+        SwapchainRegistry<State> registry;
+        std::map<XrSwapchain, State> map;
+        for (uint32_t i = 0; i < handles.size(); i++) {
+            registry.insert_or_assign(handles[i], State{{}, i});
+            map.insert_or_assign(handles[i], State{{}, i});
+        }
+
+        const uint32_t mask = (uint32_t)pattern.size() - 1;
+        Result result;
+        result.registryNs = benchmark::Measure([&](uint32_t i) {
+            const auto state = registry.find(handles[pattern[i & mask]]);
+            benchmark::Consume(state->acquiredImageIndex);
+        });
+        uint32_t hints[2]{};
+        result.hintedNs = benchmark::Measure([&](uint32_t i) {
+            const auto state = registry.find(handles[pattern[i & mask]], hints[i & 1]);
+            benchmark::Consume(state->acquiredImageIndex);
+        });
+        result.mapNs = benchmark::Measure([&](uint32_t i) {
+            const auto it = map.find(handles[pattern[i & mask]]);
+            benchmark::Consume(it->second.acquiredImageIndex);
+        });
+        return result;
+    }
+
+} // namespace
+
+int main() {
+    std::mt19937 random(42);
+
+    printf("%-10s %-8s %14s %14s %14s\n", "swapchains", "pattern", "registry (ns)", "hinted (ns)", "std::map (ns)");
+    for (uint32_t count = 2; count <= 12; count++) {
+        // The runtime hands out handles in no particular order.
+        std::vector<XrSwapchain> handles;
+        for (uint32_t i = 0; i < count; i++) {
+            handles.push_back(reinterpret_cast<XrSwapchain>(0x10000 + i * 0x40));
+        }
+        std::shuffle(handles.begin(), handles.end(), random);
+
+        // The eye swapchains are the last ones created, which is the worst case for the linear search.
+        std::vector<uint32_t> framePattern(1024);
+        std::vector<uint32_t> randomPattern(1024);
+        for (uint32_t i = 0; i < framePattern.size(); i++) {
+            framePattern[i] = count - 2 + (i % 2);
+            randomPattern[i] = random() % count;
+        }
+
+        const auto frame = Run(handles, framePattern);
+        const auto uniform = Run(handles, randomPattern);
+        printf("%-10u %-8s %14.2f %14.2f %14.2f\n", count, "frame", frame.registryNs, frame.hintedNs, frame.mapNs);
+        printf("%-10u %-8s %14.2f %14.2f %14.2f\n",
+               count,
+               "random",
+               uniform.registryNs,
+               uniform.hintedNs,
+               uniform.mapNs);
+    }
+
+    return 0;
+}
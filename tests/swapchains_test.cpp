@@ -0,0 +1,168 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "swapchains.h"
+
+#include "test.h"
+
+namespace {
+
+    using namespace toolkit::utilities;
+
+    struct State {
+        uint32_t value{0};
+    };
+
+    XrSwapchain Handle(uintptr_t id) {
+        return reinterpret_cast<XrSwapchain>(0x1000 + id * 0x40);
+    }
+
+    void Insert(SwapchainRegistry<State>& registry, uintptr_t id, uint32_t value) {
+        registry.insert_or_assign(Handle(id), State{value});
+    }
+
+} // namespace
+
+TEST(FindsEachSwapchain) {
+    SwapchainRegistry<State> registry;
+    CHECK(registry.find(Handle(0)) == nullptr);
+
+    for (uint32_t i = 0; i < 12; i++) {
+        Insert(registry, i, 100 + i);
+    }
+    CHECK_EQ(registry.size(), 12u);
+    for (uint32_t i = 0; i < 12; i++) {
+        const auto state = registry.find(Handle(i));
+        CHECK(state != nullptr);
+        CHECK_EQ(state ? state->value : 0, 100 + i);
+    }
+    CHECK(registry.find(Handle(12)) == nullptr);
+}
+
+TEST(InsertReplacesTheState) {
+    SwapchainRegistry<State> registry;
+    Insert(registry, 1, 10);
+    Insert(registry, 1, 20);
+    CHECK_EQ(registry.size(), 1u);
+    CHECK_EQ(registry.find(Handle(1))->value, 20u);
+}
+
+TEST(EraseKeepsTheOtherSwapchains) {
+    SwapchainRegistry<State> registry;
+    for (uint32_t i = 0; i < 4; i++) {
+        Insert(registry, i, i);
+    }
+
+    // Erasing the first slot moves the last entry into it.
+    registry.erase(Handle(0));
+    registry.erase(Handle(42));
+    CHECK_EQ(registry.size(), 3u);
+    CHECK(registry.find(Handle(0)) == nullptr);
+    for (uint32_t i = 1; i < 4; i++) {
+        CHECK_EQ(registry.find(Handle(i))->value, i);
+    }
+
+    registry.clear();
+    CHECK_EQ(registry.size(), 0u);
+    CHECK(registry.find(Handle(1)) == nullptr);
+}
+
+TEST(StatesDoNotMoveWithTheOtherSwapchains) {
+    SwapchainRegistry<State> registry;
+    Insert(registry, 0, 0);
+    Insert(registry, 1, 1);
+    const State* const right = registry.find(Handle(1));
+
+    // Grow the registry past its initial capacity, then erase the entries around this one.
+    for (uint32_t i = 2; i < 64; i++) {
+        Insert(registry, i, i);
+    }
+    registry.erase(Handle(0));
+    Insert(registry, 0, 10);
+    registry.erase(Handle(2));
+    CHECK(registry.find(Handle(1)) == right);
+    CHECK_EQ(right->value, 1u);
+
+    // Replacing the state of a swapchain keeps its storage.
+    Insert(registry, 1, 11);
+    CHECK(registry.find(Handle(1)) == right);
+    CHECK_EQ(right->value, 11u);
+    CHECK(registry.find(Handle(0)) != nullptr);
+    CHECK_EQ(registry.find(Handle(0))->value, 10u);
+}
+
+TEST(SlotHintSkipsTheSearch) {
+    SwapchainRegistry<State> registry;
+    for (uint32_t i = 0; i < 4; i++) {
+        Insert(registry, i, i);
+    }
+
+    uint32_t hint = 0;
+    CHECK_EQ(registry.find(Handle(2), hint)->value, 2u);
+    CHECK_EQ(hint, 2u);
+    CHECK_EQ(registry.find(Handle(2), hint)->value, 2u);
+
+    // A stale hint falls back to the search.
+    registry.erase(Handle(2));
+    CHECK(registry.find(Handle(2), hint) == nullptr);
+    CHECK_EQ(registry.find(Handle(3), hint)->value, 3u);
+    CHECK_EQ(hint, 3u);
+    hint = 1000;
+    CHECK_EQ(registry.find(Handle(1), hint)->value, 1u);
+    CHECK_EQ(hint, 1u);
+}
+
+TEST(SlotsAreReusedAfterErase) {
+    SwapchainRegistry<State, 4> registry;
+    for (uint32_t i = 0; i < 4; i++) {
+        CHECK_EQ(registry.insert_or_assign(Handle(i), State{i}), i);
+    }
+
+    bool isFull = false;
+    try {
+        registry.insert_or_assign(Handle(4), State{4});
+    } catch (std::runtime_error* exc) {
+        delete exc;
+        isFull = true;
+    }
+    CHECK(isFull);
+
+    registry.erase(Handle(1));
+    CHECK_EQ(registry.insert_or_assign(Handle(4), State{4}), 1u);
+    CHECK_EQ(registry.find(Handle(4))->value, 4u);
+    CHECK_EQ(registry.size(), 4u);
+}
+
+TEST(LookupsDoNotModifyTheRegistry) {
+    SwapchainRegistry<State> registry;
+    for (uint32_t i = 0; i < 4; i++) {
+        Insert(registry, i, i);
+    }
+
+    const auto& constRegistry = registry;
+    CHECK_EQ(constRegistry.find(Handle(3))->value, 3u);
+    CHECK(constRegistry.find(Handle(4)) == nullptr);
+}
+
+TEST_MAIN()
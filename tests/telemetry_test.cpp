@@ -0,0 +1,209 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <thread>
+
+#include "telemetry.h"
+
+#include "test.h"
+
+namespace {
+
+    using namespace toolkit::telemetry;
+
+    // A file-backed mapping, written with the same protocol as the layer.
+    struct Publisher {
+        Publisher() {
+            char path[] = "/tmp/telemetry_testXXXXXX";
+            const int fd = mkstemp(path);
+            this->path = path;
+            if (ftruncate(fd, sizeof(Layout))) {
+                abort();
+            }
+            layout = reinterpret_cast<Layout*>(
+                mmap(nullptr, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+            close(fd);
+
+            layout->header.magic = Magic;
+            layout->header.version = Version;
+            layout->header.recordCount = RecordCount;
+        }
+
+        ~Publisher() {
+            munmap(layout, sizeof(Layout));
+            unlink(path.c_str());
+        }
+
+        // Each record is filled with its index, so that torn records are easy to spot.
+        void publish(uint64_t count) {
+            for (uint64_t i = 0; i < count; i++) {
+                FrameData data{};
+                data.frameIndex = nextFrameIndex++;
+                for (auto& timing : data.timingsUs) {
+                    timing = data.frameIndex;
+                }
+                PublishRecord(*layout, data);
+            }
+        }
+
+        std::string path;
+        Layout* layout;
+        uint64_t nextFrameIndex{0};
+    };
+
+    bool IsIntact(const FrameData& data) {
+        for (const auto timing : data.timingsUs) {
+            if (timing != data.frameIndex) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    TEST(OpenFailsWithoutAPublisher) {
+        TelemetryReader reader;
+        CHECK(!reader.open("/tmp/telemetry_test_missing"));
+        CHECK(!reader.getHeader());
+    }
+
+    TEST(OpenFailsWithAnotherVersion) {
+        Publisher publisher;
+        publisher.layout->header.version = Version + 1;
+
+        TelemetryReader reader;
+        CHECK(!reader.open(publisher.path.c_str()));
+    }
+
+    TEST(ReadsTheRecordsPublishedSinceOpening) {
+        Publisher publisher;
+        publisher.publish(3);
+
+        TelemetryReader reader;
+        CHECK(reader.open(publisher.path.c_str()));
+        const Header* header = reader.getHeader();
+        CHECK(header && header->writeCount.load() == 3);
+
+        FrameData records[16];
+        uint64_t lostRecords = 0;
+        CHECK_EQ(reader.read(records, 16, lostRecords), 0);
+
+        publisher.publish(10);
+        CHECK_EQ(reader.read(records, 16, lostRecords), 10);
+        CHECK_EQ(lostRecords, 0);
+        for (uint64_t i = 0; i < 10; i++) {
+            CHECK_EQ(records[i].frameIndex, 3 + i);
+            CHECK(IsIntact(records[i]));
+        }
+        CHECK_EQ(reader.read(records, 16, lostRecords), 0);
+    }
+
+    TEST(ReadsAreLimitedByTheCapacity) {
+        Publisher publisher;
+        TelemetryReader reader;
+        CHECK(reader.open(publisher.path.c_str()));
+
+        publisher.publish(10);
+        FrameData records[4];
+        uint64_t lostRecords = 0;
+        CHECK_EQ(reader.read(records, 4, lostRecords), 4);
+        CHECK_EQ(records[3].frameIndex, 3);
+        CHECK_EQ(reader.read(records, 4, lostRecords), 4);
+        CHECK_EQ(records[0].frameIndex, 4);
+        CHECK_EQ(reader.read(records, 4, lostRecords), 2);
+        CHECK_EQ(records[1].frameIndex, 9);
+        CHECK_EQ(lostRecords, 0);
+    }
+
+    TEST(OverwrittenRecordsAreCountedAsLost) {
+        Publisher publisher;
+        TelemetryReader reader;
+        CHECK(reader.open(publisher.path.c_str()));
+
+        publisher.publish(RecordCount + 100);
+        std::vector<FrameData> records(2 * RecordCount);
+        uint64_t lostRecords = 0;
+        CHECK_EQ(reader.read(records.data(), records.size(), lostRecords), RecordCount);
+        CHECK_EQ(lostRecords, 100);
+        CHECK_EQ(records[0].frameIndex, 100);
+        CHECK_EQ(records[RecordCount - 1].frameIndex, RecordCount + 99);
+    }
+
+    TEST(RecordsBeingWrittenAreCountedAsLost) {
+        Publisher publisher;
+        TelemetryReader reader;
+        CHECK(reader.open(publisher.path.c_str()));
+
+        publisher.publish(3);
+
+        // The writer has lapped the ring and is rewriting the second record.
+        publisher.layout->records[1].sequence.store(2 * (RecordCount + 1) + 1);
+
+        FrameData records[4];
+        uint64_t lostRecords = 0;
+        CHECK_EQ(reader.read(records, 4, lostRecords), 2);
+        CHECK_EQ(lostRecords, 1);
+        CHECK_EQ(records[0].frameIndex, 0);
+        CHECK_EQ(records[1].frameIndex, 2);
+    }
+
+    TEST(ConcurrentReadsAreNeverTorn) {
+        Publisher publisher;
+        TelemetryReader reader;
+        CHECK(reader.open(publisher.path.c_str()));
+
+        constexpr uint64_t Count = 1000000;
+        std::atomic<bool> done{false};
+        std::thread writer([&] {
+            publisher.publish(Count);
+            done = true;
+        });
+
+        std::vector<FrameData> records(RecordCount);
+        uint64_t numRead = 0;
+        uint64_t lostRecords = 0;
+        uint64_t nextFrameIndex = 0;
+        bool intact = true;
+        bool ordered = true;
+        while (true) {
+            // Check for completion first, so that the last read sees all the records.
+            const bool wasDone = done;
+            const size_t count = reader.read(records.data(), records.size(), lostRecords);
+            for (size_t i = 0; i < count; i++) {
+                intact = intact && IsIntact(records[i]);
+                ordered = ordered && records[i].frameIndex >= nextFrameIndex;
+                nextFrameIndex = records[i].frameIndex + 1;
+            }
+            numRead += count;
+            if (wasDone && !count) {
+                break;
+            }
+        }
+        writer.join();
+
+        CHECK(intact);
+        CHECK(ordered);
+        CHECK_EQ(numRead + lostRecords, Count);
+    }
+
+} // namespace
+
+TEST_MAIN()
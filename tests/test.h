@@ -0,0 +1,95 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+// A minimal test harness: each TEST() registers a function, and TEST_MAIN() runs them all.
+namespace test {
+
+    struct TestCase {
+        const char* name;
+        std::function<void()> run;
+    };
+
+    inline std::vector<TestCase>& GetTests() {
+        static std::vector<TestCase> tests;
+        return tests;
+    }
+
+    inline int failures = 0;
+
+    struct Registration {
+        Registration(const char* name, std::function<void()> run) {
+            GetTests().push_back({name, std::move(run)});
+        }
+    };
+
+    inline int RunAll() {
+        for (const auto& test : GetTests()) {
+            const int failuresBefore = failures;
+            test.run();
+            printf("%s %s\n", failures == failuresBefore ? "PASS" : "FAIL", test.name);
+        }
+        return failures ? 1 : 0;
+    }
+
+} // namespace test
+
+#define TEST(name)                                                                                                     \
+    void name();                                                                                                       \
+    static test::Registration name##Registration(#name, name);                                                         \
+    void name()
+
+#define CHECK(condition)                                                                                               \
+    do {                                                                                                               \
+        if (!(condition)) {                                                                                            \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);                              \
+            test::failures++;                                                                                          \
+        }                                                                                                              \
+    } while (false)
+
+#define CHECK_EQ(actual, expected)                                                                                     \
+    do {                                                                                                               \
+        const auto actualValue = (actual);                                                                             \
+        const auto expectedValue = (expected);                                                                         \
+        if (!(actualValue == expectedValue)) {                                                                         \
+            fprintf(stderr,                                                                                            \
+                    "%s:%d: CHECK_EQ(%s, %s) failed: %s != %s\n",                                                      \
+                    __FILE__,                                                                                          \
+                    __LINE__,                                                                                          \
+                    #actual,                                                                                           \
+                    #expected,                                                                                         \
+                    std::to_string(actualValue).c_str(),                                                               \
+                    std::to_string(expectedValue).c_str());                                                            \
+            test::failures++;                                                                                          \
+        }                                                                                                              \
+    } while (false)
+
+#define TEST_MAIN()                                                                                                    \
+    int main() {                                                                                                       \
+        return test::RunAll();                                                                                         \
+    }
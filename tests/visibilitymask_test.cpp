@@ -0,0 +1,161 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "factories.h"
+#include "interfaces.h"
+#include "visibilitymask.h"
+
+#include "test.h"
+
+namespace {
+
+    using namespace toolkit::utilities;
+
+    // A 90 degrees FOV, where the vertices at 1 meter span [-1, 1].
+    constexpr float Angle = 0.785398163f;
+    constexpr XrFovf Fov{-Angle, Angle, Angle, -Angle};
+
+    constexpr uint32_t TilesX = 40;
+    constexpr uint32_t TilesY = 30;
+
+    struct Mask {
+        uint32_t visibleCount;
+        uint32_t words[VISIBILITY_MASK_MAX_WORDS];
+
+        // The same lookup as IsTileVisible() in the shaders.
+        bool isVisible(uint32_t x, uint32_t y) const {
+            const uint32_t index = y * TilesX + x;
+            return (words[index / 32] >> (index % 32)) & 1;
+        }
+    };
+
+    Mask Build(const std::vector<XrVector2f>& vertices, const std::vector<uint32_t>& indices) {
+        Mask mask;
+        memset(mask.words, 0xff, sizeof(mask.words));
+        std::vector<uint8_t> scratch;
+        mask.visibleCount = BuildVisibilityMask(vertices, indices, Fov, TilesX, TilesY, mask.words, scratch);
+        return mask;
+    }
+
+    uint32_t CountVisible(const Mask& mask) {
+        uint32_t count = 0;
+        for (uint32_t y = 0; y < TilesY; y++) {
+            for (uint32_t x = 0; x < TilesX; x++) {
+                count += mask.isVisible(x, y);
+            }
+        }
+        return count;
+    }
+
+} // namespace
+
+TEST(NoMeshIsAllVisible) {
+    const auto mask = Build({}, {});
+    CHECK_EQ(mask.visibleCount, TilesX * TilesY);
+    CHECK_EQ(CountVisible(mask), TilesX * TilesY);
+}
+
+TEST(FullViewIsAllVisible) {
+    const auto mask = Build({{-1, 1}, {1, 1}, {1, -1}, {-1, -1}}, {0, 1, 2, 0, 2, 3});
+    CHECK_EQ(mask.visibleCount, TilesX * TilesY);
+    CHECK_EQ(CountVisible(mask), TilesX * TilesY);
+}
+
+TEST(CenterQuadIsGrownByOneTile) {
+    // Covers the tiles [10, 30) horizontally and [10, 20) vertically.
+    const auto mask = Build({{-0.5f, 1 / 3.f}, {0.5f, 1 / 3.f}, {0.5f, -1 / 3.f}, {-0.5f, -1 / 3.f}},
+                            {0, 1, 2, 0, 2, 3});
+
+    // The quad might touch the tiles on its edges because of rounding, and the mask is grown by one tile.
+    for (uint32_t y = 0; y < TilesY; y++) {
+        for (uint32_t x = 0; x < TilesX; x++) {
+            if (x >= 10 && x < 30 && y >= 10 && y < 20) {
+                CHECK(mask.isVisible(x, y));
+            } else if (x < 8 || x >= 32 || y < 8 || y >= 22) {
+                CHECK(!mask.isVisible(x, y));
+            }
+        }
+    }
+    CHECK_EQ(mask.visibleCount, CountVisible(mask));
+
+    // The words past the last tile are left untouched.
+    CHECK_EQ(mask.words[(TilesX * TilesY + 31) / 32], 0xffffffffu);
+}
+
+TEST(TriangleFollowsItsEdges) {
+    // The upper-left half of the view. The tiles well below the diagonal are hidden.
+    const auto mask = Build({{-1, 1}, {1, 1}, {-1, -1}}, {0, 1, 2});
+    CHECK(mask.isVisible(0, 0));
+    CHECK(mask.isVisible(0, TilesY - 1));
+    CHECK(mask.isVisible(TilesX - 1, 0));
+    CHECK(!mask.isVisible(TilesX - 1, TilesY - 1));
+    CHECK(!mask.isVisible(TilesX - 5, TilesY - 5));
+    CHECK(mask.visibleCount > TilesX * TilesY / 2);
+    CHECK(mask.visibleCount < TilesX * TilesY * 3 / 4);
+}
+
+TEST(FovIsMappedToTiles) {
+    // With a narrower FOV, the same quad covers the whole view.
+    const float angle = 0.4636476f; // atan(0.5)
+    const XrFovf fov{-angle, angle, angle, -angle};
+    uint32_t words[VISIBILITY_MASK_MAX_WORDS]{};
+    std::vector<uint8_t> scratch;
+    const auto visibleCount = BuildVisibilityMask({{-0.5f, 0.5f}, {0.5f, 0.5f}, {0.5f, -0.5f}, {-0.5f, -0.5f}},
+                                                  {0, 1, 2, 0, 2, 3},
+                                                  fov,
+                                                  TilesX,
+                                                  TilesY,
+                                                  words,
+                                                  scratch);
+    CHECK_EQ(visibleCount, TilesX * TilesY);
+}
+
+TEST(ScratchIsReused) {
+    // A rebuild with the scratch storage of a previous, fully visible mask gives the same result as a fresh one.
+    const std::vector<XrVector2f> vertices = {{-1, 1}, {1, 1}, {-1, -1}};
+    const std::vector<uint32_t> indices = {0, 1, 2};
+    const auto expected = Build(vertices, indices);
+
+    std::vector<uint8_t> scratch;
+    uint32_t words[VISIBILITY_MASK_MAX_WORDS]{};
+    BuildVisibilityMask({}, {}, Fov, TilesX, TilesY, words, scratch);
+    const auto capacity = scratch.capacity();
+    const auto visibleCount = BuildVisibilityMask(vertices, indices, Fov, TilesX, TilesY, words, scratch);
+    CHECK_EQ(visibleCount, expected.visibleCount);
+    CHECK(memcmp(words, expected.words, (TilesX * TilesY + 31) / 32 * sizeof(uint32_t)) == 0);
+    CHECK_EQ(scratch.capacity(), capacity);
+}
+
+TEST(OutsideMeshIsHidden) {
+    const auto mask = Build({{2, 2}, {3, 2}, {3, 3}}, {0, 1, 2});
+    CHECK_EQ(mask.visibleCount, 0u);
+    CHECK_EQ(CountVisible(mask), 0u);
+}
+
+TEST(InvalidIndicesAreSkipped) {
+    const auto mask = Build({{-1, 1}, {1, 1}, {1, -1}}, {0, 1, 7, 0, 1});
+    CHECK_EQ(mask.visibleCount, 0u);
+}
+
+TEST_MAIN()